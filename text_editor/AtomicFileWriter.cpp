@@ -0,0 +1,194 @@
+#include "AtomicFileWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const size_t AtomicFileWriter::m_bufferCapacity = 1024 * 1024;
+
+AtomicFileWriter::AtomicFileWriter(const std::string &filePath)
+    : m_filePath(filePath), m_tempPath(filePath + ".saving"), m_bufferSize(0), m_failed(false),
+#ifdef _WIN32
+      m_file(INVALID_HANDLE_VALUE)
+#else
+      m_file(-1)
+#endif
+{}
+
+// Without a commit the target is left as it was
+AtomicFileWriter::~AtomicFileWriter() {
+    discard();
+}
+
+// Creates the temporary file, a leftover from an earlier failed save is overwritten
+bool AtomicFileWriter::open() {
+    discard();
+    m_failed = false;
+
+#ifdef _WIN32
+    m_file = CreateFileA(m_tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+#else
+    m_file = ::open(m_tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_file == -1)
+        return false;
+
+    // The new file keeps the permissions of the one it replaces
+    struct stat fileStat;
+    if (stat(m_filePath.c_str(), &fileStat) == 0)
+        fchmod(m_file, fileStat.st_mode & 07777);
+#endif
+
+    if (m_buffer == nullptr)
+        m_buffer.reset(new char[m_bufferCapacity]);
+
+    m_bufferSize = 0;
+    return true;
+}
+
+// Writes that don't fit into the buffer go to the file directly after the buffer is flushed
+bool AtomicFileWriter::write(const char *data, size_t size) {
+    if (m_failed)
+        return false;
+
+    if (m_bufferSize + size <= m_bufferCapacity) {
+        std::memcpy(m_buffer.get() + m_bufferSize, data, size);
+        m_bufferSize += size;
+        return true;
+    }
+
+    if (!flushBuffer())
+        return false;
+
+    if (size >= m_bufferCapacity)
+        return writeToFile(data, size);
+
+    std::memcpy(m_buffer.get(), data, size);
+    m_bufferSize = size;
+    return true;
+}
+
+// Syncs the temporary file and renames it over the target, returns false and keeps the target if anything fails
+bool AtomicFileWriter::commit() {
+    if (m_failed || !flushBuffer()) {
+        discard();
+        return false;
+    }
+
+    if (!syncAndClose()) {
+#ifdef _WIN32
+        DeleteFileA(m_tempPath.c_str());
+#else
+        unlink(m_tempPath.c_str());
+#endif
+        return false;
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(m_tempPath.c_str(), m_filePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileA(m_tempPath.c_str());
+        return false;
+    }
+#else
+    if (rename(m_tempPath.c_str(), m_filePath.c_str()) == -1) {
+        unlink(m_tempPath.c_str());
+        return false;
+    }
+
+    // The rename itself is only durable once the directory is synced
+    auto separator = m_filePath.find_last_of('/');
+    auto directory = separator == std::string::npos ? std::string(".") : m_filePath.substr(0, separator + 1);
+    auto directoryFile = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (directoryFile != -1) {
+        fsync(directoryFile);
+        ::close(directoryFile);
+    }
+#endif
+
+    return true;
+}
+
+// Closes and removes the temporary file if it is still open
+void AtomicFileWriter::discard() {
+#ifdef _WIN32
+    if (m_file == INVALID_HANDLE_VALUE)
+        return;
+
+    CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    DeleteFileA(m_tempPath.c_str());
+#else
+    if (m_file == -1)
+        return;
+
+    ::close(m_file);
+    m_file = -1;
+    unlink(m_tempPath.c_str());
+#endif
+
+    m_bufferSize = 0;
+}
+
+bool AtomicFileWriter::flushBuffer() {
+    if (m_bufferSize == 0)
+        return true;
+
+    auto written = writeToFile(m_buffer.get(), m_bufferSize);
+    m_bufferSize = 0;
+    return written;
+}
+
+bool AtomicFileWriter::writeToFile(const char *data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        // WriteFile takes a 32 bit length
+        DWORD toWrite = (DWORD) std::min<size_t>(size, 1u << 30);
+        DWORD written;
+
+        if (!WriteFile(m_file, data, toWrite, &written, nullptr)) {
+            m_failed = true;
+            return false;
+        }
+#else
+        auto written = ::write(m_file, data, size);
+
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+
+            m_failed = true;
+            return false;
+        }
+#endif
+
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+bool AtomicFileWriter::syncAndClose() {
+#ifdef _WIN32
+    auto synced = FlushFileBuffers(m_file) != 0;
+    auto closed = CloseHandle(m_file) != 0;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    auto synced = fsync(m_file) == 0;
+    auto closed = ::close(m_file) == 0;
+    m_file = -1;
+#endif
+
+    return synced && closed;
+}
@@ -0,0 +1,43 @@
+#ifndef TEXT_EDITOR_ATOMICFILEWRITER_H
+#define TEXT_EDITOR_ATOMICFILEWRITER_H
+
+#include <memory>
+#include <string>
+
+// Replaces a file without ever leaving it half written. The new contents go to a temporary file
+// in the same directory, which is synced to disk and then renamed over the target, so after a crash
+// at any point the target holds either the old or the new contents. Small writes are gathered
+// in a fixed size buffer and big ones go straight to the file, so memory use doesn't depend on the file size.
+class AtomicFileWriter {
+public:
+    explicit AtomicFileWriter(const std::string& filePath);
+    ~AtomicFileWriter();
+
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    bool open();
+    bool write(const char* data, size_t size);
+    bool commit();
+    void discard();
+private:
+    bool flushBuffer();
+    bool writeToFile(const char* data, size_t size);
+    bool syncAndClose();
+
+    static const size_t m_bufferCapacity;
+
+    std::string m_filePath;
+    std::string m_tempPath;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_bufferSize;
+    bool m_failed;
+#ifdef _WIN32
+    void* m_file;
+#else
+    int m_file;
+#endif
+};
+
+
+#endif //TEXT_EDITOR_ATOMICFILEWRITER_H
@@ -0,0 +1,73 @@
+#include "BenchmarkRunner.h"
+
+#include <algorithm>
+#include <cstdio>
+
+void BenchmarkTimer::start() { m_start = std::chrono::steady_clock::now(); }
+
+void BenchmarkTimer::stop() {
+    m_nanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+double BenchmarkTimer::getNanoseconds() const { return m_nanoseconds; }
+
+BenchmarkRunner::BenchmarkRunner(const std::string &filter, size_t repetitions)
+    : m_filter(filter), m_repetitions(std::max<size_t>(repetitions, 1)) {}
+
+bool BenchmarkRunner::isSelected(const std::string &name) const {
+    return m_filter.empty() || name.find(m_filter) != std::string::npos;
+}
+
+void BenchmarkRunner::run(const std::string &name, size_t operations, size_t bytes,
+                          const std::function<void(BenchmarkTimer &)> &body) {
+    if (!isSelected(name))
+        return;
+
+    std::vector<double> times;
+
+    for (size_t i=0; i<m_repetitions; ++i) {
+        BenchmarkTimer timer;
+        body(timer);
+        times.push_back(timer.getNanoseconds());
+    }
+
+    std::sort(times.begin(), times.end());
+    m_results.push_back({name, operations, bytes, m_repetitions, times.front(), times[times.size() / 2]});
+
+    // Progress goes to stderr so the JSON on stdout stays clean
+    std::fprintf(stderr, "%-40s %12.3f ms\n", name.c_str(), times.front() / 1e6);
+}
+
+void BenchmarkRunner::writeJson(std::ostream &out) const {
+    out << "{\n  \"benchmarks\": [";
+
+    for (size_t i=0; i<m_results.size(); ++i) {
+        auto& result = m_results[i];
+        auto seconds = result.m_bestNanoseconds / 1e9;
+
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        writeString(out, result.m_name);
+        out << ", \"operations\": " << result.m_operations
+            << ", \"bytes\": " << result.m_bytes
+            << ", \"repetitions\": " << result.m_repetitions
+            << ", \"best_ns\": " << (uint64_t) result.m_bestNanoseconds
+            << ", \"median_ns\": " << (uint64_t) result.m_medianNanoseconds
+            << ", \"ns_per_op\": " << (result.m_operations == 0 ? 0.0 : result.m_bestNanoseconds / (double) result.m_operations)
+            << ", \"mb_per_s\": " << (seconds == 0.0 ? 0.0 : (double) result.m_bytes / (1024.0 * 1024.0) / seconds)
+            << "}";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+void BenchmarkRunner::writeString(std::ostream &out, const std::string &text) {
+    out << '"';
+
+    for (auto c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+
+    out << '"';
+}
@@ -0,0 +1,49 @@
+#ifndef TEXT_EDITOR_BENCHMARKRUNNER_H
+#define TEXT_EDITOR_BENCHMARKRUNNER_H
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Measures the part of a benchmark between start and stop, so the setup it does before isn't counted
+class BenchmarkTimer {
+public:
+    void start();
+    void stop();
+
+    double getNanoseconds() const;
+private:
+    std::chrono::steady_clock::time_point m_start;
+    double m_nanoseconds = 0.0;
+};
+
+struct BenchmarkResult {
+    std::string m_name;
+    size_t m_operations;
+    size_t m_bytes;
+    size_t m_repetitions;
+    double m_bestNanoseconds;
+    double m_medianNanoseconds;
+};
+
+// Runs every benchmark whose name contains the filter a number of times and keeps the best and the median run
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(const std::string& filter, size_t repetitions);
+
+    bool isSelected(const std::string& name) const;
+    void run(const std::string& name, size_t operations, size_t bytes, const std::function<void(BenchmarkTimer&)>& body);
+
+    void writeJson(std::ostream& out) const;
+private:
+    static void writeString(std::ostream& out, const std::string& text);
+
+    std::string m_filter;
+    size_t m_repetitions;
+    std::vector<BenchmarkResult> m_results;
+};
+
+
+#endif //TEXT_EDITOR_BENCHMARKRUNNER_H
@@ -0,0 +1,95 @@
+#include "TextGenerator.h"
+
+namespace {
+    const char* const words[] = {
+            "buffer", "piece", "index", "line", "length", "table", "cursor", "block", "color", "token",
+            "value", "count", "offset", "node", "text", "change", "size", "start", "end", "result"
+    };
+
+    const char* const cppKeywords[] = {"int", "auto", "const", "size_t", "bool", "char", "double"};
+    const char* const csharpKeywords[] = {"int", "var", "string", "bool", "double", "long", "char"};
+    const char* const javaKeywords[] = {"int", "final", "String", "boolean", "double", "long", "char"};
+}
+
+TextGenerator::TextGenerator(uint32_t seed) : m_random(seed) {}
+
+// Generates whole lines until the text reaches the given size
+std::string TextGenerator::generate(LanguageMode mode, size_t size) {
+    std::string text;
+    text.reserve(size + 128);
+
+    size_t depth = 0;
+
+    while (text.size() < size) {
+        if (mode == LanguageMode::PlainText) {
+            text += generatePlainLine();
+        } else if (depth < 4 && m_random() % 8 == 0) {
+            text.append(depth, '\t');
+            text += "void " + identifier() + "(int " + identifier() + ") {";
+            ++depth;
+        } else if (depth > 0 && m_random() % 6 == 0) {
+            --depth;
+            text.append(depth, '\t');
+            text += "}";
+        } else {
+            text.append(depth, '\t');
+            text += generateCodeLine(mode, depth);
+        }
+
+        text += '\n';
+    }
+
+    // Close the open blocks so the folding sees balanced braces
+    while (depth-- > 0) {
+        text.append(depth, '\t');
+        text += "}\n";
+    }
+
+    return text;
+}
+
+// A single line without the line break, used for typing into a document
+std::string TextGenerator::generateLine(LanguageMode mode) {
+    return mode == LanguageMode::PlainText ? generatePlainLine() : generateCodeLine(mode, 0);
+}
+
+std::string TextGenerator::generatePlainLine() {
+    std::string line;
+    auto count = 4 + m_random() % 12;
+
+    for (size_t i=0; i<count; ++i) {
+        if (i != 0)
+            line += ' ';
+        line += identifier();
+    }
+
+    return line + '.';
+}
+
+// Mixes the things the highlighter looks for: keywords, strings, numbers, comments and preprocessor lines
+std::string TextGenerator::generateCodeLine(LanguageMode mode, size_t depth) {
+    auto keywords = mode == LanguageMode::CSharp ? csharpKeywords : mode == LanguageMode::Java ? javaKeywords : cppKeywords;
+    auto keyword = keywords[m_random() % 7];
+
+    switch (m_random() % 8) {
+        case 0:
+            return "// " + identifier() + " " + identifier() + " " + identifier();
+        case 1:
+            if (depth == 0 && (mode == LanguageMode::Cpp || mode == LanguageMode::C))
+                return "#include \"" + identifier() + ".h\"";
+            return std::string(keyword) + " " + identifier() + " = \"" + identifier() + " " + identifier() + "\";";
+        case 2:
+            return std::string("if (") + identifier() + " < " + std::to_string(m_random() % 1000) + ") return " + identifier() + ";";
+        case 3:
+            return "/* " + identifier() + " */ " + identifier() + "(" + std::to_string(m_random() % 100) + ".5);";
+        case 4:
+            return std::string("for (") + keyword + " i = 0; i < " + identifier() + "; ++i) " + identifier() + "[i] = '" +
+                   (char) ('a' + m_random() % 26) + "';";
+        default:
+            return std::string(keyword) + " " + identifier() + " = " + identifier() + " + " + std::to_string(m_random() % 100000) + ";";
+    }
+}
+
+std::string TextGenerator::identifier() {
+    return words[m_random() % (sizeof(words) / sizeof(words[0]))];
+}
@@ -0,0 +1,27 @@
+#ifndef TEXT_EDITOR_TEXTGENERATOR_H
+#define TEXT_EDITOR_TEXTGENERATOR_H
+
+#include "../SyntaxHiglighting/LanguageMode.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+// Generates synthetic source files for the benchmarks. The output of a seed is always the same,
+// so the results of different builds can be compared.
+class TextGenerator {
+public:
+    explicit TextGenerator(uint32_t seed = 42);
+
+    std::string generate(LanguageMode mode, size_t size);
+    std::string generateLine(LanguageMode mode);
+private:
+    std::string generatePlainLine();
+    std::string generateCodeLine(LanguageMode mode, size_t depth);
+    std::string identifier();
+
+    std::mt19937 m_random;
+};
+
+
+#endif //TEXT_EDITOR_TEXTGENERATOR_H
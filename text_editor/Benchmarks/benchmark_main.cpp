@@ -0,0 +1,358 @@
+// Benchmarks of the editing engine without a window. The results are written as JSON.
+// Usage: text_editor_benchmarks [--filter <text>] [--max-size <bytes>[K|M|G]] [--repetitions <n>] [--output <file>]
+
+#include "BenchmarkRunner.h"
+#include "TextGenerator.h"
+#include "../GUI/LineBuffer.h"
+#include "../PieceTable/PieceTableInstance.h"
+#include "../SyntaxHiglighting/TextHighlighter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    const size_t KB = 1024;
+    const size_t MB = 1024 * KB;
+    const size_t GB = 1024 * MB;
+
+    struct Options {
+        std::string m_filter;
+        std::string m_output;
+        size_t m_maxSize = 64 * MB;
+        size_t m_repetitions = 3;
+    };
+
+    struct BenchmarkLanguage {
+        LanguageMode m_mode;
+        const char* m_name;
+    };
+
+    const BenchmarkLanguage languages[] = {
+            {LanguageMode::PlainText, "plain"},
+            {LanguageMode::Cpp, "cpp"},
+            {LanguageMode::C, "c"},
+            {LanguageMode::CSharp, "csharp"},
+            {LanguageMode::Java, "java"}
+    };
+
+    // Accepts a plain number of bytes or one ending with K, M or G
+    bool parseSize(const std::string& text, size_t& size) {
+        char* end;
+        auto value = std::strtoull(text.c_str(), &end, 10);
+
+        if (end == text.c_str())
+            return false;
+
+        switch (*end) {
+            case '\0': size = value; return true;
+            case 'K': case 'k': size = value * KB; return true;
+            case 'M': case 'm': size = value * MB; return true;
+            case 'G': case 'g': size = value * GB; return true;
+            default: return false;
+        }
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i=1; i<argc; ++i) {
+            std::string argument = argv[i];
+
+            if (i + 1 == argc)
+                return false;
+
+            std::string value = argv[++i];
+
+            if (argument == "--filter")
+                options.m_filter = value;
+            else if (argument == "--output")
+                options.m_output = value;
+            else if (argument == "--max-size" && parseSize(value, options.m_maxSize))
+                continue;
+            else if (argument == "--repetitions")
+                options.m_repetitions = std::strtoull(value.c_str(), nullptr, 10);
+            else
+                return false;
+        }
+
+        return true;
+    }
+
+    std::string sizeName(size_t size) {
+        if (size >= GB) return std::to_string(size / GB) + "gb";
+        if (size >= MB) return std::to_string(size / MB) + "mb";
+        return std::to_string(size / KB) + "kb";
+    }
+
+    // A document with its lines loaded, like a TextBox that just opened a file. The benchmarks wait for the
+    // highlighting worker, so they measure the whole work and not only the part done in getLines
+    struct Document {
+        Document(std::string& text, LanguageMode mode) {
+            m_pieceTableInstance = new PieceTableInstance();
+            m_lineBuffer = new LineBuffer(m_pieceTableInstance);
+
+            m_pieceTableInstance->openText(text);
+            m_lineBuffer->setLanguageMode(mode);
+        }
+
+        ~Document() {
+            delete m_lineBuffer;
+            delete m_pieceTableInstance;
+        }
+
+        PieceTable& getTable() const { return m_pieceTableInstance->getInstance(); }
+
+        PieceTableInstance* m_pieceTableInstance;
+        LineBuffer* m_lineBuffer;
+    };
+
+    void pieceTableBenchmarks(BenchmarkRunner& runner, TextGenerator& generator) {
+        const size_t operations = 20000;
+        auto text = generator.generate(LanguageMode::Cpp, MB);
+
+        // Typing at the end of the document goes through the insert buffer
+        runner.run("piece_table/insert_char_sequential", operations, operations, [&](BenchmarkTimer& timer) {
+            PieceTable table(text);
+
+            timer.start();
+            for (size_t i=0; i<operations; ++i)
+                table.insertChar((char) ('a' + i % 26), table.getSize());
+            table.flushInsertBuffer();
+            timer.stop();
+        });
+
+        runner.run("piece_table/insert_sequential", operations, operations * 8, [&](BenchmarkTimer& timer) {
+            PieceTable table(text);
+
+            timer.start();
+            for (size_t i=0; i<operations; ++i)
+                table.insert("content\n", table.getSize());
+            timer.stop();
+        });
+
+        runner.run("piece_table/insert_random", operations, operations * 8, [&](BenchmarkTimer& timer) {
+            PieceTable table(text);
+            std::mt19937 random(1);
+
+            timer.start();
+            for (size_t i=0; i<operations; ++i)
+                table.insert("content\n", random() % (table.getSize() + 1));
+            timer.stop();
+        });
+
+        runner.run("piece_table/delete_random", operations, operations * 16, [&](BenchmarkTimer& timer) {
+            PieceTable table(text);
+            std::mt19937 random(2);
+
+            timer.start();
+            for (size_t i=0; i<operations; ++i) {
+                auto start = random() % (table.getSize() - 16);
+                table.deleteText(start, start + 16);
+            }
+            timer.stop();
+        });
+
+        runner.run("piece_table/backspace_sequential", operations, operations, [&](BenchmarkTimer& timer) {
+            PieceTable table(text);
+
+            timer.start();
+            for (size_t i=0; i<operations; ++i)
+                table.backspace(table.getSize() - i);
+            table.flushDeleteBuffer();
+            timer.stop();
+        });
+
+        // Random edits, then all of them undone and redone again
+        runner.run("piece_table/undo_redo_storm", operations * 2, 0, [&](BenchmarkTimer& timer) {
+            PieceTable table(text);
+            std::mt19937 random(3);
+
+            for (size_t i=0; i<operations / 2; ++i) {
+                table.insert("content\n", random() % (table.getSize() + 1));
+                auto start = random() % (table.getSize() - 16);
+                table.deleteText(start, start + 16);
+            }
+
+            timer.start();
+            while (!table.isUndoEmpty())
+                table.undo();
+            while (!table.isRedoEmpty())
+                table.redo();
+            timer.stop();
+        });
+    }
+
+    void getLinesBenchmarks(BenchmarkRunner& runner, TextGenerator& generator, size_t maxSize) {
+        const size_t sizes[] = {KB, MB, 16 * MB, 256 * MB, GB};
+        const BenchmarkLanguage* languagesToLoad[] = {&languages[0], &languages[1]};
+
+        for (auto language : languagesToLoad) {
+            for (auto size : sizes) {
+                auto name = std::string("get_lines/") + language->m_name + "/" + sizeName(size);
+
+                if (size > maxSize || !runner.isSelected(name))
+                    continue;
+
+                auto text = generator.generate(language->m_mode, size);
+
+                runner.run(name, 1, text.size(), [&](BenchmarkTimer& timer) {
+                    Document document(text, language->m_mode);
+
+                    timer.start();
+                    document.m_lineBuffer->finishHighlighting();
+                    timer.stop();
+                });
+            }
+        }
+    }
+
+    void highlightBenchmarks(BenchmarkRunner& runner, TextGenerator& generator) {
+        for (auto& language : languages) {
+            // Plain text isn't highlighted
+            if (language.m_mode == LanguageMode::PlainText)
+                continue;
+
+            auto name = std::string("highlight/") + language.m_name;
+
+            if (!runner.isSelected(name))
+                continue;
+
+            std::vector<std::string> lines;
+            size_t bytes = 0;
+
+            while (bytes < MB) {
+                lines.push_back(generator.generateLine(language.m_mode));
+                bytes += lines.back().size();
+            }
+
+            runner.run(name, lines.size(), bytes, [&](BenchmarkTimer& timer) {
+                timer.start();
+                for (auto& line : lines)
+                    TextHighlighter::getColorMap(line, language.m_mode);
+                timer.stop();
+            });
+        }
+    }
+
+    // An opening bracket added and removed at the top of the file moves every block under it
+    void foldBlockBenchmarks(BenchmarkRunner& runner, TextGenerator& generator) {
+        const size_t operations = 10;
+
+        if (!runner.isSelected("fold_blocks/toggle_bracket"))
+            return;
+
+        auto text = generator.generate(LanguageMode::Cpp, MB);
+
+        runner.run("fold_blocks/toggle_bracket", operations * 2, text.size() * operations * 2, [&](BenchmarkTimer& timer) {
+            Document document(text, LanguageMode::Cpp);
+            document.m_lineBuffer->finishHighlighting();
+
+            timer.start();
+            for (size_t i=0; i<operations; ++i) {
+                document.getTable().insert("{", 0);
+                document.m_lineBuffer->finishHighlighting();
+                document.getTable().deleteText(0, 1);
+                document.m_lineBuffer->finishHighlighting();
+            }
+            timer.stop();
+        });
+    }
+
+    // Typing in the middle of a file with the lines brought up to date after every key, like the editor does
+    void typingBenchmarks(BenchmarkRunner& runner, TextGenerator& generator, size_t maxSize) {
+        const size_t operations = 100;
+        const size_t sizes[] = {MB, 16 * MB};
+
+        for (auto size : sizes) {
+            auto name = "line_buffer/typing/" + sizeName(size);
+
+            if (size > maxSize || !runner.isSelected(name))
+                continue;
+
+            auto text = generator.generate(LanguageMode::Cpp, size);
+
+            runner.run(name, operations, operations, [&](BenchmarkTimer& timer) {
+                Document document(text, LanguageMode::Cpp);
+                document.m_lineBuffer->finishHighlighting();
+
+                auto index = text.size() / 2;
+
+                timer.start();
+                for (size_t i=0; i<operations; ++i) {
+                    document.getTable().insertChar((char) ('a' + i % 26), index + i);
+                    document.m_lineBuffer->finishHighlighting();
+                }
+                timer.stop();
+            });
+        }
+    }
+
+    // A comment opened in the middle of the file and closed again, the lines after it are highlighted
+    // until the next comment end
+    void commentBenchmarks(BenchmarkRunner& runner, TextGenerator& generator, size_t maxSize) {
+        const size_t operations = 100;
+        const size_t sizes[] = {MB, 16 * MB};
+
+        for (auto size : sizes) {
+            auto name = "line_buffer/toggle_comment/" + sizeName(size);
+
+            if (size > maxSize || !runner.isSelected(name))
+                continue;
+
+            auto text = generator.generate(LanguageMode::Cpp, size);
+
+            runner.run(name, operations * 2, operations * 4, [&](BenchmarkTimer& timer) {
+                Document document(text, LanguageMode::Cpp);
+                document.m_lineBuffer->finishHighlighting();
+
+                auto row = document.m_lineBuffer->getLinesSize() / 2;
+                auto index = document.getTable().getLineStart(row);
+
+                // The edited line is read back like the editor draws it, so removing the comment start
+                // can be checked for brackets
+                timer.start();
+                for (size_t i=0; i<operations; ++i) {
+                    document.getTable().insert("/*", index);
+                    document.m_lineBuffer->finishHighlighting();
+                    document.m_lineBuffer->lineAt(row);
+                    document.getTable().deleteText(index, index + 2);
+                    document.m_lineBuffer->finishHighlighting();
+                    document.m_lineBuffer->lineAt(row);
+                }
+                timer.stop();
+            });
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: %s [--filter <text>] [--max-size <bytes>[K|M|G]] [--repetitions <n>] [--output <file>]\n", argv[0]);
+        return 1;
+    }
+
+    BenchmarkRunner runner(options.m_filter, options.m_repetitions);
+    TextGenerator generator;
+
+    pieceTableBenchmarks(runner, generator);
+    getLinesBenchmarks(runner, generator, options.m_maxSize);
+    highlightBenchmarks(runner, generator);
+    foldBlockBenchmarks(runner, generator);
+    typingBenchmarks(runner, generator, options.m_maxSize);
+    commentBenchmarks(runner, generator, options.m_maxSize);
+
+    if (options.m_output.empty()) {
+        runner.writeJson(std::cout);
+        return 0;
+    }
+
+    std::ofstream output(options.m_output);
+    runner.writeJson(output);
+
+    return output.good() ? 0 : 1;
+}
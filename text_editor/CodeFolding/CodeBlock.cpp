@@ -27,9 +27,12 @@ bool CodeBlock::operator>(const CodeBlock &other) const {
     return m_start > other.m_start || (m_start == other.m_start && m_end > other.m_end);
 }
 
-CodeBlock::CodeBlock(TextCoordinates &start, TextCoordinates &end) : m_start(start), m_end(end), m_folded(false) {}
+CodeBlock::CodeBlock(TextCoordinates &start, TextCoordinates &end) : m_start(start), m_end(end), m_folded(false),
+    m_startAnchor(nullptr), m_endAnchor(nullptr) {}
 
-CodeBlock::CodeBlock(const CodeBlock& block) : m_start(block.m_start), m_end(block.m_end), m_folded(block.m_folded) {}
+// The copy doesn't share the anchors, they belong to the original
+CodeBlock::CodeBlock(const CodeBlock& block) : m_start(block.m_start), m_end(block.m_end), m_folded(block.m_folded),
+    m_startAnchor(nullptr), m_endAnchor(nullptr) {}
 
 CodeBlock::~CodeBlock() {}
 
@@ -39,12 +42,17 @@ const TextCoordinates &CodeBlock::getEnd() const { return m_end; }
 
 const bool CodeBlock::isFolded() const { return m_folded; }
 
+Anchor *CodeBlock::getStartAnchor() const { return m_startAnchor; }
+
+Anchor *CodeBlock::getEndAnchor() const { return m_endAnchor; }
+
 void CodeBlock::setStart(const TextCoordinates &start) { m_start = start; }
 
 void CodeBlock::setEnd(const TextCoordinates &end) { m_end = end; }
 
 void CodeBlock::setFolded(const bool folded) { m_folded = folded; }
 
-
-
-
+void CodeBlock::setAnchors(Anchor *startAnchor, Anchor *endAnchor) {
+    m_startAnchor = startAnchor;
+    m_endAnchor = endAnchor;
+}
@@ -6,6 +6,7 @@
 #define TEXT_EDITOR_CODEBLOCK_H
 
 #include "../GUI/TextCoordinates.h"
+#include "../PieceTable/AnchorTree.h"
 
 class CodeBlock {
 public:
@@ -23,14 +24,20 @@ public:
     const TextCoordinates& getStart() const;
     const TextCoordinates& getEnd() const;
     const bool isFolded() const;
+    Anchor* getStartAnchor() const;
+    Anchor* getEndAnchor() const;
 
     void setStart(const TextCoordinates& start);
     void setEnd(const TextCoordinates& end);
     void setFolded(const bool folded);
+    void setAnchors(Anchor* startAnchor, Anchor* endAnchor);
 private:
     TextCoordinates m_start;
     TextCoordinates m_end;
     bool m_folded;
+    // Anchors at the brackets, owned by whoever created the block. The coordinates are taken from them after edits
+    Anchor* m_startAnchor;
+    Anchor* m_endAnchor;
 };
 
 
@@ -0,0 +1,382 @@
+#include "EditJournal.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const std::chrono::milliseconds EditJournal::m_flushInterval(1000);
+const char EditJournal::m_magic[4] = {'J', 'E', 'T', 'J'};
+const uint32_t EditJournal::m_formatVersion = 1;
+
+namespace {
+    // Magic, version, file size and file time
+    const size_t headerSize = 4 + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t);
+    // Grouped flag, index, removed length and text length, followed by the text and the checksum
+    const size_t entryHeaderSize = 1 + 3 * sizeof(uint64_t);
+
+    template <typename T>
+    void appendValue(std::string& data, T value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T readValue(const char* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+}
+
+EditJournal::EditJournal(const PieceTable &table, const std::string &filePath)
+    : m_table(table), m_filePath(filePath), m_journalPath(getJournalPath(filePath)), m_validSize(0),
+      m_recovered(false), m_last({false, 0, 0, ""}), m_hasLast(false), m_runOpen(false), m_runIndex(0),
+      m_runTextLength(0), m_stopping(false), m_failed(false),
+#ifdef _WIN32
+      m_file(INVALID_HANDLE_VALUE)
+#else
+      m_file(-1)
+#endif
+{}
+
+// Writes what is still queued and keeps the journal, only discard removes it
+EditJournal::~EditJournal() {
+    stop();
+}
+
+// Applies the entries of a journal left behind by a crash to the table, which has to hold the file as it is on the disk.
+// A journal of another version of the file is removed. The entries are read until the first one
+// that is cut short or damaged, an entry belonging to the undo group of the one before it is applied together with it.
+// Returns the number of applied edits
+size_t EditJournal::recover(PieceTable &table) {
+    std::ifstream input(m_journalPath, std::ios::binary);
+    if (!input.is_open())
+        return 0;
+
+    char header[headerSize];
+    uint64_t fileSize;
+    int64_t fileTime;
+    fileStamp(fileSize, fileTime);
+
+    if (!input.read(header, headerSize) || std::memcmp(header, m_magic, 4) != 0 ||
+        readValue<uint32_t>(header + 4) != m_formatVersion ||
+        readValue<uint64_t>(header + 8) != fileSize || readValue<int64_t>(header + 16) != fileTime) {
+        input.close();
+        std::remove(m_journalPath.c_str());
+        return 0;
+    }
+
+    m_validSize = headerSize;
+    m_recovered = true;
+
+    size_t applied = 0;
+    Entry current = {false, 0, 0, ""};
+    auto hasCurrent = false;
+    auto size = table.getSize();
+
+    auto apply = [&]() {
+        if (hasCurrent && table.applyEdits({Edit{current.m_index, current.m_removedLength, std::move(current.m_text)}}))
+            ++applied;
+        hasCurrent = false;
+    };
+
+    std::string entryData;
+    char entryHeader[entryHeaderSize];
+
+    while (input.read(entryHeader, entryHeaderSize)) {
+        Entry next = {entryHeader[0] != 0, readValue<uint64_t>(entryHeader + 1), readValue<uint64_t>(entryHeader + 9), ""};
+        auto textLength = readValue<uint64_t>(entryHeader + 17);
+
+        // The size after the entry is applied, an entry that doesn't fit the text is damaged
+        auto sizeWithCurrent = size;
+        if (hasCurrent)
+            sizeWithCurrent = size - current.m_removedLength + current.m_text.size();
+        if (next.m_index > sizeWithCurrent || next.m_removedLength > sizeWithCurrent - next.m_index)
+            break;
+
+        next.m_text.resize(textLength);
+        uint32_t storedChecksum;
+
+        if (!input.read(&next.m_text[0], (std::streamsize) textLength) ||
+            !input.read(reinterpret_cast<char*>(&storedChecksum), sizeof(storedChecksum)))
+            break;
+
+        entryData.assign(entryHeader, entryHeaderSize);
+        entryData.append(next.m_text);
+        if (checksum(entryData.data(), entryData.size()) != storedChecksum)
+            break;
+
+        m_validSize += entryHeaderSize + textLength + sizeof(storedChecksum);
+
+        if (hasCurrent && next.m_grouped && continues(current.m_index, current.m_text.size(), next)) {
+            merge(current, next);
+            continue;
+        }
+
+        if (hasCurrent)
+            size = sizeWithCurrent;
+
+        apply();
+        current = std::move(next);
+        hasCurrent = true;
+    }
+
+    apply();
+    return applied;
+}
+
+// Opens the journal for appending, after the entries of a recovered one or as a new journal of the file
+// as it is on the disk, and starts the writer
+bool EditJournal::start() {
+    if (!openFile(!m_recovered))
+        return false;
+
+    if (!m_recovered) {
+        uint64_t fileSize;
+        int64_t fileTime;
+        fileStamp(fileSize, fileTime);
+
+        std::string header(m_magic, 4);
+        appendValue(header, m_formatVersion);
+        appendValue(header, fileSize);
+        appendValue(header, fileTime);
+
+        if (!appendToFile(header) || !syncFile()) {
+            closeFile();
+            std::remove(m_journalPath.c_str());
+            return false;
+        }
+    }
+
+    m_stopping = false;
+    m_writer = std::thread(&EditJournal::writeLoop, this);
+    return true;
+}
+
+// Stops journaling and removes the journal, its edits were saved or thrown away
+void EditJournal::discard() {
+    stop();
+    std::remove(m_journalPath.c_str());
+}
+
+// Merges typing and deleting into the last entry as long as the writer hasn't taken it
+void EditJournal::onTextChange(const TextChange &change) {
+    if (change.m_removedLength == 0 && change.m_insertedLength == 0)
+        return;
+
+    Entry next = {false, change.m_index, change.m_removedLength, m_table.getText(change.m_index, change.m_insertedLength)};
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_hasLast && continues(m_last.m_index, m_last.m_text.size(), next)) {
+        merge(m_last, next);
+        return;
+    }
+
+    if (m_hasLast)
+        serialize(m_last, m_pending);
+    else
+        next.m_grouped = m_runOpen && continues(m_runIndex, m_runTextLength, next);
+
+    m_last = std::move(next);
+    m_hasLast = true;
+    m_runOpen = false;
+}
+
+// The journal is stopped before its table is replaced
+void EditJournal::onTextReset() {}
+
+std::string EditJournal::getJournalPath(const std::string &filePath) { return filePath + ".journal"; }
+
+void EditJournal::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_wake.notify_one();
+
+    if (m_writer.joinable())
+        m_writer.join();
+
+    closeFile();
+}
+
+// Every m_flushInterval takes the queued entries and appends them to the journal, the last flush happens when stopping
+void EditJournal::writeLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wake.wait_for(lock, m_flushInterval, [this] { return m_stopping; });
+
+        if (m_hasLast) {
+            serialize(m_last, m_pending);
+            m_runOpen = true;
+            m_runIndex = m_last.m_index;
+            m_runTextLength = m_last.m_text.size();
+            m_last.m_text.clear();
+            m_hasLast = false;
+        }
+
+        std::string data;
+        data.swap(m_pending);
+        auto stopping = m_stopping;
+        lock.unlock();
+
+        // After a failed write the journal is left as it is, the entries written so far are still valid
+        if (!data.empty() && !m_failed && (!appendToFile(data) || !syncFile()))
+            m_failed = true;
+
+        if (stopping)
+            return;
+
+        lock.lock();
+    }
+}
+
+bool EditJournal::appendToFile(const std::string &data) {
+    auto current = data.data();
+    auto size = data.size();
+
+    while (size > 0) {
+#ifdef _WIN32
+        DWORD written;
+
+        if (!WriteFile(m_file, current, (DWORD) std::min<size_t>(size, 1u << 30), &written, nullptr))
+            return false;
+#else
+        auto written = ::write(m_file, current, size);
+
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+#endif
+
+        current += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+bool EditJournal::syncFile() {
+#ifdef _WIN32
+    return FlushFileBuffers(m_file) != 0;
+#else
+    return fsync(m_file) == 0;
+#endif
+}
+
+// Creates a new journal, or cuts a recovered one after its last valid entry
+bool EditJournal::openFile(bool truncate) {
+#ifdef _WIN32
+    m_file = CreateFileA(m_journalPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                         truncate ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+
+    if (!truncate) {
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG) m_validSize;
+        SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN);
+        SetEndOfFile(m_file);
+    }
+#else
+    m_file = ::open(m_journalPath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+    if (m_file == -1)
+        return false;
+
+    if (!truncate) {
+        if (ftruncate(m_file, (off_t) m_validSize) == -1) {
+            closeFile();
+            return false;
+        }
+
+        lseek(m_file, 0, SEEK_END);
+    }
+#endif
+
+    return true;
+}
+
+void EditJournal::closeFile() {
+#ifdef _WIN32
+    if (m_file == INVALID_HANDLE_VALUE)
+        return;
+
+    CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_file == -1)
+        return;
+
+    ::close(m_file);
+    m_file = -1;
+#endif
+}
+
+// Identifies the version of the file on the disk the entries apply to
+void EditJournal::fileStamp(uint64_t &size, int64_t &time) const {
+    std::error_code error;
+    size = std::filesystem::file_size(m_filePath, error);
+    if (error)
+        size = 0;
+
+    auto writeTime = std::filesystem::last_write_time(m_filePath, error);
+    time = error ? 0 : (int64_t) writeTime.time_since_epoch().count();
+}
+
+// Whether next continues the edit with textLength characters at index the way the insert and delete buffers
+// merge typing: inserting at the end of its text, deleting right before it, or deleting after it
+bool EditJournal::continues(size_t index, size_t textLength, const Entry &next) {
+    if (next.m_removedLength == 0)
+        return next.m_index == index + textLength;
+
+    if (!next.m_text.empty() || textLength != 0)
+        return false;
+
+    return next.m_index + next.m_removedLength == index || next.m_index == index;
+}
+
+void EditJournal::merge(Entry &entry, Entry &next) {
+    if (next.m_removedLength == 0) {
+        entry.m_text += next.m_text;
+        return;
+    }
+
+    entry.m_index = std::min(entry.m_index, next.m_index);
+    entry.m_removedLength += next.m_removedLength;
+}
+
+void EditJournal::serialize(const Entry &entry, std::string &data) {
+    auto start = data.size();
+
+    data.push_back(entry.m_grouped ? 1 : 0);
+    appendValue<uint64_t>(data, entry.m_index);
+    appendValue<uint64_t>(data, entry.m_removedLength);
+    appendValue<uint64_t>(data, entry.m_text.size());
+    data.append(entry.m_text);
+    appendValue(data, checksum(data.data() + start, data.size() - start));
+}
+
+// FNV-1a, enough to tell an entry that was only partly written
+uint32_t EditJournal::checksum(const char *data, size_t size) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i=0; i<size; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
@@ -0,0 +1,91 @@
+#ifndef TEXT_EDITOR_EDITJOURNAL_H
+#define TEXT_EDITOR_EDITJOURNAL_H
+
+#include "PieceTable/PieceTable.h"
+#include "PieceTable/TextChangeListener.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Appends every change of a piece table to a journal next to its file, so the unsaved edits survive a crash.
+// The journal starts with the size and the modification time of the file it applies to, followed by
+// one entry per change: the replaced range, the inserted text and a checksum. Typing is merged into one entry
+// the way the insert buffer merges it into one undo action, an entry that continues a run of typing which
+// was already written is marked as part of the same undo group. The UI thread only queues the entries,
+// a writer thread appends them and syncs the journal every m_flushInterval.
+class EditJournal : public TextChangeListener {
+public:
+    EditJournal(const PieceTable& table, const std::string& filePath);
+    ~EditJournal() override;
+
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    size_t recover(PieceTable& table);
+    bool start();
+    void discard();
+
+    void onTextChange(const TextChange& change) override;
+    void onTextReset() override;
+
+    static std::string getJournalPath(const std::string& filePath);
+private:
+    struct Entry {
+        bool m_grouped;
+        size_t m_index;
+        size_t m_removedLength;
+        std::string m_text;
+    };
+
+    void stop();
+    void writeLoop();
+    bool appendToFile(const std::string& data);
+    bool syncFile();
+    bool openFile(bool truncate);
+    void closeFile();
+    void fileStamp(uint64_t& size, int64_t& time) const;
+
+    static bool continues(size_t index, size_t textLength, const Entry& next);
+    static void merge(Entry& entry, Entry& next);
+    static void serialize(const Entry& entry, std::string& data);
+    static uint32_t checksum(const char* data, size_t size);
+
+    // How often the queued entries are written and synced, a crash loses at most this much of the editing
+    static const std::chrono::milliseconds m_flushInterval;
+    static const char m_magic[4];
+    static const uint32_t m_formatVersion;
+
+    const PieceTable& m_table;
+    std::string m_filePath;
+    std::string m_journalPath;
+    // Where the valid entries of a recovered journal end, new entries are appended from there
+    size_t m_validSize;
+    bool m_recovered;
+
+    // Shared with the writer thread
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::string m_pending;
+    Entry m_last;
+    bool m_hasLast;
+    // The last entry the writer took, a change continuing it still belongs to its undo group
+    bool m_runOpen;
+    size_t m_runIndex;
+    size_t m_runTextLength;
+    bool m_stopping;
+    bool m_failed;
+    std::thread m_writer;
+
+#ifdef _WIN32
+    void* m_file;
+#else
+    int m_file;
+#endif
+};
+
+
+#endif //TEXT_EDITOR_EDITJOURNAL_H
@@ -3,6 +3,8 @@
 //
 
 #include "File.h"
+#include "AtomicFileWriter.h"
+#include "PieceTable/PieceTable.h"
 
 File::File(std::string filePath) : m_path(filePath) {
     m_name = filePath.substr(filePath.find_last_of("\\\\") + 1);
@@ -58,33 +60,46 @@ bool File::readFromFile(std::string &buffer, const std::string &filePath) {
     return true;
 }
 
-bool File::writeToFile(std::string& buffer, const std::string &filePath) {
-    std::string backupBuffer;
-    readFromFile(backupBuffer, filePath);
+// Returns the size of the file in bytes, or 0 if it can't be read
+size_t File::getFileSize(const std::string &filePath) {
+    std::ifstream input(filePath, std::ios::binary | std::ios::ate);
 
-    std::ofstream output(filePath);
-    if (!output.is_open())
-        return false;
+    if (!input.is_open())
+        return 0;
 
-    try {
-        output << buffer;
-    } catch (std::exception& e) {
-        std::cerr << e.what() << std::endl;
-        output.close();
+    auto size = input.tellg();
+    return size < 0 ? 0 : (size_t) size;
+}
 
-        std::ofstream backupOutput(filePath);
-        backupOutput << backupBuffer;
-        backupOutput.close();
+bool File::writeToFile(const std::string& buffer, const std::string &filePath) {
+    AtomicFileWriter writer(filePath);
+    return writer.open() && writer.write(buffer.data(), buffer.size()) && writer.commit();
+}
+
+// Streams the table chunk by chunk into a temporary file that then replaces the old one,
+// so neither the old nor the new text is ever held in memory as a whole
+bool File::writeToFile(const PieceTable &table, const std::string &filePath) {
+    AtomicFileWriter writer(filePath);
 
+    if (!writer.open())
         return false;
+
+    for (auto it = table.chunkBegin(); !it.isEnd(); ++it) {
+        auto chunk = *it;
+
+        if (!writer.write(chunk.data(), chunk.size()))
+            return false;
     }
 
-    output.close();
-    return true;
+    return writer.commit();
 }
 
 std::string File::getWorkingDirectory() {
+#ifdef _WIN32
     char* cwd = _getcwd( 0, 0 ) ; // **** microsoft specific ****
+#else
+    char* cwd = getcwd( 0, 0 ) ;
+#endif
     std::string working_directory(cwd) ;
     std::free(cwd) ;
     return working_directory ;
@@ -10,9 +10,16 @@
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <direct.h>
 #include <unordered_map>
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+class PieceTable;
+
 class File {
 public:
     explicit File(std::string filePath);
@@ -24,10 +31,13 @@ public:
 
     static LanguageMode getModeForExtension(const std::string& extension);
     static bool readFromFile(std::string& buffer, const std::string& filePath);
-    static bool writeToFile(std::string& buffer, const std::string& filePath);
+    static size_t getFileSize(const std::string& filePath);
+    static bool writeToFile(const std::string& buffer, const std::string& filePath);
+    static bool writeToFile(const PieceTable& table, const std::string& filePath);
     static std::string getWorkingDirectory();
     static std::string getProjectDirectory();
 private:
+
     std::string m_path;
     std::string m_name;
     std::string m_extension;
@@ -0,0 +1,108 @@
+#include "FileLoader.h"
+#include "File.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+const size_t FileLoader::m_mappingThreshold = 64 * 1024 * 1024;
+const size_t FileLoader::m_blockSize = 1024 * 1024;
+
+FileLoader::FileLoader(const std::string &filePath)
+    : m_filePath(filePath), m_buffer(new OriginalBuffer()), m_fileSize(0),
+      m_state(State::Preparing), m_loadedSize(0), m_cancelled(false) {
+    m_thread = std::thread(&FileLoader::load, this);
+}
+
+FileLoader::~FileLoader() {
+    cancel();
+}
+
+// Stops the loading and waits for the thread, the part loaded so far stays in the buffer
+void FileLoader::cancel() {
+    m_cancelled = true;
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+// Hands the buffer over once the loader isn't preparing it anymore. The loader keeps writing into it,
+// so the buffer has to stay alive until the loader is done or cancelled
+OriginalBuffer *FileLoader::takeBuffer() { return m_buffer.release(); }
+
+FileLoader::State FileLoader::getState() const { return m_state.load(std::memory_order_acquire); }
+
+size_t FileLoader::getLoadedSize() const { return m_loadedSize.load(std::memory_order_acquire); }
+
+// The size of the file on the disk, known once the loader isn't preparing anymore
+size_t FileLoader::getFileSize() const { return m_fileSize; }
+
+void FileLoader::load() {
+    m_fileSize = File::getFileSize(m_filePath);
+    auto loaded = m_fileSize >= m_mappingThreshold && map();
+
+    if (!loaded)
+        loaded = read();
+
+    m_state.store(loaded && !m_cancelled ? State::Loaded : State::Failed, std::memory_order_release);
+}
+
+// Maps the file and touches its pages in order, so the UI thread doesn't wait for the disk when it reads them
+bool FileLoader::map() {
+    if (!m_buffer->map(m_filePath))
+        return false;
+
+    auto data = m_buffer->data();
+    m_fileSize = m_buffer->size();
+
+#ifdef _WIN32
+    // Files are read in text mode on Windows, which turns \r\n into \n, so those still get read
+    if (std::memchr(data, '\r', m_fileSize) != nullptr) {
+        m_buffer.reset(new OriginalBuffer());
+        return false;
+    }
+#endif
+
+    m_state.store(State::Loading, std::memory_order_release);
+
+    volatile char touched = 0;
+    size_t pageSize = 4096;
+
+    for (size_t start = 0; start < m_fileSize && !m_cancelled; start += m_blockSize) {
+        auto end = std::min(start + m_blockSize, m_fileSize);
+
+        for (auto page = start; page < end; page += pageSize)
+            touched = touched + data[page];
+
+        m_loadedSize.store(end, std::memory_order_release);
+    }
+
+    return true;
+}
+
+// Reads the file block by block into a buffer of the file's size
+bool FileLoader::read() {
+    std::ifstream input(m_filePath);
+
+    if (!input.is_open())
+        return false;
+
+    auto data = m_buffer->allocate(m_fileSize);
+    m_state.store(State::Loading, std::memory_order_release);
+
+    size_t loadedSize = 0;
+
+    // Text mode can make a block shorter than what was asked for, so only the count that was read matters
+    while (loadedSize < m_fileSize && !m_cancelled) {
+        input.read(data + loadedSize, (std::streamsize) std::min(m_blockSize, m_fileSize - loadedSize));
+        auto count = (size_t) input.gcount();
+
+        if (count == 0)
+            break;
+
+        loadedSize += count;
+        m_loadedSize.store(loadedSize, std::memory_order_release);
+    }
+
+    return !input.bad();
+}
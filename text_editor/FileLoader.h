@@ -0,0 +1,57 @@
+#ifndef TEXT_EDITOR_FILELOADER_H
+#define TEXT_EDITOR_FILELOADER_H
+
+#include "PieceTable/OriginalBuffer.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Loads a file into an OriginalBuffer on a background thread. Big files are mapped and their pages
+// touched in order, smaller ones are read block by block into a buffer that never moves. The loaded
+// size only grows, and every byte before it can be read from the UI thread while the rest is still loading.
+// A cancelled load ends as failed.
+class FileLoader {
+public:
+    enum class State {
+        // The buffer isn't ready yet
+        Preparing,
+        Loading,
+        Loaded,
+        Failed
+    };
+
+    explicit FileLoader(const std::string& filePath);
+    ~FileLoader();
+
+    FileLoader(const FileLoader&) = delete;
+    FileLoader& operator=(const FileLoader&) = delete;
+
+    void cancel();
+    OriginalBuffer* takeBuffer();
+
+    State getState() const;
+    size_t getLoadedSize() const;
+    size_t getFileSize() const;
+private:
+    void load();
+    bool map();
+    bool read();
+
+    // Files at least this big are mapped into memory instead of being read
+    static const size_t m_mappingThreshold;
+    // How much is read, or touched in a mapping, before the loaded size is updated
+    static const size_t m_blockSize;
+
+    std::string m_filePath;
+    std::unique_ptr<OriginalBuffer> m_buffer;
+    size_t m_fileSize;
+    std::atomic<State> m_state;
+    std::atomic<size_t> m_loadedSize;
+    std::atomic<bool> m_cancelled;
+    std::thread m_thread;
+};
+
+
+#endif //TEXT_EDITOR_FILELOADER_H
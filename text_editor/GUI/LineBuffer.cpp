@@ -5,126 +5,312 @@
 #include "LineBuffer.h"
 
 std::string LineBuffer::m_emptyLine;
-std::vector<ThemeColor> LineBuffer::m_emptyMap;
-
-LineBuffer::LineBuffer(PieceTableInstance *pieceTableInstance) : m_pieceTableInstance(pieceTableInstance), m_mode(LanguageMode::PlainText) {
-    m_lines = new std::vector<std::string>();
-    m_colorMap = new std::vector<std::vector<ThemeColor>>();
+ColorMap LineBuffer::m_emptyMap;
+const size_t LineBuffer::m_lineCacheCapacity = 2048;
+const size_t LineBuffer::m_syncHighlightLines = 256;
+
+LineBuffer::LineBuffer(PieceTableInstance *pieceTableInstance)
+    : m_charSize(0), m_lineCount(1), m_longestLine(0), m_longestLineLength(0), m_longestLineKnown(false),
+    m_pieceTableInstance(pieceTableInstance), m_mode(LanguageMode::PlainText),
+    m_reset(true), m_loading(false), m_bracketsChanged(false), m_changed(false), m_dirtyStart(0), m_dirtyEnd(0),
+    m_highlighter(nullptr), m_highlightRequest(0), m_highlightVersion(0), m_visibleStart(0), m_visibleEnd(0),
+    m_blocksStart(0), m_blocksEnd(0), m_movedStart(std::string::npos), m_movedEnd(0) {
+    m_colorMap = new std::vector<ColorMap>();
     m_blocks = new std::vector<CodeBlock*>();
     m_hidden = new std::vector<bool>();
+
+    m_pieceTableInstance->addListener(this);
 }
 
 LineBuffer::~LineBuffer() {
-    delete m_lines;
+    m_pieceTableInstance->removeListener(this);
+
+    delete m_highlighter;
+    clearBlocks();
+
+    delete m_colorMap;
     delete m_blocks;
     delete m_hidden;
 }
 
-// Turns PieceTable data into lines.
-void LineBuffer::getLines(int lineIndex) {
-    // Set up a string stream and load the PieceTable data into it
-    std::stringstream stream;
-    stream << m_pieceTableInstance->getInstance();
-    // Turn the string stream into a std::string
-    std::string textBuffer = stream.str();
+// Updates the cached lines, colors and blocks for the rows touched by the change and shifts everything after them
+void LineBuffer::onTextChange(const TextChange &change) {
+    auto& table = m_pieceTableInstance->getInstance();
+    bool highlighted = m_mode != LanguageMode::PlainText;
 
-    // Save the old size
-    int oldSize = m_lines->size();
-    // Clear the previous lines
-    m_lines->clear();
+    // An empty text still has one (empty) line to edit
+    auto oldLineCount = m_lineCount;
+    m_lineCount = table.getLineCount();
+    m_charSize = m_charSize + change.m_insertedLength - change.m_removedLength;
 
-    auto it = textBuffer.begin();
+    // Everything gets loaded again anyway
+    if (m_reset) {
+        clearLineCache();
+        m_longestLineKnown = false;
+        return;
+    }
 
-    while (it != textBuffer.end()) {
-        // Find the newline in the buffer
-        auto newLine = std::find(it, textBuffer.end(), '\n');
-        // Adds the substring starting from the current iterator unitl the newline character
-        m_lines->push_back(textBuffer.substr(it-textBuffer.begin(), newLine-it));
+    m_changed = true;
 
-        // If we have reached the end of the buffer we break
-        if (newLine == textBuffer.end())
-            break;
+    // The text before the change is the same as before, so the piece table can tell us where it starts
+    auto [row, column] = table.getLineAndColumn(change.m_index);
+
+    // The line index knows how many line breaks were inserted, the inserted text isn't copied out of the table
+    auto insertedLineBreaks = table.getLineAndColumn(change.m_index + change.m_insertedLength).first - row;
+
+    // The change replaced the rows [row, endRow] with the rows [row, newEndRow]
+    auto endRow = row + oldLineCount + insertedLineBreaks - m_lineCount;
+    auto newEndRow = row + insertedLineBreaks;
+
+    if (insertedBracket(change.m_index, change.m_insertedLength) || removedBracket(row, column, change.m_removedLength))
+        m_bracketsChanged = true;
+
+    updateLineCache(row, endRow, newEndRow);
+    updateLongestLine(row, endRow, newEndRow);
+
+    if (highlighted) {
+        if (m_colorMap->empty()) {
+            m_colorMap->emplace_back();
+            m_endsInComment.push_back(false);
+            m_hidden->push_back(false);
+        }
+
+        // The end state of the old last row stays on the new last row, so the highlighting can tell
+        // whether the rows after the change start the same way as before
+        if (newEndRow > endRow) {
+            m_colorMap->insert(m_colorMap->begin() + endRow + 1, newEndRow - endRow, ColorMap());
+            m_endsInComment.insert(m_endsInComment.begin() + row, newEndRow - endRow, false);
+            m_hidden->insert(m_hidden->begin() + endRow + 1, newEndRow - endRow, false);
+        } else {
+            m_colorMap->erase(m_colorMap->begin() + newEndRow + 1, m_colorMap->begin() + endRow + 1);
+            m_endsInComment.erase(m_endsInComment.begin() + row, m_endsInComment.begin() + row + (endRow - newEndRow));
+            m_hidden->erase(m_hidden->begin() + newEndRow + 1, m_hidden->begin() + endRow + 1);
+        }
+
+        // The blocks move with the anchors at their brackets, the ones on the changed rows take their coordinates
+        // from them in getLines. Only the changed rows can hold moved blocks, unless lines were added or removed
+        m_movedStart = std::min(m_movedStart, row);
+        m_movedEnd = newEndRow != endRow ? std::string::npos : std::max(m_movedEnd, endRow);
+
+        markDirty(m_dirtyStart, m_dirtyEnd, row, endRow, newEndRow);
+        markDirty(m_blocksStart, m_blocksEnd, row, endRow, newEndRow);
+    }
+
+    // An empty text has no lines
+    if (m_charSize == 0) {
+        m_colorMap->clear();
+        m_endsInComment.clear();
+        m_hidden->clear();
+        m_dirtyStart = m_dirtyEnd = 0;
+        m_bracketsChanged = true;
+    }
+}
+
+// The piece table was replaced, the lines cached from the old one are gone
+void LineBuffer::onTextReset() {
+    auto& table = m_pieceTableInstance->getInstance();
 
-        // If the last character in the buffer is a newLine add another line at the end
-        if (std::next(newLine) == textBuffer.end())
-            m_lines->push_back("");
+    m_reset = true;
+    m_charSize = table.getTextSize();
+    m_lineCount = table.getLineCount();
+    m_longestLineKnown = false;
+    clearLineCache();
+}
+
+// Brings the lines, colors and blocks up to date with the PieceTable
+void LineBuffer::getLines() {
+    if (m_reset) {
+        loadLines();
+        m_reset = false;
+    }
+
+    // While a file is loading only the lines that arrived are highlighted. The blocks need the whole text,
+    // so they are matched once when it is loaded instead of after every part
+    if (m_pieceTableInstance->isLoading()) {
+        m_loading = true;
+        m_hidden->resize(getLinesSize(), false);
+
+        if (m_mode != LanguageMode::PlainText)
+            updateColorMap();
+
+        return;
+    }
 
-        //We jump over the newline char and iterate to the next.
-        it = std::next(newLine);
+    if (m_loading) {
+        m_loading = false;
+        m_bracketsChanged = true;
+        m_blocksStart = 0;
+        m_blocksEnd = getLinesSize();
     }
 
+    updateBlockCoordinates();
+
     if (m_mode != LanguageMode::PlainText) {
         updateColorMap();
-        updateBlocks(m_lines->size()-oldSize, lineIndex);
+
+        if (m_changed || m_bracketsChanged)
+            updateBlocks();
     }
-    updateCharSize();
+
+    m_changed = false;
+    m_bracketsChanged = false;
 }
 
-// Updates the vector of hidden lines with the new state of the block
-void LineBuffer::updateHiddenForBlock(CodeBlock *block) {
-    writeInHidden(block);
-
-    // If we have unfolded a block that has folded blocks inside it
-    // we need to keep those lines hidden
-    if (!block->isFolded()) {
-        // We find the current block
-        auto index = findBlock(block);
-
-        // If we found it we iterate through blocks inside it
-        if (index != -1) {
-            index++;
-            while (index < m_blocks->size() && m_blocks->at(index)->getStart().m_row <= block->getEnd().m_row) {
-                writeInHidden(m_blocks->at(index));
-                index++;
-            }
-        }
+// Waits until every line is highlighted, for the tools that don't draw frames
+void LineBuffer::finishHighlighting() {
+    getLines();
+
+    while (m_highlightRequest != 0) {
+        m_highlighter->waitForResults();
+        getLines();
     }
 }
 
+// Updates the vector of hidden lines with the new state of the block. The folded blocks inside an unfolded
+// one keep their lines hidden, and so do the folded ones around a block that gets unfolded
+void LineBuffer::updateHiddenForBlock(CodeBlock *block) {
+    updateHiddenRows(block->getStart().m_row + 1, std::min(block->getEnd().m_row + 1, m_hidden->size()));
+}
+
 void LineBuffer::clearBlocks() {
     for (auto block : *m_blocks)
-        delete block;
+        deleteBlock(block);
 
     m_blocks->clear();
+    clearUnmatchedBrackets();
 }
 
-size_t LineBuffer::textCoordinatesToBufferIndex(const TextCoordinates &coords) const {
-    size_t index = 0;
+// The line editing operations take zero based rows. The TextBox and the TraceReplayer both edit the lines through
+// them, so a replayed trace makes the same piece table calls as the editor did
 
-    for (size_t i=0; i<coords.m_row-1; i++)
-        index += lineAt(i).size() + 1;
+// Adds a tab in front of the rows [beginRow, endRow], the empty rows after the first one are left alone. The tabs are
+// inserted as one batch, which is a single undo step. Returns whether tabs were added
+bool LineBuffer::addTabs(size_t beginRow, size_t endRow) {
+    auto& table = m_pieceTableInstance->getInstance();
+    std::vector<Edit> edits;
 
-    index += (coords.m_col - 1);
+    auto index = table.getLineStart(beginRow);
+    edits.push_back({index, 0, "\t"});
 
-    return index;
+    for (size_t i=beginRow; i<endRow; ++i) {
+        index += getLineLength(i) + 1;
+        if (getLineLength(i+1) != 0)
+            edits.push_back({index, 0, "\t"});
+    }
+
+    return table.applyEdits(edits);
 }
 
-TextCoordinates LineBuffer::bufferIndexToTextCoordinates(const size_t& index) {
-    size_t row = 1;
-    size_t col = 1;
+// Deletes a tab from the start of the rows [beginRow, endRow] that have one, as a single undo step.
+// Returns whether tabs were deleted
+bool LineBuffer::removeTabs(size_t beginRow, size_t endRow) {
+    auto& table = m_pieceTableInstance->getInstance();
+    std::vector<Edit> edits;
 
-    if (isEmpty())
-        return {row, col};
+    auto index = table.getLineStart(beginRow);
 
-    size_t acc = 0;
-    while (row-1 < m_lines->size() && acc + m_lines->at(row-1).size() < index) {
-        acc += m_lines->at(row-1).size() + 1;
-        ++row;
+    for (size_t i=beginRow; i<=endRow; ++i) {
+        if (lineStarsWithTab(i))
+            edits.push_back({index, 1, ""});
+
+        index += getLineLength(i) + 1;
     }
 
-    col += index - acc;
+    return !edits.empty() && table.applyEdits(edits);
+}
+
+// Deletes the tab at the start of the row if there is one. Returns whether it was deleted
+bool LineBuffer::removeTab(size_t row) {
+    if (!lineStarsWithTab(row))
+        return false;
+
+    auto index = m_pieceTableInstance->getInstance().getLineStart(row);
+    m_pieceTableInstance->getInstance().deleteText(index, index + 1);
 
-    return {row, col};
+    return true;
 }
 
-std::string& LineBuffer::lineAt(size_t index) const {
-    if (index < m_lines->size())
-        return m_lines->at(index);
-    else
+// Deletes the row together with its line break, the last row keeps the line break before it.
+// Returns the length of the deleted line
+size_t LineBuffer::deleteLine(size_t row) {
+    auto index = m_pieceTableInstance->getInstance().getLineStart(row);
+    auto length = getLineLength(row);
+    auto offset = length;
+
+    if (row + 1 != getLinesSize())
+        offset++;
+
+    m_pieceTableInstance->getInstance().deleteText(index, index + offset);
+
+    return length;
+}
+
+// Converts coordinates to a buffer index using the line index of the piece table
+size_t LineBuffer::textCoordinatesToBufferIndex(const TextCoordinates &coords) const {
+    return m_pieceTableInstance->getInstance().getLineStart(coords.m_row-1) + (coords.m_col - 1);
+}
+
+TextCoordinates LineBuffer::bufferIndexToTextCoordinates(const size_t& index) {
+    if (isEmpty())
+        return {1, 1};
+
+    auto [line, column] = m_pieceTableInstance->getInstance().getLineAndColumn(index);
+
+    return {line + 1, column + 1};
+}
+
+// Returns the line from the cache, reading it from the piece table if it isn't there. The reference stays valid
+// until the line is changed or m_lineCacheCapacity other lines are read after it
+const std::string& LineBuffer::lineAt(size_t index) const {
+    if (index >= getLinesSize())
         return m_emptyLine;
+
+    auto cached = m_lineCacheIndex.find(index);
+    if (cached != m_lineCacheIndex.end()) {
+        m_lineCache.splice(m_lineCache.begin(), m_lineCache, cached->second);
+        return cached->second->second;
+    }
+
+    if (m_lineCache.size() == m_lineCacheCapacity) {
+        m_lineCacheIndex.erase(m_lineCache.back().first);
+        m_lineCache.pop_back();
+    }
+
+    m_lineCache.emplace_front(index, readLine(index));
+    m_lineCacheIndex[index] = m_lineCache.begin();
+
+    return m_lineCache.front().second;
+}
+
+// The length comes from the line index of the piece table, so the line doesn't have to be read
+size_t LineBuffer::getLineLength(size_t index) const {
+    if (index >= getLinesSize())
+        return 0;
+
+    auto cached = m_lineCacheIndex.find(index);
+    if (cached != m_lineCacheIndex.end())
+        return cached->second->second.size();
+
+    auto& table = m_pieceTableInstance->getInstance();
+
+    auto start = table.getLineStart(index);
+    auto end = index + 1 < m_lineCount ? table.getLineStart(index + 1) - 1 : table.getTextSize();
+
+    return end - start;
 }
 
-std::vector<ThemeColor> &LineBuffer::getColorMap(size_t index) const {
+// Returns the row of the line with the most characters
+size_t LineBuffer::getLongestLine() const {
+    if (isEmpty())
+        return 0;
+
+    if (!m_longestLineKnown)
+        findLongestLine();
+
+    return m_longestLine;
+}
+
+ColorMap &LineBuffer::getColorMap(size_t index) const {
     if (index < m_colorMap->size())
         return m_colorMap->at(index);
     else
@@ -174,106 +360,403 @@ const size_t LineBuffer::getRowsShowing(size_t lineIndex) const {
 }
 
 bool LineBuffer::lineStarsWithTab(const size_t lineIndex) const {
-    if (isEmpty() || lineIndex >= getLinesSize() || m_lines->at(lineIndex).empty())
+    if (isEmpty() || lineIndex >= getLinesSize() || lineAt(lineIndex).empty())
         return false;
     else
-        return m_lines->at(lineIndex).at(0) == '\t';
+        return lineAt(lineIndex).at(0) == '\t';
 }
 
 bool LineBuffer::isPlainText() const { return m_mode == LanguageMode::PlainText; }
 
-const size_t LineBuffer::getLinesSize() const { return m_lines->size(); }
+// An empty text has no lines
+const size_t LineBuffer::getLinesSize() const { return m_charSize == 0 ? 0 : m_lineCount; }
 
 const size_t LineBuffer::getCharSize() const { return m_charSize; }
 
 const LanguageMode LineBuffer::getLanguageMode() const { return m_mode; }
 
-bool LineBuffer::isEmpty() const { return m_lines->empty(); }
+bool LineBuffer::isEmpty() const { return m_charSize == 0; }
+
+bool LineBuffer::isLoading() const { return m_loading; }
 
-void LineBuffer::setLanguageMode(const LanguageMode mode) { m_mode = mode; }
+void LineBuffer::setLanguageMode(const LanguageMode mode) {
+    if (mode == m_mode)
+        return;
 
-void LineBuffer::updateCharSize() {
-    m_charSize = std::accumulate(m_lines->begin(), m_lines->end(), (size_t) 0, [](size_t acc, std::string& line) { return  acc + line.size() + 1; });
-    if (m_charSize != 0)
-        m_charSize -= 1;
+    m_mode = mode;
+    // The colors of every line change with the language
+    m_reset = true;
 }
 
-void LineBuffer::updateColorMap() {
+void LineBuffer::setVisibleLines(size_t start, size_t end) {
+    m_visibleStart = start;
+    m_visibleEnd = end;
+}
+
+// Starts over from the whole PieceTable text, the lines themselves are read when they are needed
+void LineBuffer::loadLines() {
+    auto& table = m_pieceTableInstance->getInstance();
+
+    m_charSize = table.getTextSize();
+    m_lineCount = table.getLineCount();
+    m_longestLineKnown = false;
+    m_changed = true;
+    clearLineCache();
+    cancelHighlighting();
+
+    // Everything has to be highlighted and matched again
     m_colorMap->clear();
+    m_endsInComment.clear();
+
+    if (m_mode != LanguageMode::PlainText) {
+        m_colorMap->resize(getLinesSize());
+        m_endsInComment.resize(getLinesSize(), false);
+        m_hidden->assign(getLinesSize(), false);
+        m_dirtyStart = 0;
+        m_dirtyEnd = getLinesSize();
+        m_blocksStart = 0;
+        m_blocksEnd = getLinesSize();
+        m_bracketsChanged = true;
+    } else {
+        clearBlocks();
+        m_hidden->clear();
+    }
+}
+
+// Highlights the dirty lines, each one knowing whether the line before it ended inside a multiline comment.
+// The lines after them are highlighted only until one ends the same way as it did before, from there on
+// every line starts like it did when it was highlighted. A few lines, like the one being typed in, are highlighted
+// right away and the rest is left to the worker
+void LineBuffer::updateColorMap() {
+    applyHighlightResults();
+
+    m_dirtyEnd = std::min(m_dirtyEnd, getLinesSize());
+
+    if (m_dirtyStart >= m_dirtyEnd) {
+        m_dirtyStart = m_dirtyEnd = 0;
+        cancelHighlighting();
+        return;
+    }
+
+    // The worker already has this version of the text
+    if (m_highlightRequest != 0 && m_highlightVersion == m_pieceTableInstance->getInstance().getVersion())
+        return;
+
+    highlightLines(m_syncHighlightLines);
+
+    if (m_dirtyStart == m_dirtyEnd)
+        cancelHighlighting();
+    else
+        requestHighlighting();
+}
+
+// Highlights at most count lines from the first dirty one
+void LineBuffer::highlightLines(size_t count) {
+    bool insideComment = m_dirtyStart > 0 && m_endsInComment[m_dirtyStart - 1];
+
+    forEachLine(m_dirtyStart, getLinesSize(), [&](size_t row, std::string& line) {
+        auto colorMap = TextHighlighter::getColorMap(line, m_mode, insideComment);
+        return setHighlightedLine(row, colorMap, insideComment) && --count != 0;
+    });
+}
+
+// Keeps the colors of the first dirty line and moves the dirty range past it. Returns whether the lines after it
+// still have to be highlighted
+bool LineBuffer::setHighlightedLine(size_t row, ColorMap &colorMap, bool endsInComment) {
+    bool changed = m_endsInComment[row] != endsInComment;
+
+    m_colorMap->at(row) = std::move(colorMap);
+    m_endsInComment[row] = endsInComment;
+
+    if (row + 1 >= m_dirtyEnd && (!changed || row + 1 == getLinesSize())) {
+        m_dirtyStart = m_dirtyEnd = 0;
+        return false;
+    }
+
+    // The next line starts differently than it did, so it is highlighted even if it didn't change
+    m_dirtyStart = row + 1;
+    m_dirtyEnd = std::max(m_dirtyEnd, row + 2);
+
+    return true;
+}
+
+// Gives the worker the dirty lines of the current version of the text
+void LineBuffer::requestHighlighting() {
+    auto& table = m_pieceTableInstance->getInstance();
 
-    for (std::string& line : *m_lines) {
-        m_colorMap->push_back(TextHighlighter::getColorMap(line, m_mode));
+    if (m_highlighter == nullptr)
+        m_highlighter = new HighlightWorker();
+
+    HighlightRequest request = {table.snapshot(), m_mode, m_dirtyStart, m_dirtyEnd, m_visibleStart, m_visibleEnd,
+                                m_endsInComment};
+
+    m_highlightRequest = m_highlighter->request(std::move(request));
+    m_highlightVersion = table.getVersion();
+}
+
+// Takes the lines the worker highlighted. The ones highlighted for an older version of the text are dropped,
+// a preview only gives colors to the lines that are still dirty
+void LineBuffer::applyHighlightResults() {
+    if (m_highlightRequest == 0)
+        return;
+
+    auto version = m_pieceTableInstance->getInstance().getVersion();
+
+    for (auto& result : m_highlighter->takeResults()) {
+        if (result.m_request != m_highlightRequest || result.m_version != version)
+            continue;
+
+        if (result.m_preview) {
+            for (size_t i=0; i<result.m_colorMaps.size(); ++i) {
+                auto row = result.m_start + i;
+
+                if (m_dirtyStart != m_dirtyEnd && row >= m_dirtyStart && row < m_colorMap->size())
+                    m_colorMap->at(row) = std::move(result.m_colorMaps[i]);
+            }
+        } else if (result.m_start == m_dirtyStart && m_dirtyStart != m_dirtyEnd) {
+            for (size_t i=0; i<result.m_colorMaps.size(); ++i) {
+                if (!setHighlightedLine(result.m_start + i, result.m_colorMaps[i], result.m_endsInComment[i]))
+                    break;
+            }
+        }
+    }
+
+    if (m_dirtyStart == m_dirtyEnd)
+        m_highlightRequest = 0;
+}
+
+void LineBuffer::cancelHighlighting() {
+    if (m_highlightRequest == 0)
+        return;
+
+    m_highlighter->cancel();
+    m_highlightRequest = 0;
+}
+
+// Matches the brackets on the changed rows again if any of them changed and updates which of those rows are hidden
+void LineBuffer::updateBlocks() {
+    auto start = m_blocksStart;
+    auto end = std::min(m_blocksEnd, getLinesSize());
+
+    m_blocksStart = m_blocksEnd = 0;
+
+    if (isEmpty()) {
+        clearBlocks();
+        return;
     }
 
-    markMultilineComments();
+    if (start >= end)
+        return;
+
+    if (m_bracketsChanged)
+        matchBrackets(start, end);
+
+    updateHiddenRows(start, end);
 }
 
-void LineBuffer::updateBlocks(int lineSizeDiff, int lineIndex) {
-    auto newBlocks = new std::vector<CodeBlock*>();
-    std::stack<TextCoordinates> openBrackets;
-    auto size = m_lines->size();
+// A pair of brackets only depends on the text between them, so only the blocks that reach the changed rows [start, end)
+// can pair differently. They are matched again together with every bracket on their rows, and so are the rows up to
+// the brackets that had no pair, as the change can give them one. The rows are widened to the ones matched again
+void LineBuffer::matchBrackets(size_t &start, size_t &end) {
+    auto& table = m_pieceTableInstance->getInstance();
+    auto& anchors = m_pieceTableInstance->getAnchors();
+    auto rowOf = [&](Anchor* anchor) { return table.getLineAndColumn(anchors.getIndex(anchor)).first; };
+
+    auto changedStart = start;
+    auto changedEnd = end;
+
+    for (auto block : *m_blocks) {
+        if (block->getStart().m_row >= changedEnd)
+            break;
+
+        if (block->getEnd().m_row >= changedStart) {
+            start = std::min(start, block->getStart().m_row);
+            end = std::max(end, block->getEnd().m_row + 1);
+        }
+    }
+
+    for (auto anchor : m_unmatchedOpenings) {
+        auto row = rowOf(anchor);
+        if (row < changedEnd)
+            start = std::min(start, row);
+    }
+
+    for (auto anchor : m_unmatchedClosings) {
+        auto row = rowOf(anchor);
+        if (row >= changedStart)
+            end = std::max(end, row + 1);
+    }
+
+    end = std::min(end, getLinesSize());
+
+    auto inside = [&](size_t row) { return row >= start && row < end; };
+    auto removeInside = [&](std::vector<Anchor*>& unmatched) {
+        unmatched.erase(std::remove_if(unmatched.begin(), unmatched.end(), [&](Anchor* anchor) {
+            if (!inside(rowOf(anchor)))
+                return false;
+
+            anchors.remove(anchor);
+            return true;
+        }), unmatched.end());
+    };
+
+    removeInside(m_unmatchedOpenings);
+    removeInside(m_unmatchedClosings);
+
+    // The blocks going over the edge of the rows keep their pair, their brackets on the rows are skipped
+    auto keptBlocks = new std::vector<CodeBlock*>();
+    std::vector<CodeBlock*> oldBlocks;
+    std::unordered_set<size_t> keptBrackets;
+
+    for (auto block : *m_blocks) {
+        bool startInside = inside(block->getStart().m_row);
+        bool endInside = inside(block->getEnd().m_row);
+
+        if (startInside && endInside) {
+            oldBlocks.push_back(block);
+            continue;
+        }
+
+        keptBlocks->push_back(block);
 
-    if (lineSizeDiff != 0)
-        updateFoldedBlocks(lineSizeDiff, lineIndex);
+        if (startInside)
+            keptBrackets.insert(anchors.getIndex(block->getStartAnchor()));
+        if (endInside)
+            keptBrackets.insert(anchors.getIndex(block->getEndAnchor()));
+    }
 
-    auto oldHidden = m_hidden;
-    m_hidden = new std::vector<bool>(size, false);
-    delete oldHidden;
+    std::vector<CodeBlock*> newBlocks;
+    // Coordinates and buffer indices of the open brackets
+    std::stack<std::pair<TextCoordinates, size_t>> openBrackets;
+    size_t lineStart = table.getLineStart(start);
 
-    for (size_t i=0; i<size; ++i) {
-        auto line = m_lines->at(i);
+    forEachLine(start, end, [&](size_t i, std::string& line) {
+        for (auto j = line.find_first_of("{}"); j != std::string::npos; j = line.find_first_of("{}", j+1)) {
+            if (!keptBrackets.empty() && keptBrackets.count(lineStart + j) != 0)
+                continue;
 
-        for (size_t j=0; j<line.size(); ++j) {
             if (line[j] == '{') {
-                openBrackets.push(TextCoordinates(i, j+1));
-            } else if (line[j] == '}' && !openBrackets.empty()) {
-                auto openBracket = openBrackets.top();
+                openBrackets.push({TextCoordinates(i, j+1), lineStart + j});
+            } else if (!openBrackets.empty()) {
+                auto [openBracket, openIndex] = openBrackets.top();
                 openBrackets.pop();
 
                 auto closedBracket = TextCoordinates(i, j+1);
                 auto block = new CodeBlock(openBracket, closedBracket);
 
+                // Text typed right before a bracket pushes it forward, so the anchors stick to the right
+                block->setAnchors(anchors.create(openIndex, AnchorGravity::Right),
+                                  anchors.create(lineStart + j, AnchorGravity::Right));
+
+                // Blocks were moved along with the text, so folded ones can be found again
                 auto index = findBlock(block);
 
-                if (index != -1 && m_blocks->at(index)->isFolded() == true) {
+                if (index != -1 && m_blocks->at(index)->isFolded() == true)
                     block->setFolded(true);
-                    updateHiddenForBlock(block);
-                }
 
-                newBlocks->push_back(block);
+                newBlocks.push_back(block);
+            } else {
+                m_unmatchedClosings.push_back(anchors.create(lineStart + j, AnchorGravity::Right));
             }
         }
-    }
 
-    auto oldBlocks = m_blocks;
-    m_blocks = newBlocks;
+        lineStart += line.size() + 1;
+        return true;
+    });
 
-    for (auto block : *oldBlocks)
-        delete block;
-    delete oldBlocks;
+    for (; !openBrackets.empty(); openBrackets.pop())
+        m_unmatchedOpenings.push_back(anchors.create(openBrackets.top().second, AnchorGravity::Right));
 
-    std::sort(m_blocks->begin(), m_blocks->end(), [](CodeBlock* first, CodeBlock* second) { return *first < *second; });
+    for (auto block : oldBlocks)
+        deleteBlock(block);
+
+    // The kept blocks are still sorted, the new ones are merged into them
+    std::sort(newBlocks.begin(), newBlocks.end(), [](CodeBlock* first, CodeBlock* second) { return *first < *second; });
+
+    auto middle = keptBlocks->size();
+    keptBlocks->insert(keptBlocks->end(), newBlocks.begin(), newBlocks.end());
+    std::inplace_merge(keptBlocks->begin(), keptBlocks->begin() + middle, keptBlocks->end(),
+                       [](CodeBlock* first, CodeBlock* second) { return *first < *second; });
+
+    delete m_blocks;
+    m_blocks = keptBlocks;
 }
 
-void LineBuffer::updateFoldedBlocks(int lineSizeDiff, int lineIndex) {
-    if (lineIndex == -1)
+// The rows [start, end) are hidden when a folded block covers them
+void LineBuffer::updateHiddenRows(size_t start, size_t end) {
+    std::fill(m_hidden->begin() + start, m_hidden->begin() + end, false);
+
+    for (auto block : *m_blocks) {
+        if (block->getStart().m_row >= end)
+            break;
+
+        if (!block->isFolded() || block->getEnd().m_row < start)
+            continue;
+
+        auto first = std::max(start, block->getStart().m_row + 1);
+        auto last = std::min(end, block->getEnd().m_row + 1);
+
+        if (first < last)
+            std::fill(m_hidden->begin() + first, m_hidden->begin() + last, true);
+    }
+}
+
+// Takes the coordinates of the blocks on the rows that changed since the last call from their anchors
+void LineBuffer::updateBlockCoordinates() {
+    if (m_movedStart > m_movedEnd)
         return;
 
-    if (lineSizeDiff < 0)
-        lineIndex -= lineSizeDiff;
+    auto& table = m_pieceTableInstance->getInstance();
+    auto& anchors = m_pieceTableInstance->getAnchors();
 
-    auto index = findGreaterOrEqualBlock(lineIndex);
+    auto moved = [this](const TextCoordinates& coords) { return coords.m_row >= m_movedStart && coords.m_row <= m_movedEnd; };
+    auto anchorCoordinates = [&](Anchor* anchor) -> TextCoordinates {
+        auto [row, column] = table.getLineAndColumn(anchors.getIndex(anchor));
+        return {row, column + 1};
+    };
 
-    while (index != -1 && index < m_blocks->size()) {
-        auto block = m_blocks->at(index);
+    for (auto block : *m_blocks) {
+        if (moved(block->getStart()))
+            block->setStart(anchorCoordinates(block->getStartAnchor()));
+        if (moved(block->getEnd()))
+            block->setEnd(anchorCoordinates(block->getEndAnchor()));
+    }
 
-        if (block->isFolded()) {
-            block->setStart({block->getStart().m_row + lineSizeDiff, block->getStart().m_col});
-            block->setEnd({block->getEnd().m_row + lineSizeDiff, block->getEnd().m_col});
-        }
+    m_movedStart = std::string::npos;
+    m_movedEnd = 0;
+}
 
-        ++index;
+void LineBuffer::deleteBlock(CodeBlock *block) {
+    m_pieceTableInstance->getAnchors().remove(block->getStartAnchor());
+    m_pieceTableInstance->getAnchors().remove(block->getEndAnchor());
+    delete block;
+}
+
+void LineBuffer::clearUnmatchedBrackets() {
+    for (auto anchor : m_unmatchedOpenings)
+        m_pieceTableInstance->getAnchors().remove(anchor);
+    for (auto anchor : m_unmatchedClosings)
+        m_pieceTableInstance->getAnchors().remove(anchor);
+
+    m_unmatchedOpenings.clear();
+    m_unmatchedClosings.clear();
+}
+
+// Adds the rows [row, newEndRow] to the dirty range, after they replaced the rows [row, endRow]
+void LineBuffer::markDirty(size_t &dirtyStart, size_t &dirtyEnd, size_t row, size_t endRow, size_t newEndRow) {
+    if (dirtyStart == dirtyEnd) {
+        dirtyStart = row;
+        dirtyEnd = newEndRow + 1;
+        return;
     }
+
+    if (dirtyStart > endRow)
+        dirtyStart = dirtyStart - endRow + newEndRow;
+    if (dirtyEnd > endRow + 1)
+        dirtyEnd = dirtyEnd - endRow + newEndRow;
+
+    dirtyStart = std::min(dirtyStart, row);
+    dirtyEnd = std::max(dirtyEnd, newEndRow + 1);
 }
 
 // Code from https://www.geeksforgeeks.org/cpp-binary-search/
@@ -307,93 +790,169 @@ int LineBuffer::findBlock(CodeBlock *block) {
     return -1;
 }
 
-// Finds the index of the first block that is greater or equal to the line number, or returns -1 if there are none
-int LineBuffer::findGreaterOrEqualBlock(size_t lineIndex) {
-    int result = -1;
+// The longest line moves with the rows after the change and the new rows can only make it longer. If the change
+// went through the longest line it has to be searched for again
+void LineBuffer::updateLongestLine(size_t row, size_t endRow, size_t newEndRow) {
+    if (!m_longestLineKnown)
+        return;
 
-    int low = 0;
-    int high = m_blocks->size()-1;
-    int mid;
+    if (m_longestLine >= row && m_longestLine <= endRow) {
+        m_longestLineKnown = false;
+        return;
+    }
 
-    while (low <= high) {
-        mid = low + (high - low) / 2;
+    if (m_longestLine > endRow)
+        m_longestLine = m_longestLine - endRow + newEndRow;
 
-        if (m_blocks->at(mid)->getStart().m_row >= lineIndex) {
-            result = mid;
-            high = mid-1;
-        } else {
-            low = mid+1;
-        }
+    // Measuring a lot of pasted lines one by one is slower than a single pass over the text
+    if (newEndRow - row >= m_lineCacheCapacity) {
+        m_longestLineKnown = false;
+        return;
     }
 
-    return result;
-}
+    for (auto i = row; i <= newEndRow; ++i) {
+        auto length = getLineLength(i);
 
-// Fills the block lines of the hidden vector with the value of isFolded()
-void LineBuffer::writeInHidden(CodeBlock *block) {
-    std::fill(m_hidden->begin() + block->getStart().m_row + 1, m_hidden->begin() + block->getEnd().m_row + 1,
-              block->isFolded());
+        if (length > m_longestLineLength) {
+            m_longestLine = i;
+            m_longestLineLength = length;
+        }
+    }
 }
 
-// Marks the occurrence of multiline comments
-void LineBuffer::markMultilineComments() {
-    bool insideComment = false;
-    // Get start and end
-    const std::string& multilineCommentStart = LanguageManager::getLanguage(m_mode)->getMultiLineCommentStart();
-    const std::string& multilineCommentEnd = LanguageManager::getLanguage(m_mode)->getMultiLineCommentEnd();
+// Goes through the text once, only looking for the line breaks
+void LineBuffer::findLongestLine() const {
+    auto& table = m_pieceTableInstance->getInstance();
+    size_t row = 0;
+    size_t length = 0;
 
-    size_t rowIndex = 0;
-    size_t columnIndex = 0;
+    m_longestLine = 0;
+    m_longestLineLength = 0;
 
-    // Go through text
-    while (rowIndex < m_lines->size()) {
-        std::string& line = m_lines->at(rowIndex);
-        std::vector<ThemeColor>& colorMap = m_colorMap->at(rowIndex);
+    for (auto it = table.chunkBegin(); !it.isEnd(); ++it) {
+        auto chunk = *it;
 
-        if (insideComment) {
-            auto start = line.find(multilineCommentEnd, columnIndex);
+        while (!chunk.empty()) {
+            auto lineBreak = chunk.find('\n');
 
-            // if found comment end
-            if (start != std::string::npos) {
-                auto newColumnIndex = start + multilineCommentEnd.size();
-                // mark everything in the line until the end
-                std::fill(colorMap.begin() + columnIndex, colorMap.begin() + newColumnIndex, ThemeColor::CommentColor);
-                // move the column index after the comment end
-                columnIndex = newColumnIndex;
-                insideComment = false;
-            } else {
-                // Mark everything in the line as a comment and move to the next row
-                std::fill(colorMap.begin() + columnIndex, colorMap.end(), ThemeColor::CommentColor);
-                ++rowIndex;
-                columnIndex = 0;
+            if (lineBreak == std::string_view::npos) {
+                length += chunk.size();
+                break;
             }
-        } else {
-            // Look for the comment start
-            auto start = line.find(multilineCommentStart, columnIndex);
-
-            // If found and not inside a string
-            if (start != std::string::npos && colorMap[start] != ThemeColor::StringColor && colorMap[start] != ThemeColor::CommentColor) {
-                    auto newColumnIndex =  start + multilineCommentStart.size();
-                    // color the comment start tag
-                    std::fill(colorMap.begin() + start, colorMap.begin() + newColumnIndex, ThemeColor::CommentColor);
-                    // move the column after the comment start
-                    columnIndex = newColumnIndex;
-                    insideComment = true;
-            } else {
-                // if not found move to the next row
-                ++rowIndex;
-                columnIndex = 0;
+
+            length += lineBreak;
+            if (length > m_longestLineLength) {
+                m_longestLine = row;
+                m_longestLineLength = length;
             }
+
+            ++row;
+            length = 0;
+            chunk.remove_prefix(lineBreak + 1);
         }
     }
+
+    if (length > m_longestLineLength) {
+        m_longestLine = row;
+        m_longestLineLength = length;
+    }
+
+    m_longestLineKnown = true;
 }
 
+// Reads the line straight from the piece table, without the cache
+std::string LineBuffer::readLine(size_t index) const {
+    auto& table = m_pieceTableInstance->getInstance();
 
+    auto start = table.getLineStart(index);
+    auto end = index + 1 < m_lineCount ? table.getLineStart(index + 1) - 1 : table.getTextSize();
 
+    return table.getText(start, end - start);
+}
 
+// Calls the callback with the lines [start, end) until it returns false. The passes over the whole text use it,
+// so they don't push the shown lines out of the cache
+void LineBuffer::forEachLine(size_t start, size_t end, const std::function<bool(size_t, std::string&)>& callback) const {
+    readLines(m_pieceTableInstance->getInstance(), start, end, callback);
+}
 
+// Looks for a bracket in the inserted text [index, index + length), going over the chunks of the table until it finds one
+bool LineBuffer::insertedBracket(size_t index, size_t length) const {
+    auto& table = m_pieceTableInstance->getInstance();
 
+    for (auto it = table.chunkAt(index); length != 0 && !it.isEnd(); ++it) {
+        auto chunk = *it;
 
+        // The first chunk can start before the inserted text
+        if (it.getOffset() < index)
+            chunk.remove_prefix(index - it.getOffset());
 
+        auto size = std::min(length, chunk.size());
+        if (containsBracket(chunk, 0, size))
+            return true;
 
+        length -= size;
+    }
+
+    return false;
+}
+
+// Looks for a bracket in the removed text in the lines cached before the change, if they aren't all there
+// a bracket could have been removed
+bool LineBuffer::removedBracket(size_t row, size_t column, size_t length) const {
+    while (length != 0) {
+        auto cached = m_lineCacheIndex.find(row);
+        if (cached == m_lineCacheIndex.end())
+            return true;
+
+        auto& line = cached->second->second;
+        if (column > line.size())
+            return true;
+
+        auto available = line.size() - column;
+        if (containsBracket(line, column, std::min(length, available)))
+            return true;
+        if (length <= available)
+            return false;
+
+        length -= available + 1;
+        ++row;
+        column = 0;
+    }
+
+    return false;
+}
 
+// Drops the cached rows [row, endRow] that were replaced by the rows [row, newEndRow] and renumbers the ones after them
+void LineBuffer::updateLineCache(size_t row, size_t endRow, size_t newEndRow) {
+    for (auto it = m_lineCache.begin(); it != m_lineCache.end();) {
+        if (it->first >= row && it->first <= endRow) {
+            m_lineCacheIndex.erase(it->first);
+            it = m_lineCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (endRow == newEndRow)
+        return;
+
+    m_lineCacheIndex.clear();
+
+    for (auto it = m_lineCache.begin(); it != m_lineCache.end(); ++it) {
+        if (it->first > endRow)
+            it->first = it->first - endRow + newEndRow;
+
+        m_lineCacheIndex[it->first] = it;
+    }
+}
+
+void LineBuffer::clearLineCache() {
+    m_lineCache.clear();
+    m_lineCacheIndex.clear();
+}
+
+bool LineBuffer::containsBracket(std::string_view text, size_t start, size_t length) {
+    auto end = text.begin() + start + length;
+    return std::find_if(text.begin() + start, end, [](char c) { return c == '{' || c == '}'; }) != end;
+}
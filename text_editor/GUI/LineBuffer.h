@@ -6,27 +6,51 @@
 #define TEXT_EDITOR_LINEBUFFER_H
 
 #include "../CodeFolding/CodeBlock.h"
+#include "../PieceTable/LineReader.h"
 #include "../PieceTable/PieceTableInstance.h"
 #include "TextCoordinates.h"
+#include "../SyntaxHiglighting/HighlightWorker.h"
 #include "../SyntaxHiglighting/TextHighlighter.h"
 
+#include <functional>
+#include <list>
 #include <numeric>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
-class LineBuffer {
+// Shows the text of the PieceTable as lines together with their colors and code blocks. The lines aren't
+// copied, they are read through the line index of the PieceTable when they are needed and the recently
+// used ones (the shown lines and the ones around the cursor) are kept in a small cache. Edits are applied
+// as they are reported by the PieceTable, so only the lines they touch get highlighted again. Small changes are
+// highlighted right away, bigger ones by a HighlightWorker whose results are taken in getLines.
+class LineBuffer : public TextChangeListener {
 public:
     LineBuffer(PieceTableInstance* pieceTableInstance);
-    ~LineBuffer();
+    ~LineBuffer() override;
 
-    void getLines(int lineIndex = -1);
+    void onTextChange(const TextChange& change) override;
+    void onTextReset() override;
+
+    void getLines();
+    void finishHighlighting();
     void updateHiddenForBlock(CodeBlock* block);
+    void forEachLine(size_t start, size_t end, const std::function<bool(size_t, std::string&)>& callback) const;
     void clearBlocks();
 
+    bool addTabs(size_t beginRow, size_t endRow);
+    bool removeTabs(size_t beginRow, size_t endRow);
+    bool removeTab(size_t row);
+    size_t deleteLine(size_t row);
+
     size_t textCoordinatesToBufferIndex(const TextCoordinates& coords) const;
     TextCoordinates bufferIndexToTextCoordinates(const size_t& index);
 
-    std::string& lineAt(size_t index) const;
-    std::vector<ThemeColor>& getColorMap(size_t index) const;
+    const std::string& lineAt(size_t index) const;
+    size_t getLineLength(size_t index) const;
+    size_t getLongestLine() const;
+    ColorMap& getColorMap(size_t index) const;
     const std::vector<CodeBlock*>& getBlocks() const;
     const std::vector<bool>& getHidden() const;
     const size_t getRowsShowing(size_t lineIndex) const;
@@ -36,30 +60,91 @@ public:
     const size_t getCharSize() const;
     const LanguageMode getLanguageMode() const;
     bool isEmpty() const;
+    bool isLoading() const;
 
 
     void setLanguageMode(const LanguageMode mode);
+    void setVisibleLines(size_t start, size_t end);
 private:
-    void updateCharSize();
+    void loadLines();
     void updateColorMap();
-    void updateBlocks(int lineSizeDiff, int lineIndex);
-    void updateFoldedBlocks(int lineSizeDiff, int lineIndex);
+    void highlightLines(size_t count);
+    bool setHighlightedLine(size_t row, ColorMap& colorMap, bool endsInComment);
+    void requestHighlighting();
+    void applyHighlightResults();
+    void cancelHighlighting();
+    void updateBlocks();
+    void matchBrackets(size_t& start, size_t& end);
+    void updateHiddenRows(size_t start, size_t end);
+    void updateBlockCoordinates();
+    void deleteBlock(CodeBlock* block);
+    void clearUnmatchedBrackets();
+    static void markDirty(size_t& dirtyStart, size_t& dirtyEnd, size_t row, size_t endRow, size_t newEndRow);
 
     int findBlock(CodeBlock* block);
-    int findGreaterOrEqualBlock(size_t lineIndex);
-    void writeInHidden(CodeBlock* block);
 
-    void markMultilineComments();
+
+    std::string readLine(size_t index) const;
+    bool insertedBracket(size_t index, size_t length) const;
+    bool removedBracket(size_t row, size_t column, size_t length) const;
+    void updateLineCache(size_t row, size_t endRow, size_t newEndRow);
+    void clearLineCache();
+    void updateLongestLine(size_t row, size_t endRow, size_t newEndRow);
+    void findLongestLine() const;
+
+    static bool containsBracket(std::string_view text, size_t start, size_t length);
 
     static std::string m_emptyLine;
-    static std::vector<ThemeColor> m_emptyMap;
+    static ColorMap m_emptyMap;
+    static const size_t m_lineCacheCapacity;
+    // At most this many lines are highlighted in getLines, the rest is left to the worker
+    static const size_t m_syncHighlightLines;
     size_t m_charSize;
-    std::vector<std::string>* m_lines;
-    std::vector<std::vector<ThemeColor>>* m_colorMap;
+    // Lines of the text as the PieceTable counts them, an empty text has one
+    size_t m_lineCount;
+    // The cached lines with their rows, the most recently used first
+    mutable std::list<std::pair<size_t, std::string>> m_lineCache;
+    mutable std::unordered_map<size_t, std::list<std::pair<size_t, std::string>>::iterator> m_lineCacheIndex;
+    // The row of the longest line and its length. It is kept up to date with the edits and only searched for
+    // again when the longest line itself is changed
+    mutable size_t m_longestLine;
+    mutable size_t m_longestLineLength;
+    mutable bool m_longestLineKnown;
+    std::vector<ColorMap>* m_colorMap;
     std::vector<CodeBlock*>* m_blocks;
     std::vector<bool>* m_hidden;
+    // Whether each line ends inside a multiline comment, as it did when the line was last highlighted
+    std::vector<bool> m_endsInComment;
     PieceTableInstance* m_pieceTableInstance;
     LanguageMode m_mode;
+    // The lines have to be loaded from the whole text again
+    bool m_reset;
+    // Lines were added while a file was loading, their comments and blocks weren't matched yet
+    bool m_loading;
+    // A bracket was added or removed, so the blocks have to be matched again
+    bool m_bracketsChanged;
+    // The text changed since the last getLines
+    bool m_changed;
+    // Lines in [m_dirtyStart, m_dirtyEnd) have to be highlighted again
+    size_t m_dirtyStart;
+    size_t m_dirtyEnd;
+    // Created when it gets the first request. m_highlightRequest is the id of the request it is working on
+    // for m_highlightVersion of the text, 0 if there is none
+    HighlightWorker* m_highlighter;
+    size_t m_highlightRequest;
+    size_t m_highlightVersion;
+    // The shown lines, the worker highlights them first
+    size_t m_visibleStart;
+    size_t m_visibleEnd;
+    // Rows in [m_blocksStart, m_blocksEnd) changed since the blocks were last updated
+    size_t m_blocksStart;
+    size_t m_blocksEnd;
+    // Anchors at the brackets that didn't get a pair. A change can pair them with a bracket far away from them
+    std::vector<Anchor*> m_unmatchedOpenings;
+    std::vector<Anchor*> m_unmatchedClosings;
+    // Blocks on the rows in [m_movedStart, m_movedEnd] may have moved since their coordinates were set
+    size_t m_movedStart;
+    size_t m_movedEnd;
 };
 
 
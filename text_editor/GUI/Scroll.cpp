@@ -61,13 +61,9 @@ void Scroll::updateMaxScroll(float& width, float& height) {
 
 void Scroll::updateMaxXScroll(float& width) {
     ImGui::PushFont(m_font->getFont());
-    float maxAdvance = 0.0f;
 
-    for (size_t i=0; i< m_lineBuffer->getLinesSize(); ++i) {
-        auto advance = m_cursor->getXAdvance(m_lineBuffer->lineAt(i));
-        if (advance > maxAdvance)
-            maxAdvance = advance;
-    }
+    // Only the line with the most characters is measured instead of every line
+    auto maxAdvance = m_cursor->getXAdvance(m_lineBuffer->lineAt(m_lineBuffer->getLongestLine()));
 
     m_maxXScroll = std::max(0.0f, maxAdvance-width);
     ImGui::PopFont();
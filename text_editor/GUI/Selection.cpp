@@ -72,7 +72,7 @@ std::string Selection::getSelectionText() {
     TextCoordinates it = m_start.getCoords();
 
     // Get the pointer to the starting line
-    std::string* line = &m_lineBuffer->lineAt(it.m_row-1);
+    const std::string* line = &m_lineBuffer->lineAt(it.m_row-1);
 
     // Iterate until we reach the end of the selection
     while (it < m_end.getCoords()) {
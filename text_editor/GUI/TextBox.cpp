@@ -5,13 +5,9 @@
 #include "TextBox.h"
 #include <utility>
 
+// The instance is shared with the other text box, so it belongs to the TextEditor and has to outlive the box
 TextBox::TextBox(float width, float height, const std::string& fontName, PieceTableInstance* instance)
-    : m_dirty(false) {
-
-    if (instance == nullptr)
-        m_pieceTableInstance = new PieceTableInstance();
-    else
-        m_pieceTableInstance = instance;
+    : m_pieceTableInstance(instance), m_dirty(false) {
 
     m_lineBuffer = new LineBuffer(m_pieceTableInstance);
     m_cursor = new Cursor(m_lineBuffer);
@@ -27,13 +23,13 @@ TextBox::TextBox(float width, float height, const std::string& fontName, PieceTa
 }
 
 TextBox::~TextBox() {
+    delete m_traceWriter;
     delete m_scroll;
     delete m_font;
     delete m_selection;
     delete m_writeSelection;
     delete m_cursor;
     delete m_lineBuffer;
-    delete m_pieceTableInstance;
 }
 
 // Draws the textBox based on PieceTable data.
@@ -53,14 +49,19 @@ void TextBox::draw() {
     ImGui::PushFont(m_font->getFont());
 
     auto lineHeight = ImGui::GetFontSize();
+    auto xScroll = m_scroll->getXScroll();
+    auto yScroll = m_scroll->getYScroll();
+
+    // The shown lines get highlighted first and the colors the worker finished are taken every frame
+    auto firstLine = (size_t) (yScroll / lineHeight);
+    m_lineBuffer->setVisibleLines(firstLine, firstLine + (size_t) (m_height / lineHeight) + 1);
+    m_lineBuffer->getLines();
+
     auto linesSize = m_lineBuffer->getLinesSize();
     auto blocks = m_lineBuffer->getBlocks();
     auto hidden = m_lineBuffer->getHidden();
     auto currentBlockIndex = 0;
 
-    auto xScroll = m_scroll->getXScroll();
-    auto yScroll = m_scroll->getYScroll();
-
     // Define the current line rectangle
     auto lineRect = MyRectangle(currentPosition, {currentPosition.x + m_width, currentPosition.y + lineHeight});
 
@@ -69,14 +70,14 @@ void TextBox::draw() {
     auto textBoxRect = MyRectangle(textBoxTopLeft, {textBoxTopLeft.x + m_width, textBoxTopLeft.y + m_height});
 
     for (size_t i=0; i<linesSize; ++i) {
-        // Get the line
-        auto line = m_lineBuffer->lineAt(i);
-
         // Draw background rectangle
         drawRectangle(currentPosition, lineHeight);
 
         // If the line is inside the text box, draw it
         if (MyRectangle::areRectanglesIntersecting(textBoxRect, lineRect)) {
+            // Get the line, only the shown ones are read from the piece table
+            auto line = m_lineBuffer->lineAt(i);
+
             // Add a clip rectangle
             auto bottomRight = ImVec2(currentPosition.x + m_width, std::min(currentPosition.y + lineHeight + 2.0f,
                                                                             cursorScreenPosition.y + m_height));
@@ -123,6 +124,7 @@ void TextBox::draw() {
 
 // Enters single character in the pieceTable and updates the state of the text box
 void TextBox::enterChar(char c) {
+    auto trace = traceOperation(TraceOperation::EnterChar, c);
     updateUndoRedo();
     deleteSelection();
 
@@ -133,7 +135,7 @@ void TextBox::enterChar(char c) {
     if (initialized)
         m_cursor->recordCursorPosition();
 
-    updateStateForTextChange(true, 1, m_cursor->getRow());
+    updateStateForTextChange(true, 1);
 
     m_cursor->moveRight();
     updateStateForCursorMovement();
@@ -141,6 +143,7 @@ void TextBox::enterChar(char c) {
 
 // Enters a text in the piece table and updates the state of the text box
 void TextBox::enterText(std::string str) {
+    auto trace = traceOperation(TraceOperation::EnterText, 0, &str);
     updateUndoRedo();
     deleteSelection();
 
@@ -153,7 +156,7 @@ void TextBox::enterText(std::string str) {
     size_t index = m_lineBuffer->textCoordinatesToBufferIndex(coords);
     m_pieceTableInstance->getInstance().insert(std::move(str), index);
 
-    updateStateForTextChange(true, size, m_cursor->getRow());
+    updateStateForTextChange(true, size);
 
     auto newCoords = m_lineBuffer->bufferIndexToTextCoordinates(index + size);
     m_cursor->setCoords(newCoords);
@@ -163,6 +166,7 @@ void TextBox::enterText(std::string str) {
 
 // Preforms a backspace operation on the piece table and updates the state of the text box
 void TextBox::backspace() {
+    auto trace = traceOperation(TraceOperation::Backspace);
     auto deleted = deleteSelection();
 
     if (deleted) {
@@ -179,7 +183,7 @@ void TextBox::backspace() {
         if (initialized)
             m_cursor->recordCursorPosition();
 
-        updateStateForTextChange(false, 1, m_cursor->getRow());
+        updateStateForTextChange(false, 1);
 
         m_cursor->moveLeft();
 
@@ -189,6 +193,8 @@ void TextBox::backspace() {
 
 // Handles all the cases for the tab and tab + shift commands
 void TextBox::tab(bool shift) {
+    auto trace = traceOperation(TraceOperation::Tab, 0, nullptr, shift);
+
     updateUndoRedo();
 
     // Event flags
@@ -231,7 +237,7 @@ void TextBox::tab(bool shift) {
     }
 
     if (changed)
-        updateStateForTextChange(!cursorMovedLeft, 1, m_cursor->getRow());
+        updateStateForTextChange(!cursorMovedLeft, 1);
     if (cursorMovedLeft)
         m_cursor->moveLeft();
     if (cursorMovedRight)
@@ -242,6 +248,7 @@ void TextBox::tab(bool shift) {
 
 // Deletes the char right of the cursor if there is one
 void TextBox::deleteChar() {
+    auto trace = traceOperation(TraceOperation::DeleteChar);
     auto deleted = deleteSelection();
 
     if (deleted) {
@@ -258,11 +265,12 @@ void TextBox::deleteChar() {
         if (initialized)
             m_cursor->recordCursorPosition();
 
-        updateStateForTextChange(false, 1, m_cursor->getRow());
+        updateStateForTextChange(false, 1);
     }
 }
 
 void TextBox::deleteLine() {
+    auto trace = traceOperation(TraceOperation::DeleteLine);
     updateUndoRedo();
     m_pieceTableInstance->getInstance().flushInsertBuffer();
     m_pieceTableInstance->getInstance().flushDeleteBuffer();
@@ -273,16 +281,10 @@ void TextBox::deleteLine() {
     }
 
     auto row = m_cursor->getRow();
-    auto line = m_lineBuffer->lineAt(row-1);
-    auto index = m_lineBuffer->textCoordinatesToBufferIndex({row, 1});
-    auto offset = line.size();
-
-    if (row != m_lineBuffer->getLinesSize())
-        offset++;
 
     m_cursor->recordCursorPosition();
-    m_pieceTableInstance->getInstance().deleteText(index, index+offset);
-    updateStateForTextChange(false, line.size(), m_cursor->getRow());
+    auto length = m_lineBuffer->deleteLine(row-1);
+    updateStateForTextChange(false, length);
 
     m_cursor->setCoords({std::min(row, m_lineBuffer->getLinesSize()), 1});
     updateStateForCursorMovement();
@@ -333,29 +335,34 @@ void TextBox::copy() {
 
 void TextBox::paste() {
     auto text = std::string(ImGui::GetClipboardText());
+    auto trace = traceOperation(TraceOperation::Paste, 0, &text);
+
     if (!text.empty())
         enterText(text);
 }
 
 void TextBox::undo() {
+    auto trace = traceOperation(TraceOperation::Undo);
     m_writeSelection->setActive(false);
     m_pieceTableInstance->getInstance().flushInsertBuffer();
     m_pieceTableInstance->getInstance().flushDeleteBuffer();
     m_pieceTableInstance->getInstance().undo();
     m_cursor->cursorUndo();
-    updateStateForTextChange(true, 0, m_cursor->getRow());
+    updateStateForTextChange(true, 0);
     updateStateForCursorMovement();
 }
 
 void TextBox::redo() {
+    auto trace = traceOperation(TraceOperation::Redo);
     m_writeSelection->setActive(false);
     m_pieceTableInstance->getInstance().redo();
     m_cursor->cursorRedo();
-    updateStateForTextChange(true, 0, m_cursor->getRow());
+    updateStateForTextChange(true, 0);
     updateStateForCursorMovement();
 }
 
 void TextBox::newFile() {
+    stopTraceRecording();
     m_pieceTableInstance->newFile();
     m_lineBuffer->setLanguageMode(LanguageMode::PlainText);
 
@@ -368,26 +375,59 @@ void TextBox::newFile() {
 }
 
 bool TextBox::open(std::string& filePath) {
-    std::string buffer;
-    // Try to read from the file path
-    auto success = File::readFromFile(buffer, filePath);
+    stopTraceRecording();
+
+    // Try to open the file, if it was successful the piece table gets its contents while it loads
+    auto success = m_pieceTableInstance->open(filePath);
     if (!success)
         return false;
 
-    // If the read was successful update the filePath and pass the buffer contents to the piece table
-    m_pieceTableInstance->open(buffer, filePath);
+    showOpenedFile();
+    return true;
+}
+
+// Resets the state of the text box for the file that was just opened, also by another text box sharing the instance
+void TextBox::showOpenedFile() {
     m_lineBuffer->setLanguageMode(File::getModeForExtension(m_pieceTableInstance->getFile()->getExtension()));
 
-    // Update the state of the text box
     m_lineBuffer->getLines();
     m_cursor->clearUndoAndRedoStacks();
     m_cursor->setCoords({1, 1});
     m_scroll->updateScroll(m_width, m_height);
     m_scroll->updateMaxScroll(m_width, m_height);
+}
+
+// Loads and shows the next part of a file that is loading, the first screen is there after the first frame.
+// Returns whether a part was loaded, another text box sharing the instance then only has to show it
+bool TextBox::continueLoading() {
+    if (!m_pieceTableInstance->isLoading() && !m_lineBuffer->isLoading())
+        return false;
+
+    if (!m_pieceTableInstance->continueLoading()) {
+        newFile();
+        return true;
+    }
 
+    showLoadedPart();
     return true;
 }
 
+// Shows the part of the file that was just loaded, also by another text box sharing the instance
+void TextBox::showLoadedPart() {
+    // Edits recovered from the journal once the file is loaded aren't saved yet
+    if (m_pieceTableInstance->hasRecoveredEdits())
+        m_dirty = true;
+
+    m_lineBuffer->getLines();
+    m_scroll->updateMaxScroll(m_width, m_height);
+}
+
+// Stops loading the file and starts a new one, a partly loaded file must not be saved over the whole one
+void TextBox::cancelLoading() {
+    if (m_pieceTableInstance->isLoading())
+        newFile();
+}
+
 bool TextBox::save() {
     m_dirty = false;
 
@@ -406,6 +446,26 @@ bool TextBox::saveAs(std::string &filePath) {
     return save();
 }
 
+// Starts recording the editing operations into a trace that starts from the current text
+bool TextBox::startTraceRecording(const std::string &filePath) {
+    auto& table = m_pieceTableInstance->getInstance();
+
+    if (m_traceWriter == nullptr)
+        m_traceWriter = new EditTraceWriter();
+
+    if (!m_traceWriter->open(filePath, m_lineBuffer->getLanguageMode(), table.getText(0, table.getSize()))) {
+        stopTraceRecording();
+        return false;
+    }
+
+    return true;
+}
+
+void TextBox::stopTraceRecording() {
+    delete m_traceWriter;
+    m_traceWriter = nullptr;
+}
+
 bool TextBox::saveSnippet(std::string &name) {
     auto selectionText = m_selection->getSelectionText();
     return SnippetManager::addSnippet(name, selectionText);
@@ -635,6 +695,15 @@ void TextBox::decreaseFontSize() {
 
 void TextBox::getLines() { m_lineBuffer->getLines(); }
 
+// Merges the small pieces the edits left behind once the user stopped typing for a while
+void TextBox::compactIfIdle() {
+    if (!m_compactionPending || std::chrono::steady_clock::now() - m_lastEditTime < m_compactionDelay)
+        return;
+
+    m_compactionPending = false;
+    m_pieceTableInstance->getInstance().compact();
+}
+
 bool TextBox::isInsideTextBox(const ImVec2& point) {
     return MyRectangle::isInsideRectangle({getTopLeft(), getBottomRight()}, point);
 }
@@ -711,6 +780,12 @@ bool TextBox::isRectangularSelectionActive() const { return m_selection->isRecta
 
 bool TextBox::isDirty() const { return m_dirty; }
 
+bool TextBox::isRecordingTrace() const { return m_traceWriter != nullptr; }
+
+bool TextBox::isLoading() const { return m_pieceTableInstance->isLoading(); }
+
+float TextBox::getLoadingProgress() const { return m_pieceTableInstance->getLoadingProgress(); }
+
 bool TextBox::isUndoEmpty() const { return m_pieceTableInstance->getInstance().isUndoEmpty(); }
 
 bool TextBox::isRedoEmpty() const { return m_pieceTableInstance->getInstance().isRedoEmpty(); }
@@ -736,6 +811,8 @@ bool TextBox::deleteSelection() {
     if (!m_selection->isActive())
         return false;
 
+    auto trace = traceOperation(TraceOperation::DeleteSelection);
+
     updateUndoRedo();
 
     m_pieceTableInstance->getInstance().flushInsertBuffer();
@@ -747,7 +824,7 @@ bool TextBox::deleteSelection() {
     auto endIndex = m_lineBuffer->textCoordinatesToBufferIndex(m_selection->getEnd());
     m_pieceTableInstance->getInstance().deleteText(startIndex, endIndex);
 
-    updateStateForTextChange(false, endIndex-startIndex, m_selection->getStart().m_row);
+    updateStateForTextChange(false, endIndex-startIndex);
 
     m_cursor->setCoords(m_selection->getStart());
     updateStateForCursorMovement();
@@ -821,69 +898,24 @@ TextCoordinates TextBox::mousePositionToTextCoordinates(const ImVec2 &mousePosit
 // Adds a tab character in front of every selected row
 // Returns whether there were added tabs
 bool TextBox::addTabToSelectedRows() {
-    auto beginRow = m_selection->getStart().m_row;
-    auto endRow = m_selection->getEnd().m_row;
-
-    auto index = m_lineBuffer->textCoordinatesToBufferIndex({beginRow, 1});
     m_cursor->recordCursorPosition();
-    m_pieceTableInstance->getInstance().insert("\t", index);
-
-    for (size_t i=beginRow-1; i<endRow-1; ++i) {
-        auto line = m_lineBuffer->lineAt(i);
-        auto lineSize = line.empty() ? 0 : line.size() + 1;
-        index += lineSize + 1;
-        if (!m_lineBuffer->lineAt(i+1).empty()) {
-            m_cursor->recordCursorPosition();
-            m_pieceTableInstance->getInstance().insert("\t", index);
-        }
-    }
-
-    return true;
+    return m_lineBuffer->addTabs(m_selection->getStart().m_row-1, m_selection->getEnd().m_row-1);
 }
 
 // Deletes a tab from the selected rows
 // Returns whether there were deleted tabs
 bool TextBox::deleteTabFromSelectedRows() {
-    auto beginRow = m_selection->getStart().m_row;
-    auto endRow = m_selection->getEnd().m_row;
-
-    bool deleted = false;
-
-    auto index = m_lineBuffer->textCoordinatesToBufferIndex({beginRow, 1});
-    if (m_lineBuffer->lineStarsWithTab(beginRow-1)) {
-        deleted = true;
-        m_cursor->recordCursorPosition();
-        m_pieceTableInstance->getInstance().deleteText(index, index + 1);
-        --index;
-    }
-
-    for (size_t i=beginRow-1; i<endRow-1; ++i) {
-        auto line = m_lineBuffer->lineAt(i);
-        index += line.size() + 1;
-
-
-        if (m_lineBuffer->lineStarsWithTab(i+1)) {
-            deleted = true;
-            m_cursor->recordCursorPosition();
-            m_pieceTableInstance->getInstance().deleteText(index, index+1);
-            --index;
-        }
-    }
+    if (!m_lineBuffer->removeTabs(m_selection->getStart().m_row-1, m_selection->getEnd().m_row-1))
+        return false;
 
-    return deleted;
+    m_cursor->recordCursorPosition();
+    return true;
 }
 
 // Removes a tab character from the beginning of the line if there is one
 // Returns whether anything was deleted
 bool TextBox::reverseTab() {
-    auto row = m_cursor->getRow();
-    auto line = m_lineBuffer->lineAt(row-1);
-    if (!line.empty() && line[0] == '\t') {
-        auto index = m_lineBuffer->textCoordinatesToBufferIndex({row, 1});
-        m_pieceTableInstance->getInstance().deleteText(index, index+1);
-        return true;
-    }
-    return false;
+    return m_lineBuffer->removeTab(m_cursor->getRow()-1);
 }
 
 inline void TextBox::drawRectangle(ImVec2 currentPosition, float& lineHeight) {
@@ -931,29 +963,19 @@ void TextBox::drawLineText(size_t& lineIndex, int& currentBlockIndex, std::vecto
 }
 
 void TextBox::drawText(ImVec2 textPosition, const std::string &line, size_t index) {
-    if (m_lineBuffer->getLanguageMode() == LanguageMode::PlainText) {
+    auto& colorMap = m_lineBuffer->getColorMap(index);
+
+    // A line that wasn't highlighted since it changed is drawn as plain text until the worker gets to it
+    if (m_lineBuffer->getLanguageMode() == LanguageMode::PlainText || colorMap.size() != line.size()) {
         ImGui::GetWindowDrawList()->AddText(textPosition, getTheme()->getColor(ThemeColor::TextColor), line.c_str());
         return;
     }
-    //std::cerr << "index: " << index << std::endl;
-    auto colorMap = m_lineBuffer->getColorMap(index);
-    //std::cerr << "colorMap.size(): " << colorMap.size() << std::endl;
-    //std::cerr << "line.size(): " << line.size() << std::endl;
-
-    size_t start = 0;
-    while (start < line.size()) {
-        size_t length = 0;
-        //std::cerr << "start: " << start << std::endl;
-        ThemeColor color = colorMap[start];
-
-        while (start + length < line.size() && colorMap[start + length] == color) {
-            ++length;
-        }
 
-        auto text = line.substr(start, length);
-        ImGui::GetWindowDrawList()->AddText(textPosition, getTheme()->getColor(color), text.c_str());
+    // Every span is drawn with its color
+    for (auto& span : colorMap.getSpans()) {
+        auto text = line.substr(span.m_start, span.m_length);
+        ImGui::GetWindowDrawList()->AddText(textPosition, getTheme()->getColor(span.m_color), text.c_str());
         textPosition.x += m_cursor->getXAdvance(text);
-        start += length;
     }
 }
 
@@ -1157,19 +1179,53 @@ std::string TextBox::getStatusBarText() {
 
 // Saves the text box contents to the current file
 bool TextBox::saveToFile() {
-    std::stringstream strStream;
-    strStream << m_pieceTableInstance->getInstance();
-    std::string buffer = strStream.str();
+    auto& path = m_pieceTableInstance->getFile()->getPath();
+#ifdef _WIN32
+    // Windows doesn't let a mapped file be replaced, elsewhere the mapping keeps reading the old file after the rename
+    m_pieceTableInstance->getInstance().detachOriginalBuffer(path);
+#endif
+
+    if (!File::writeToFile(m_pieceTableInstance->getInstance(), path))
+        return false;
+
+    m_pieceTableInstance->fileSaved();
+    return true;
+}
+
+// Records the operation with the cursor and the selection it starts from, when it isn't called by another recorded one
+TraceScope TextBox::traceOperation(TraceOperation operation, char c, const std::string *text, bool shift) {
+    if (m_traceWriter == nullptr)
+        return {nullptr, nullptr};
+
+    TraceEvent event;
+    event.m_operation = operation;
+    event.m_char = c;
+    event.m_shift = shift;
+    if (text != nullptr)
+        event.m_text = *text;
 
-    return File::writeToFile(buffer, m_pieceTableInstance->getFile()->getPath());
+    return traceOperation(event);
+}
+
+TraceScope TextBox::traceOperation(TraceEvent &event) {
+    if (m_traceWriter == nullptr)
+        return {nullptr, nullptr};
+
+    event.m_cursorIndex = m_lineBuffer->textCoordinatesToBufferIndex(m_cursor->getCoords());
+    event.m_selectionActive = m_selection->isActive();
+
+    if (event.m_selectionActive) {
+        event.m_selectionStart = m_lineBuffer->textCoordinatesToBufferIndex(m_selection->getStart());
+        event.m_selectionEnd = m_lineBuffer->textCoordinatesToBufferIndex(m_selection->getEnd());
+    }
+
+    return {m_traceWriter, &event};
 }
 
 // Clears the undo and redo stacks if we are in a past state
 void TextBox::updateUndoRedo() {
-    if (!m_pieceTableInstance->getInstance().isRedoEmpty()) {
-        m_pieceTableInstance->getInstance().clearUndoAndRedoStacks();
+    if (m_pieceTableInstance->getInstance().clearStacksIfRedoable())
         m_cursor->clearUndoAndRedoStacks();
-    }
 }
 
 // Updates the TextBox size to the size of the window.
@@ -1197,11 +1253,13 @@ void TextBox::updateTextBoxSize() {
         m_scroll->updateMaxYScroll(m_height);
 }
 
-void TextBox::updateStateForTextChange(bool isInsert, size_t size, int lineIndex) {
+void TextBox::updateStateForTextChange(bool isInsert, size_t size) {
     updateWriteSelection(isInsert, size);
-    m_lineBuffer->getLines(lineIndex-1);
+    m_lineBuffer->getLines();
     m_scroll->updateMaxScroll(m_width, m_height);
     m_dirty = true;
+    m_compactionPending = true;
+    m_lastEditTime = std::chrono::steady_clock::now();
 }
 
 void TextBox::updateWriteSelection(bool isInsert, size_t size) {
@@ -19,15 +19,17 @@
 #include "../CodeSnippets/SnippetManager.h"
 #include "../SyntaxHiglighting/TextHighlighter.h"
 #include "Theme.h"
+#include "../Tracing/EditTrace.h"
 #include "ThemeManager.h"
 
+#include <chrono>
 #include <string>
 #include <iostream>
 #include <sstream>
 
 class TextBox {
 public:
-    TextBox(float width, float height, const std::string& fontName, PieceTableInstance* instance = nullptr);
+    TextBox(float width, float height, const std::string& fontName, PieceTableInstance* instance);
     ~TextBox();
 
     void draw();
@@ -50,10 +52,17 @@ public:
 
     void newFile();
     bool open(std::string& filePath);
+    void showOpenedFile();
+    bool continueLoading();
+    void showLoadedPart();
+    void cancelLoading();
     bool save();
     bool saveAs(std::string& filePath);
     bool saveSnippet(std::string& name);
 
+    bool startTraceRecording(const std::string& filePath);
+    void stopTraceRecording();
+
     void moveCursorRight(bool shift);
     void moveCursorLeft(bool shift);
     void moveCursorUp(bool shift);
@@ -74,6 +83,7 @@ public:
     void decreaseFontSize();
 
     void getLines();
+    void compactIfIdle();
     bool isInsideTextBox(const ImVec2& point);
     bool isInsideHorizontalScrollbar(const ImVec2& point);
     bool isInsideVerticalScrollbar(const ImVec2& point);
@@ -98,8 +108,11 @@ public:
     bool isWriteSelectionActive() const;
     bool isRectangularSelectionActive() const;
     bool isDirty() const;
+    bool isLoading() const;
+    float getLoadingProgress() const;
     bool isUndoEmpty() const;
     bool isRedoEmpty() const;
+    bool isRecordingTrace() const;
 
     void setWidth(float width);
     void setHeight(float height);
@@ -135,9 +148,12 @@ private:
 
     bool saveToFile();
 
+    TraceScope traceOperation(TraceOperation operation, char c = 0, const std::string* text = nullptr, bool shift = false);
+    TraceScope traceOperation(TraceEvent& event);
+
     void updateUndoRedo();
     void updateTextBoxSize();
-    void updateStateForTextChange(bool isInsert, size_t size, int lineIndex);
+    void updateStateForTextChange(bool isInsert, size_t size);
     void updateWriteSelection(bool isInsert, size_t size);
     void updateStateForCursorMovement();
     void updateStateForSelectionChange();
@@ -152,6 +168,12 @@ private:
     Font* m_font;
     //std::vector<std::pair<MyRectangle, CodeBlock*>> m_blockButtonRects;
     bool m_dirty;
+    // Records the editing operations while a trace is being recorded, nullptr otherwise
+    EditTraceWriter* m_traceWriter = nullptr;
+    // The piece table is compacted once no edit was made for m_compactionDelay
+    bool m_compactionPending = false;
+    std::chrono::time_point<std::chrono::steady_clock> m_lastEditTime;
+    const std::chrono::duration<double> m_compactionDelay = std::chrono::duration<double>(2.0);
     float m_width;
     float m_height;
     ImVec2 m_topLeftMargin = {20.0f, 0.0f};
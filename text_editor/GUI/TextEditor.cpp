@@ -12,10 +12,13 @@ TextEditor::TextEditor() : m_size({0.0f, 0.0f}) {
     m_menuFont = new Font(m_menuFontName, m_menuFontSize);
     m_textFont = new Font(m_textFontName, m_textFontSize);
 
-    m_textBox = new TextBox(m_defaultWidth, m_defaultHeight, m_textFontName);
+    // Both text boxes show the same text, it outlives them
+    m_pieceTableInstance = new PieceTableInstance();
+
+    m_textBox = new TextBox(m_defaultWidth, m_defaultHeight, m_textFontName, m_pieceTableInstance);
     m_textBox->setWidth(500.0f);
 
-    m_secondTextBox = new TextBox(m_defaultWidth, m_defaultHeight, m_textFontName, m_textBox->getPieceTableInstance());
+    m_secondTextBox = new TextBox(m_defaultWidth, m_defaultHeight, m_textFontName, m_pieceTableInstance);
 
     m_activeTextBox = m_textBox;
     m_inactiveTextBox = m_secondTextBox;
@@ -28,6 +31,7 @@ TextEditor::TextEditor() : m_size({0.0f, 0.0f}) {
 TextEditor::~TextEditor() {
     delete m_textBox;
     delete m_secondTextBox;
+    delete m_pieceTableInstance;
     delete[] m_saveSnippetBuffer;
 }
 
@@ -40,6 +44,10 @@ void TextEditor::draw() {
         // Draw the top menu
         drawMenu();
 
+        // The text boxes share the file, so each part of it is loaded once and shown in both
+        if (m_activeTextBox->continueLoading())
+            m_inactiveTextBox->showLoadedPart();
+
         // Handle inputs;
         handleKeyboardInput();
         if (!m_menuActive)
@@ -66,6 +74,9 @@ void TextEditor::draw() {
         // Draw the status bar
         drawStatusBar();
 
+        m_textBox->compactIfIdle();
+        m_secondTextBox->compactIfIdle();
+
         ImGui::End();
     }
 }
@@ -85,10 +96,10 @@ void TextEditor::drawMenu() {
             if (ImGui::MenuItem("Open...", "Ctrl+O")) {
                 open();
             }
-            if (ImGui::MenuItem("Save", "Ctrl+S")) {
+            if (ImGui::MenuItem("Save", "Ctrl+S", false, !m_activeTextBox->isLoading())) {
                 save();
             }
-            if (ImGui::MenuItem("Save as...", "Ctrl+Shift+S")) {
+            if (ImGui::MenuItem("Save as...", "Ctrl+Shift+S", false, !m_activeTextBox->isLoading())) {
                 saveAs();
             }
 
@@ -99,19 +110,22 @@ void TextEditor::drawMenu() {
             clickedOnMenu = true;
             m_menuActive = true;
 
-            if (ImGui::MenuItem("Undo", "Ctrl+Z", false, !m_activeTextBox->isUndoEmpty())) {
+            // Nothing can be edited until the file is loaded
+            auto editable = !m_activeTextBox->isLoading();
+
+            if (ImGui::MenuItem("Undo", "Ctrl+Z", false, editable && !m_activeTextBox->isUndoEmpty())) {
                 m_activeTextBox->undo();
             }
-            if (ImGui::MenuItem("Redo", "Ctrl+Y", false, !m_activeTextBox->isRedoEmpty())) {
+            if (ImGui::MenuItem("Redo", "Ctrl+Y", false, editable && !m_activeTextBox->isRedoEmpty())) {
                 m_activeTextBox->redo();
             }
-            if (ImGui::MenuItem("Cut", "Ctrl+X", false, m_activeTextBox->isSelectionActive())) {
+            if (ImGui::MenuItem("Cut", "Ctrl+X", false, editable && m_activeTextBox->isSelectionActive())) {
                 m_activeTextBox->cut();
             }
             if (ImGui::MenuItem("Copy", "Ctrl+C", false, m_activeTextBox->isSelectionActive())) {
                 m_activeTextBox->copy();
             }
-            if (ImGui::MenuItem("Paste", "Ctrl+V")) {
+            if (ImGui::MenuItem("Paste", "Ctrl+V", false, editable)) {
                 m_activeTextBox->paste();
             }
 
@@ -159,6 +173,17 @@ void TextEditor::drawMenu() {
                 m_saveSnippetDialogActive = true;
             }
 
+            // The trace goes next to the file and can be replayed with edit_trace_replayer
+            if (ImGui::MenuItem("Record edit trace", "", m_activeTextBox->isRecordingTrace())) {
+                if (m_activeTextBox->isRecordingTrace()) {
+                    m_activeTextBox->stopTraceRecording();
+                } else {
+                    auto file = m_activeTextBox->getPieceTableInstance()->getFile();
+                    auto path = file == nullptr ? File::getProjectDirectory() + "untitled" : file->getPath();
+                    m_activeTextBox->startTraceRecording(path + ".trace");
+                }
+            }
+
             ImGui::EndMenu();
         }
 
@@ -181,6 +206,16 @@ void TextEditor::drawStatusBar() {
     auto text = m_activeTextBox->getStatusBarText();
     ImGui::GetWindowDrawList()->AddText(textPosition, ImColor(255, 255, 255), text.c_str());
 
+    if (m_activeTextBox->isLoading()) {
+        auto textSize = ImGui::CalcTextSize(text.c_str());
+        ImGui::SetCursorScreenPos({textPosition.x + textSize.x + offset, textPosition.y});
+        ImGui::ProgressBar(m_activeTextBox->getLoadingProgress(), {150.0f, textSize.y}, "Loading");
+        ImGui::SameLine();
+
+        if (ImGui::SmallButton("Cancel"))
+            m_activeTextBox->cancelLoading();
+    }
+
     ImGui::PopFont();
 }
 
@@ -220,6 +255,12 @@ void TextEditor::handleKeyboardInput() {
 
     if (ImGui::IsWindowFocused()) {
 
+        // A loading file can only be looked at, Escape stops loading it
+        if (m_activeTextBox->isLoading()) {
+            handleLoadingKeyboardInput();
+            return;
+        }
+
         if (isKeyPressed(ImGuiKey_RightArrow)) {
             m_activeTextBox->moveCursorRight(shift);
         } else if (isKeyPressed(ImGuiKey_LeftArrow)) {
@@ -290,6 +331,24 @@ void TextEditor::handleKeyboardInput() {
 
 }
 
+void TextEditor::handleLoadingKeyboardInput() {
+    auto shift = ImGui::GetIO().KeyShift;
+
+    if (isKeyPressed(ImGuiKey_RightArrow)) {
+        m_activeTextBox->moveCursorRight(shift);
+    } else if (isKeyPressed(ImGuiKey_LeftArrow)) {
+        m_activeTextBox->moveCursorLeft(shift);
+    } else if (isKeyPressed(ImGuiKey_UpArrow)) {
+        m_activeTextBox->moveCursorUp(shift);
+    } else if (isKeyPressed(ImGuiKey_DownArrow)) {
+        m_activeTextBox->moveCursorDown(shift);
+    } else if (isKeyPressed(ImGuiKey_Escape)) {
+        m_activeTextBox->cancelLoading();
+    }
+
+    ImGui::GetIO().InputQueueCharacters.resize(0);
+}
+
 void TextEditor::handleMouseInput() {
 
     auto position = ImGui::GetMousePos();
@@ -356,13 +415,15 @@ void TextEditor::open() {
 
     auto path = openFileDialog();
 
-    if (!path.empty()) {
-        m_activeTextBox->open(path);
-        m_inactiveTextBox->open(path);
-    }
+    // The text boxes share the file, so it is only loaded once
+    if (!path.empty() && m_activeTextBox->open(path))
+        m_inactiveTextBox->showOpenedFile();
 }
 
 void TextEditor::save() {
+    if (m_activeTextBox->isLoading())
+        return;
+
     if (m_activeTextBox->getPieceTableInstance()->getFile() == nullptr)
         saveAs();
     else
@@ -370,6 +431,9 @@ void TextEditor::save() {
 }
 
 void TextEditor::saveAs() {
+    if (m_activeTextBox->isLoading())
+        return;
+
     auto path = saveFileDialog();
 
     if (!path.empty()) {
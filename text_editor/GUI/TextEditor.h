@@ -29,6 +29,7 @@ private:
     void updateTextBoxMargins();
 
     void handleKeyboardInput();
+    void handleLoadingKeyboardInput();
     void handleMouseInput();
 
     void newFile();
@@ -56,6 +57,7 @@ private:
     TextBox* m_inactiveTextBox;
     TextBox* m_textBox;
     TextBox* m_secondTextBox;
+    PieceTableInstance* m_pieceTableInstance;
     Font* m_menuFont;
     Font* m_textFont;
     ImVec2 m_size;
@@ -42,7 +42,7 @@ bool TextPosition::moveLeft(size_t times) {
         moved = true;
 
         if (isOnBeginningOfLine()) {
-            m_coords.m_col = m_lineBuffer->lineAt(m_coords.m_row - 2).size() + 1;
+            m_coords.m_col = m_lineBuffer->getLineLength(m_coords.m_row - 2) + 1;
             moveUp();
         } else {
             m_coords.m_col--;
@@ -87,14 +87,14 @@ bool TextPosition::moveToBeginningOfRow() {
 
 bool TextPosition::moveToEndOfRow() {
     if (!m_lineBuffer->isEmpty()) {
-        m_coords.m_col = m_lineBuffer->lineAt(m_coords.m_row - 1).size() + 1;
+        m_coords.m_col = m_lineBuffer->getLineLength(m_coords.m_row - 1) + 1;
     }
     return true;
 }
 
 bool TextPosition::moveToEndOfFile() {
     m_coords.m_row = m_lineBuffer->getLinesSize();
-    m_coords.m_col = m_lineBuffer->lineAt(m_coords.m_row-1).size() + 1;
+    m_coords.m_col = m_lineBuffer->getLineLength(m_coords.m_row-1) + 1;
     return true;
 }
 
@@ -115,7 +115,7 @@ void TextPosition::setColumn(const size_t &column) { m_coords.m_col = column; }
 
 void TextPosition::correctColumn() {
     if (!m_lineBuffer->isEmpty())
-        m_coords.m_col = std::min(m_coords.m_col, m_lineBuffer->lineAt(m_coords.m_row-1).size() + 1);
+        m_coords.m_col = std::min(m_coords.m_col, m_lineBuffer->getLineLength(m_coords.m_row-1) + 1);
 }
 
 bool TextPosition::isOnBeginningOfLine() {
@@ -123,7 +123,7 @@ bool TextPosition::isOnBeginningOfLine() {
 }
 
 bool TextPosition::isOnEndOfLine() {
-    return m_coords.m_col > m_lineBuffer->lineAt(m_coords.m_row-1).size();
+    return m_coords.m_col > m_lineBuffer->getLineLength(m_coords.m_row-1);
 }
 
 bool TextPosition::isOnFirstLine() {
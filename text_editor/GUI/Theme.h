@@ -7,26 +7,12 @@
 
 #include "imgui.h"
 #include "../SyntaxHiglighting/TextHighlighter.h"
+#include "ThemeColor.h"
 #include "ThemeName.h"
 
 #include <string>
 #include <unordered_map>
 
-enum ThemeColor {
-    BackgroundColor,
-    TextColor,
-    StringColor,
-    NumberColor,
-    KeywordColor,
-    PreprocessorColor,
-    CommentColor,
-    CursorColor,
-    SelectColor,
-    WriteSelectColor,
-    ScrollbarPrimaryColor,
-    ScrollbarSecondaryColor,
-};
-
 class Theme {
 public:
     Theme(ThemeName name, ImColor backgroundColor, ImColor textColor, ImColor stringColor, ImColor numberColor,
@@ -0,0 +1,22 @@
+#ifndef TEXT_EDITOR_THEMECOLOR_H
+#define TEXT_EDITOR_THEMECOLOR_H
+
+#include <cstdint>
+
+// A single byte, so the color spans of the lines stay small
+enum ThemeColor : uint8_t {
+    BackgroundColor,
+    TextColor,
+    StringColor,
+    NumberColor,
+    KeywordColor,
+    PreprocessorColor,
+    CommentColor,
+    CursorColor,
+    SelectColor,
+    WriteSelectColor,
+    ScrollbarPrimaryColor,
+    ScrollbarSecondaryColor,
+};
+
+#endif //TEXT_EDITOR_THEMECOLOR_H
@@ -6,22 +6,15 @@
 
 std::ostream& operator<<(std::ostream& out, const ActionDescriptor& action) {
     out << (action.m_actionType == ActionType::Insert ? "Insert" : "Delete") << ", "
-        << action.m_index << std::endl;
-
-    for (size_t i=0; i<action.m_descriptors.size(); ++i) {
-        out << *(action.m_descriptors[i]) << std::endl;
-    }
+        << action.m_index << ", " << action.m_pieceCount << " pieces" << std::endl;
 
     return out;
 }
 
-ActionDescriptor::ActionDescriptor(ActionType actionType, std::vector<PieceDescriptor *> descriptors, size_t index)
-    : m_actionType(actionType), m_descriptors(descriptors), m_index(index)  {}
+ActionDescriptor::ActionDescriptor(ActionType actionType, size_t index, size_t firstPiece, size_t pieceCount, bool grouped)
+    : m_actionType(actionType), m_index(index), m_firstPiece(firstPiece), m_pieceCount(pieceCount), m_grouped(grouped) {}
 
-ActionDescriptor::~ActionDescriptor() {
-    for (auto descriptor : m_descriptors)
-        delete descriptor;
-}
+ActionDescriptor::~ActionDescriptor() {}
 
 ActionType ActionDescriptor::getOppositeActionType(ActionType actionType) {
     return actionType == ActionType::Insert ? ActionType::Delete : ActionType::Insert;
@@ -29,8 +22,14 @@ ActionType ActionDescriptor::getOppositeActionType(ActionType actionType) {
 
 ActionType ActionDescriptor::getActionType() const { return m_actionType; }
 
-std::vector<PieceDescriptor*> ActionDescriptor::getDescriptors() const { return m_descriptors; }
-
 size_t ActionDescriptor::getIndex() const { return m_index; }
 
+size_t ActionDescriptor::getFirstPiece() const { return m_firstPiece; }
+
+size_t ActionDescriptor::getPieceCount() const { return m_pieceCount; }
+
+bool ActionDescriptor::isGrouped() const { return m_grouped; }
+
 void ActionDescriptor::setActionType(ActionType actionType) { m_actionType = actionType; }
+
+void ActionDescriptor::setFirstPiece(size_t firstPiece) { m_firstPiece = firstPiece; }
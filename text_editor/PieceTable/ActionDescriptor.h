@@ -14,24 +14,31 @@ enum ActionType {
     Delete
 };
 
+// One undo/redo record. Its pieces are stored by value in the ActionStack that holds it,
+// starting at m_firstPiece. A grouped action is undone and redone together with the one below it.
 class ActionDescriptor {
 public:
     friend std::ostream& operator<<(std::ostream& out, const ActionDescriptor& action);
 
-    ActionDescriptor(ActionType actionType, std::vector<PieceDescriptor*> descriptors, size_t index);
+    ActionDescriptor(ActionType actionType, size_t index, size_t firstPiece, size_t pieceCount, bool grouped = false);
     ~ActionDescriptor();
 
     static ActionType getOppositeActionType(ActionType actionType);
 
     ActionType getActionType() const;
-    std::vector<PieceDescriptor*> getDescriptors() const;
     size_t getIndex() const;
+    size_t getFirstPiece() const;
+    size_t getPieceCount() const;
+    bool isGrouped() const;
 
     void setActionType(ActionType actionType);
+    void setFirstPiece(size_t firstPiece);
 private:
     ActionType m_actionType;
-    std::vector<PieceDescriptor*> m_descriptors;
     size_t m_index;
+    size_t m_firstPiece;
+    size_t m_pieceCount;
+    bool m_grouped;
 };
 
 
@@ -0,0 +1,250 @@
+#include "ActionStack.h"
+
+const size_t ActionStack::m_defaultMemoryLimit = 32 * 1024 * 1024;
+
+ActionStack::ActionStack(AddBuffer* addBuffer)
+    : m_addBuffer(addBuffer), m_spillFile(nullptr), m_memoryLimit(m_defaultMemoryLimit), m_memoryUsage(0) {}
+
+ActionStack::~ActionStack() {
+    closeSpillFile();
+}
+
+void ActionStack::push(ActionType actionType, size_t index, const PieceDescriptor *pieces, size_t pieceCount, bool grouped) {
+    m_actions.emplace_back(actionType, index, m_pieces.size(), pieceCount, grouped);
+    m_pieces.insert(m_pieces.end(), pieces, pieces + pieceCount);
+    m_memoryUsage += getMemoryUsage(pieces, pieceCount);
+}
+
+void ActionStack::pop() {
+    auto& action = m_actions.back();
+    m_memoryUsage -= getMemoryUsage(getPieces(action), action.getPieceCount());
+
+    m_pieces.erase(m_pieces.begin() + action.getFirstPiece(), m_pieces.end());
+    m_actions.pop_back();
+}
+
+// Releases the memory of all actions at once and deletes the spilled ones
+void ActionStack::clear() {
+    std::vector<ActionDescriptor>().swap(m_actions);
+    std::vector<PieceDescriptor>().swap(m_pieces);
+    m_memoryUsage = 0;
+    closeSpillFile();
+}
+
+// Makes sure the newest action is in memory, returns false if there is none
+bool ActionStack::loadTop() {
+    if (m_actions.empty() && !m_segments.empty())
+        pageIn();
+
+    return !m_actions.empty();
+}
+
+const ActionDescriptor &ActionStack::top() const { return m_actions.back(); }
+
+const PieceDescriptor *ActionStack::getPieces(const ActionDescriptor &action) const {
+    return m_pieces.data() + action.getFirstPiece();
+}
+
+bool ActionStack::isEmpty() const { return m_actions.empty() && m_segments.empty(); }
+
+void ActionStack::setMemoryLimit(size_t memoryLimit) { m_memoryLimit = memoryLimit; }
+
+bool ActionStack::isOverMemoryLimit() const { return m_memoryUsage > m_memoryLimit; }
+
+// Spills the oldest actions until at most half of the limit is used, the newest action always stays in memory
+void ActionStack::spill() {
+    size_t usage = m_memoryUsage;
+    size_t actionCount = 0;
+
+    while (actionCount + 1 < m_actions.size() && usage > m_memoryLimit / 2) {
+        auto& action = m_actions[actionCount++];
+        usage -= getMemoryUsage(getPieces(action), action.getPieceCount());
+    }
+
+    if (actionCount == 0)
+        return;
+
+    // Indices and original buffer offsets are written as differences from the previous ones,
+    // which are small for the runs of nearby edits a history is mostly made of
+    std::string segment;
+    size_t previousIndex = 0;
+    size_t previousEnd = 0;
+
+    writeNumber(segment, actionCount);
+
+    for (size_t i=0; i<actionCount; ++i) {
+        auto& action = m_actions[i];
+        auto pieces = getPieces(action);
+
+        writeNumber(segment, action.getActionType());
+        writeNumber(segment, action.isGrouped());
+        writeSignedNumber(segment, action.getIndex(), previousIndex);
+        writeNumber(segment, action.getPieceCount());
+        previousIndex = action.getIndex();
+
+        for (size_t j=0; j<action.getPieceCount(); ++j) {
+            auto& piece = pieces[j];
+
+            writeNumber(segment, piece.getSource());
+
+            if (piece.getSource() == SourceType::Original) {
+                writeSignedNumber(segment, piece.getStart(), previousEnd);
+                writeNumber(segment, piece.getLength());
+                previousEnd = piece.getStart() + piece.getLength();
+            } else {
+                // The text itself is spilled, so the add buffer doesn't have to keep it
+                writeNumber(segment, piece.getLength());
+                segment.append(m_addBuffer->getData(piece.getChunk()) + piece.getStart(), piece.getLength());
+            }
+        }
+    }
+
+    // If the segment can't be written the actions are dropped, which still bounds the history
+    writeSegment(segment);
+    removeOldest(actionCount);
+}
+
+void ActionStack::markReferencedChunks(std::vector<bool> &referenced) const {
+    for (auto& piece : m_pieces) {
+        if (piece.getSource() == SourceType::Add)
+            referenced[piece.getChunk()] = true;
+    }
+}
+
+// The add buffer text of a piece counts too, because the history keeps the chunk it is in alive
+size_t ActionStack::getMemoryUsage(const PieceDescriptor *pieces, size_t pieceCount) const {
+    size_t usage = sizeof(ActionDescriptor) + pieceCount * sizeof(PieceDescriptor);
+
+    for (size_t i=0; i<pieceCount; ++i) {
+        if (pieces[i].getSource() == SourceType::Add)
+            usage += pieces[i].getLength();
+    }
+
+    return usage;
+}
+
+void ActionStack::removeOldest(size_t actionCount) {
+    auto pieceCount = actionCount == m_actions.size() ? m_pieces.size() : m_actions[actionCount].getFirstPiece();
+
+    for (size_t i=0; i<actionCount; ++i)
+        m_memoryUsage -= getMemoryUsage(getPieces(m_actions[i]), m_actions[i].getPieceCount());
+
+    m_actions.erase(m_actions.begin(), m_actions.begin() + actionCount);
+    m_pieces.erase(m_pieces.begin(), m_pieces.begin() + pieceCount);
+
+    for (auto& action : m_actions)
+        action.setFirstPiece(action.getFirstPiece() - pieceCount);
+}
+
+// Segments are written one after another, paging one in frees its space for the next spill
+bool ActionStack::writeSegment(const std::string &segment) {
+    if (m_spillFile == nullptr)
+        m_spillFile = std::tmpfile();
+
+    auto offset = m_segments.empty() ? 0 : m_segments.back().m_offset + m_segments.back().m_size;
+
+    if (m_spillFile != nullptr && std::fseek(m_spillFile, static_cast<long>(offset), SEEK_SET) == 0 &&
+        std::fwrite(segment.data(), 1, segment.size(), m_spillFile) == segment.size()) {
+        m_segments.push_back({offset, segment.size()});
+        return true;
+    }
+
+    // The older segments can't be undone in order without this one, so they are dropped as well
+    std::cerr << "Failed to spill undo history" << std::endl;
+    closeSpillFile();
+    return false;
+}
+
+// Reads back the newest spilled segment, its add buffer text is appended to the add buffer again
+void ActionStack::pageIn() {
+    auto segment = m_segments.back();
+    m_segments.pop_back();
+
+    std::string data(segment.m_size, '\0');
+
+    if (std::fseek(m_spillFile, static_cast<long>(segment.m_offset), SEEK_SET) != 0 ||
+        std::fread(&data[0], 1, data.size(), m_spillFile) != data.size()) {
+        std::cerr << "Failed to read spilled undo history" << std::endl;
+        closeSpillFile();
+        return;
+    }
+
+    const char* it = data.data();
+    std::vector<PieceDescriptor> pieces;
+    size_t previousIndex = 0;
+    size_t previousEnd = 0;
+
+    auto actionCount = readNumber(it);
+
+    for (size_t i=0; i<actionCount; ++i) {
+        auto actionType = static_cast<ActionType>(readNumber(it));
+        auto grouped = readNumber(it) != 0;
+        auto index = readSignedNumber(it, previousIndex);
+        auto pieceCount = readNumber(it);
+        previousIndex = index;
+
+        pieces.clear();
+
+        for (size_t j=0; j<pieceCount; ++j) {
+            auto source = static_cast<SourceType>(readNumber(it));
+
+            if (source == SourceType::Original) {
+                auto start = readSignedNumber(it, previousEnd);
+                auto length = readNumber(it);
+                pieces.emplace_back(source, 0, start, length);
+                previousEnd = start + length;
+            } else {
+                auto length = readNumber(it);
+                auto [chunk, start] = m_addBuffer->append(it, length);
+                pieces.emplace_back(source, chunk, start, length);
+                it += length;
+            }
+        }
+
+        push(actionType, index, pieces.data(), pieces.size(), grouped);
+    }
+
+    if (m_segments.empty())
+        closeSpillFile();
+}
+
+void ActionStack::closeSpillFile() {
+    if (m_spillFile != nullptr)
+        std::fclose(m_spillFile);
+
+    m_spillFile = nullptr;
+    m_segments.clear();
+}
+
+// Numbers are written 7 bits at a time, the high bit marks that more bytes follow
+void ActionStack::writeNumber(std::string &out, size_t number) {
+    while (number >= 0x80) {
+        out.push_back(static_cast<char>((number & 0x7F) | 0x80));
+        number >>= 7;
+    }
+
+    out.push_back(static_cast<char>(number));
+}
+
+// Writes the difference from previous, zigzag encoded so small negative differences stay short
+void ActionStack::writeSignedNumber(std::string &out, size_t number, size_t previous) {
+    auto difference = static_cast<long long>(number - previous);
+    writeNumber(out, (static_cast<size_t>(difference) << 1) ^ static_cast<size_t>(difference >> 63));
+}
+
+size_t ActionStack::readNumber(const char *&it) {
+    size_t number = 0;
+    int shift = 0;
+
+    while (static_cast<unsigned char>(*it) & 0x80) {
+        number |= static_cast<size_t>(static_cast<unsigned char>(*it++) & 0x7F) << shift;
+        shift += 7;
+    }
+
+    return number | (static_cast<size_t>(static_cast<unsigned char>(*it++)) << shift);
+}
+
+size_t ActionStack::readSignedNumber(const char *&it, size_t previous) {
+    auto number = readNumber(it);
+    return previous + ((number >> 1) ^ (0 - (number & 1)));
+}
@@ -0,0 +1,67 @@
+#ifndef TEXT_EDITOR_ACTIONSTACK_H
+#define TEXT_EDITOR_ACTIONSTACK_H
+
+#include "ActionDescriptor.h"
+#include "AddBuffer.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Undo or redo history. Actions and their pieces are kept by value in two contiguous vectors,
+// so recording an action doesn't allocate per piece and clearing frees everything at once.
+// When the history grows over its memory limit the oldest actions are delta encoded, together
+// with the text of their add buffer pieces, and spilled to a temporary file. They are paged
+// back in when undoing reaches them.
+class ActionStack {
+public:
+    explicit ActionStack(AddBuffer* addBuffer);
+    ~ActionStack();
+
+    ActionStack(const ActionStack&) = delete;
+    ActionStack& operator=(const ActionStack&) = delete;
+
+    void push(ActionType actionType, size_t index, const PieceDescriptor* pieces, size_t pieceCount, bool grouped = false);
+    void pop();
+    void clear();
+
+    bool loadTop();
+    const ActionDescriptor& top() const;
+    const PieceDescriptor* getPieces(const ActionDescriptor& action) const;
+    bool isEmpty() const;
+
+    void setMemoryLimit(size_t memoryLimit);
+    bool isOverMemoryLimit() const;
+    void spill();
+    void markReferencedChunks(std::vector<bool>& referenced) const;
+private:
+    struct Segment {
+        size_t m_offset;
+        size_t m_size;
+    };
+
+    size_t getMemoryUsage(const PieceDescriptor* pieces, size_t pieceCount) const;
+    void removeOldest(size_t actionCount);
+    bool writeSegment(const std::string& segment);
+    void pageIn();
+    void closeSpillFile();
+
+    static void writeNumber(std::string& out, size_t number);
+    static void writeSignedNumber(std::string& out, size_t number, size_t previous);
+    static size_t readNumber(const char*& it);
+    static size_t readSignedNumber(const char*& it, size_t previous);
+
+    static const size_t m_defaultMemoryLimit;
+
+    std::vector<ActionDescriptor> m_actions;
+    std::vector<PieceDescriptor> m_pieces;
+    AddBuffer* m_addBuffer;
+    std::FILE* m_spillFile;
+    std::vector<Segment> m_segments;
+    size_t m_memoryLimit;
+    size_t m_memoryUsage;
+};
+
+
+#endif //TEXT_EDITOR_ACTIONSTACK_H
@@ -0,0 +1,85 @@
+#include "AddBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+const size_t AddBuffer::m_firstChunkCapacity = 16 * 1024;
+const size_t AddBuffer::m_maxChunkCapacity = 1024 * 1024;
+const size_t AddBuffer::m_chunksPerPage = 1024;
+const size_t AddBuffer::m_maxPages = 4096;
+
+AddBuffer::AddBuffer() : m_pages(new std::unique_ptr<Chunk[]>[m_maxPages]), m_chunkCount(0), m_size(0) {}
+
+AddBuffer::~AddBuffer() {}
+
+// Appends the text and returns the chunk and the offset inside the chunk where it was put
+std::pair<size_t, size_t> AddBuffer::append(const std::string &text) {
+    return append(text.data(), text.size());
+}
+
+std::pair<size_t, size_t> AddBuffer::append(const char *text, size_t length) {
+    if (m_chunkCount == 0 || getChunk(m_chunkCount - 1).m_capacity - getChunk(m_chunkCount - 1).m_size < length)
+        addChunk(length);
+
+    auto& chunk = getChunk(m_chunkCount - 1);
+    auto offset = chunk.m_size;
+
+    std::memcpy(chunk.m_data.get() + offset, text, length);
+    m_lineBreaks.append(text, length, chunk.m_indexStart + offset);
+    chunk.m_size += length;
+    m_size += length;
+
+    return {m_chunkCount - 1, offset};
+}
+
+// Frees the text of a chunk nothing refers to anymore. The chunk keeps its number and its place
+// in the line break index, so the other chunks stay addressable. The last chunk is still being
+// appended to and is never released.
+void AddBuffer::release(size_t chunk) {
+    auto& released = getChunk(chunk);
+
+    if (chunk + 1 == m_chunkCount || released.m_data == nullptr)
+        return;
+
+    m_lineBreaks.erase(released.m_indexStart, released.m_indexStart + released.m_capacity);
+    m_size -= released.m_size;
+    released.m_data.reset();
+}
+
+const char* AddBuffer::getData(size_t chunk) const { return getChunk(chunk).m_data.get(); }
+
+size_t AddBuffer::getChunkSize(size_t chunk) const { return getChunk(chunk).m_size; }
+
+size_t AddBuffer::getChunkCount() const { return m_chunkCount; }
+
+bool AddBuffer::isReleased(size_t chunk) const { return getChunk(chunk).m_data == nullptr; }
+
+size_t AddBuffer::getSize() const { return m_size; }
+
+size_t AddBuffer::getIndexPosition(size_t chunk, size_t offset) const { return getChunk(chunk).m_indexStart + offset; }
+
+const LineBreakIndex &AddBuffer::getLineBreaks() const { return m_lineBreaks; }
+
+// Chunks double in size up to the maximum, text bigger than that gets a chunk of its own size
+void AddBuffer::addChunk(size_t minimumCapacity) {
+    if (m_chunkCount == m_chunksPerPage * m_maxPages)
+        throw std::length_error("The add buffer has no room for another chunk");
+
+    auto last = m_chunkCount == 0 ? nullptr : &getChunk(m_chunkCount - 1);
+    auto capacity = last == nullptr ? m_firstChunkCapacity : std::min(last->m_capacity * 2, m_maxChunkCapacity);
+    capacity = std::max(capacity, minimumCapacity);
+
+    auto indexStart = last == nullptr ? 0 : last->m_indexStart + last->m_capacity;
+    auto& page = m_pages[m_chunkCount / m_chunksPerPage];
+
+    if (page == nullptr)
+        page.reset(new Chunk[m_chunksPerPage]);
+
+    page[m_chunkCount % m_chunksPerPage] = {std::unique_ptr<char[]>(new char[capacity]), capacity, 0, indexStart};
+    ++m_chunkCount;
+}
+
+AddBuffer::Chunk &AddBuffer::getChunk(size_t chunk) { return m_pages[chunk / m_chunksPerPage][chunk % m_chunksPerPage]; }
+
+const AddBuffer::Chunk &AddBuffer::getChunk(size_t chunk) const { return m_pages[chunk / m_chunksPerPage][chunk % m_chunksPerPage]; }
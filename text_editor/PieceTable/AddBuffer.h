@@ -0,0 +1,61 @@
+#ifndef TEXT_EDITOR_ADDBUFFER_H
+#define TEXT_EDITOR_ADDBUFFER_H
+
+#include "LineBreakIndex.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Append-only store for inserted text made of blocks that never move once allocated.
+// Text is addressed by (chunk, offset) and every append is kept inside a single chunk,
+// so appending never copies older text and pointers into the buffer stay valid.
+// The chunks themselves are kept in pages that never move either, so snapshots read
+// the chunks that existed when they were taken from another thread while appends go on.
+class AddBuffer {
+public:
+    AddBuffer();
+    ~AddBuffer();
+
+    AddBuffer(const AddBuffer&) = delete;
+    AddBuffer& operator=(const AddBuffer&) = delete;
+
+    std::pair<size_t, size_t> append(const std::string& text);
+    std::pair<size_t, size_t> append(const char* text, size_t length);
+    void release(size_t chunk);
+
+    const char* getData(size_t chunk) const;
+    size_t getChunkSize(size_t chunk) const;
+    size_t getChunkCount() const;
+    bool isReleased(size_t chunk) const;
+    size_t getSize() const;
+
+    // Position of the chunk offset in the line break index
+    size_t getIndexPosition(size_t chunk, size_t offset) const;
+    const LineBreakIndex& getLineBreaks() const;
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> m_data;
+        size_t m_capacity;
+        size_t m_size;
+        // Where the chunk starts in the line break index, chunks are laid out one after another
+        size_t m_indexStart;
+    };
+
+    void addChunk(size_t minimumCapacity);
+    Chunk& getChunk(size_t chunk);
+    const Chunk& getChunk(size_t chunk) const;
+
+    static const size_t m_firstChunkCapacity;
+    static const size_t m_maxChunkCapacity;
+    static const size_t m_chunksPerPage;
+    static const size_t m_maxPages;
+
+    std::unique_ptr<std::unique_ptr<Chunk[]>[]> m_pages;
+    size_t m_chunkCount;
+    LineBreakIndex m_lineBreaks;
+    size_t m_size;
+};
+
+
+#endif //TEXT_EDITOR_ADDBUFFER_H
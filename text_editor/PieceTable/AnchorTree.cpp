@@ -0,0 +1,219 @@
+#include "AnchorTree.h"
+
+#include <vector>
+
+Anchor::Anchor(size_t index, AnchorGravity gravity, uint32_t priority)
+    : m_index(index), m_gravity(gravity), m_priority(priority), m_left(nullptr), m_right(nullptr), m_parent(nullptr),
+      m_collapse(false), m_collapseIndex(0), m_shift(0) {}
+
+AnchorGravity Anchor::getGravity() const { return m_gravity; }
+
+AnchorTree::AnchorTree() : m_leftRoot(nullptr), m_rightRoot(nullptr), m_size(0), m_random(std::random_device()()) {}
+
+AnchorTree::~AnchorTree() {
+    destroy(m_leftRoot);
+    destroy(m_rightRoot);
+}
+
+// Anchors before the change stay, the ones inside it collapse onto its start or end by their gravity
+// and the ones after it move by the difference in length
+void AnchorTree::onTextChange(const TextChange &change) {
+    auto start = change.m_index;
+    auto end = change.m_index + change.m_removedLength;
+    auto shift = (int64_t) change.m_insertedLength - (int64_t) change.m_removedLength;
+
+    for (auto gravity : {AnchorGravity::Left, AnchorGravity::Right}) {
+        auto& root = getRoot(gravity);
+        Anchor *before, *rest, *inside, *after;
+
+        split(root, start, false, before, rest);
+
+        // An anchor right after removed text stays after the new text, an anchor at a pure insertion goes by its gravity
+        if (change.m_removedLength != 0)
+            split(rest, end, false, inside, after);
+        else
+            split(rest, start, true, inside, after);
+
+        apply(inside, true, gravity == AnchorGravity::Left ? start : start + change.m_insertedLength, 0);
+        apply(after, false, 0, shift);
+
+        root = merge(merge(before, inside), after);
+        if (root != nullptr)
+            root->m_parent = nullptr;
+    }
+}
+
+// The text is a different one, so every anchor goes to its beginning
+void AnchorTree::onTextReset() {
+    apply(m_leftRoot, true, 0, 0);
+    apply(m_rightRoot, true, 0, 0);
+}
+
+// The anchors have to follow each edit of a batch, the change covering all of them would collapse the ones in between
+bool AnchorTree::tracksPositions() const {
+    return true;
+}
+
+Anchor *AnchorTree::create(size_t index, AnchorGravity gravity) {
+    auto anchor = new Anchor(index, gravity, m_random());
+    insert(anchor);
+    ++m_size;
+
+    return anchor;
+}
+
+void AnchorTree::remove(Anchor *anchor) {
+    if (anchor == nullptr)
+        return;
+
+    detach(anchor);
+    delete anchor;
+    --m_size;
+}
+
+void AnchorTree::move(Anchor *anchor, size_t index) {
+    detach(anchor);
+    anchor->m_index = index;
+    insert(anchor);
+}
+
+// The updates still waiting above the anchor are pushed down the path to it first
+size_t AnchorTree::getIndex(Anchor *anchor) {
+    std::vector<Anchor*> path;
+
+    for (auto node = anchor->m_parent; node != nullptr; node = node->m_parent)
+        path.push_back(node);
+
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+        pushDown(*it);
+
+    return anchor->m_index;
+}
+
+size_t AnchorTree::getSize() const { return m_size; }
+
+Anchor *&AnchorTree::getRoot(AnchorGravity gravity) {
+    return gravity == AnchorGravity::Left ? m_leftRoot : m_rightRoot;
+}
+
+void AnchorTree::insert(Anchor *anchor) {
+    auto& root = getRoot(anchor->m_gravity);
+    Anchor *before, *after;
+
+    anchor->m_left = anchor->m_right = anchor->m_parent = nullptr;
+    anchor->m_collapse = false;
+    anchor->m_shift = 0;
+
+    split(root, anchor->m_index, false, before, after);
+    root = merge(merge(before, anchor), after);
+    root->m_parent = nullptr;
+}
+
+// Takes the anchor out of its tree, its index stays correct
+void AnchorTree::detach(Anchor *anchor) {
+    getIndex(anchor);
+    pushDown(anchor);
+
+    auto child = merge(anchor->m_left, anchor->m_right);
+    auto parent = anchor->m_parent;
+
+    if (child != nullptr)
+        child->m_parent = parent;
+
+    if (parent == nullptr)
+        getRoot(anchor->m_gravity) = child;
+    else if (parent->m_left == anchor)
+        parent->m_left = child;
+    else
+        parent->m_right = child;
+}
+
+void AnchorTree::apply(Anchor *node, bool collapse, size_t collapseIndex, int64_t shift) {
+    if (node == nullptr)
+        return;
+
+    if (collapse) {
+        node->m_index = collapseIndex;
+        node->m_collapse = true;
+        node->m_collapseIndex = collapseIndex;
+        node->m_shift = 0;
+    }
+
+    node->m_index = (size_t) ((int64_t) node->m_index + shift);
+    node->m_shift += shift;
+}
+
+void AnchorTree::pushDown(Anchor *node) {
+    if (!node->m_collapse && node->m_shift == 0)
+        return;
+
+    apply(node->m_left, node->m_collapse, node->m_collapseIndex, node->m_shift);
+    apply(node->m_right, node->m_collapse, node->m_collapseIndex, node->m_shift);
+
+    node->m_collapse = false;
+    node->m_shift = 0;
+}
+
+void AnchorTree::setChildren(Anchor *node, Anchor *left, Anchor *right) {
+    node->m_left = left;
+    node->m_right = right;
+
+    if (left != nullptr)
+        left->m_parent = node;
+    if (right != nullptr)
+        right->m_parent = node;
+}
+
+// Left gets the anchors before the index (or at it, if inclusive), right gets the rest
+void AnchorTree::split(Anchor *node, size_t index, bool inclusive, Anchor *&left, Anchor *&right) {
+    if (node == nullptr) {
+        left = right = nullptr;
+        return;
+    }
+
+    pushDown(node);
+
+    if (node->m_index < index || (inclusive && node->m_index == index)) {
+        Anchor* middle;
+        split(node->m_right, index, inclusive, middle, right);
+        setChildren(node, node->m_left, middle);
+        left = node;
+    } else {
+        Anchor* middle;
+        split(node->m_left, index, inclusive, left, middle);
+        setChildren(node, middle, node->m_right);
+        right = node;
+    }
+
+    if (left != nullptr)
+        left->m_parent = nullptr;
+    if (right != nullptr)
+        right->m_parent = nullptr;
+}
+
+// Every anchor in left has to come before every anchor in right
+Anchor *AnchorTree::merge(Anchor *left, Anchor *right) {
+    if (left == nullptr)
+        return right;
+    if (right == nullptr)
+        return left;
+
+    if (left->m_priority > right->m_priority) {
+        pushDown(left);
+        setChildren(left, left->m_left, merge(left->m_right, right));
+        return left;
+    } else {
+        pushDown(right);
+        setChildren(right, merge(left, right->m_left), right->m_right);
+        return right;
+    }
+}
+
+void AnchorTree::destroy(Anchor *node) {
+    if (node == nullptr)
+        return;
+
+    destroy(node->m_left);
+    destroy(node->m_right);
+    delete node;
+}
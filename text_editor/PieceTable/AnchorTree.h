@@ -0,0 +1,79 @@
+#ifndef TEXT_EDITOR_ANCHORTREE_H
+#define TEXT_EDITOR_ANCHORTREE_H
+
+#include "TextChangeListener.h"
+
+#include <cstdint>
+#include <random>
+
+// Which way an anchor goes when text is inserted exactly at it. A left anchor stays before the inserted
+// text and a right anchor moves after it, so a right anchor stays attached to the character on its right.
+enum class AnchorGravity {
+    Left,
+    Right
+};
+
+// A position in the text that moves along with the edits. Anchors are created and destroyed by an AnchorTree.
+class Anchor {
+public:
+    AnchorGravity getGravity() const;
+private:
+    friend class AnchorTree;
+
+    Anchor(size_t index, AnchorGravity gravity, uint32_t priority);
+
+    size_t m_index;
+    AnchorGravity m_gravity;
+    uint32_t m_priority;
+    Anchor* m_left;
+    Anchor* m_right;
+    Anchor* m_parent;
+    // Update the subtree is still waiting for: first every index becomes m_collapseIndex if m_collapse is set,
+    // then m_shift is added to it
+    bool m_collapse;
+    size_t m_collapseIndex;
+    int64_t m_shift;
+};
+
+// Keeps anchors sorted by their index in a treap for each gravity. An edit splits a tree around the changed range,
+// collapses the anchors inside the range onto its start or end and shifts the ones after it. Both updates are
+// stored lazily at the root of the subtree, so a change costs O(log n) no matter how many anchors it moves.
+class AnchorTree : public TextChangeListener {
+public:
+    AnchorTree();
+    ~AnchorTree() override;
+
+    AnchorTree(const AnchorTree&) = delete;
+    AnchorTree& operator=(const AnchorTree&) = delete;
+
+    void onTextChange(const TextChange& change) override;
+    void onTextReset() override;
+    bool tracksPositions() const override;
+
+    Anchor* create(size_t index, AnchorGravity gravity = AnchorGravity::Left);
+    void remove(Anchor* anchor);
+    void move(Anchor* anchor, size_t index);
+
+    size_t getIndex(Anchor* anchor);
+    size_t getSize() const;
+private:
+    Anchor*& getRoot(AnchorGravity gravity);
+
+    void insert(Anchor* anchor);
+    void detach(Anchor* anchor);
+
+    static void apply(Anchor* node, bool collapse, size_t collapseIndex, int64_t shift);
+    static void pushDown(Anchor* node);
+    static void setChildren(Anchor* node, Anchor* left, Anchor* right);
+    static void split(Anchor* node, size_t index, bool inclusive, Anchor*& left, Anchor*& right);
+    static Anchor* merge(Anchor* left, Anchor* right);
+    static void destroy(Anchor* node);
+
+    Anchor* m_leftRoot;
+    Anchor* m_rightRoot;
+    size_t m_size;
+    std::mt19937 m_random;
+};
+
+
+#endif //TEXT_EDITOR_ANCHORTREE_H
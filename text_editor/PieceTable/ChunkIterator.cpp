@@ -0,0 +1,139 @@
+#include "ChunkIterator.h"
+#include "DocumentSnapshot.h"
+#include "PieceTable.h"
+
+// Positions the iterator on the chunk that contains index, or on the end if index is past the text
+ChunkIterator::ChunkIterator(const PieceTable *table, size_t index)
+    : m_root(table->m_pieces.getRoot()), m_originalData(table->m_originalBuffer->data()), m_addBuffer(table->m_addBuffer.get()),
+      m_regionCount(0), m_region(0), m_offset(0) {
+    auto size = table->m_size;
+
+    if (!table->m_insertBuffer->isFlushed()) {
+        m_insertedText = table->m_insertBuffer->getContent();
+        addRegions(size, table->m_insertBuffer->getStartIndex(), size, size);
+    } else if (!table->m_deleteBuffer->isFlushed()) {
+        addRegions(size, size, table->m_deleteBuffer->getStartIndex(), table->m_deleteBuffer->getEndIndex());
+    } else {
+        addRegions(size, size, size, size);
+    }
+
+    moveTo(index);
+}
+
+ChunkIterator::ChunkIterator(const DocumentSnapshot *snapshot, size_t index)
+    : m_root(snapshot->m_root), m_originalData(snapshot->m_originalBuffer == nullptr ? nullptr : snapshot->m_originalBuffer->data()),
+      m_addBuffer(snapshot->m_addBuffer.get()), m_insertedText(snapshot->m_insertedText), m_regionCount(0), m_region(0), m_offset(0) {
+    addRegions(snapshot->m_piecesSize, snapshot->m_insertIndex, snapshot->m_deleteStart, snapshot->m_deleteEnd);
+    moveTo(index);
+}
+
+std::string_view ChunkIterator::operator*() const { return m_chunk; }
+
+ChunkIterator &ChunkIterator::operator++() {
+    m_offset += m_chunk.size();
+    auto& region = m_regions[m_region];
+
+    if (!region.m_isInsertBuffer && m_piece.getPieceStartOffset() + m_piece->getLength() < region.m_end) {
+        ++m_piece;
+    } else if (++m_region < m_regionCount) {
+        if (!m_regions[m_region].m_isInsertBuffer)
+            m_piece = PieceTree::Iterator(m_root, m_regions[m_region].m_start);
+    } else {
+        m_chunk = std::string_view();
+        return *this;
+    }
+
+    loadChunk();
+    return *this;
+}
+
+ChunkIterator &ChunkIterator::operator--() {
+    bool insidePieces = m_region < m_regionCount && !m_regions[m_region].m_isInsertBuffer &&
+            m_piece.getPieceStartOffset() > m_regions[m_region].m_start;
+
+    if (insidePieces) {
+        --m_piece;
+    } else if (m_region > 0) {
+        --m_region;
+        if (!m_regions[m_region].m_isInsertBuffer)
+            m_piece = PieceTree::Iterator(m_root, m_regions[m_region].m_end - 1);
+    } else {
+        // Already on the first chunk
+        return *this;
+    }
+
+    loadChunk();
+    m_offset -= m_chunk.size();
+    return *this;
+}
+
+bool ChunkIterator::operator==(const ChunkIterator &other) const {
+    return m_root == other.m_root && m_offset == other.m_offset && isEnd() == other.isEnd();
+}
+
+bool ChunkIterator::operator!=(const ChunkIterator &other) const { return !(*this == other); }
+
+// Returns the index of the first character of the chunk in the shown text
+size_t ChunkIterator::getOffset() const { return m_offset; }
+
+bool ChunkIterator::isEnd() const { return m_region >= m_regionCount; }
+
+// The shown text is the flushed text with the inserted text put in, or the deleted range taken out
+void ChunkIterator::addRegions(size_t size, size_t insertIndex, size_t deleteStart, size_t deleteEnd) {
+    if (!m_insertedText.empty()) {
+        auto start = std::min(insertIndex, size);
+
+        addRegion(0, start, false);
+        addRegion(0, m_insertedText.size(), true);
+        addRegion(start, size, false);
+    } else {
+        auto start = std::min(deleteStart, size);
+        auto end = std::min(deleteEnd, size);
+
+        addRegion(0, start, false);
+        addRegion(end, size, false);
+    }
+}
+
+void ChunkIterator::addRegion(size_t start, size_t end, bool isInsertBuffer) {
+    if (start < end)
+        m_regions[m_regionCount++] = {start, end, isInsertBuffer};
+}
+
+void ChunkIterator::moveTo(size_t index) {
+    for (; m_region < m_regionCount; ++m_region) {
+        auto& region = m_regions[m_region];
+        auto regionLength = region.m_end - region.m_start;
+
+        if (index < m_offset + regionLength) {
+            if (!region.m_isInsertBuffer)
+                m_piece = PieceTree::Iterator(m_root, region.m_start + index - m_offset);
+
+            loadChunk();
+
+            if (!region.m_isInsertBuffer)
+                m_offset += std::max(m_piece.getPieceStartOffset(), region.m_start) - region.m_start;
+
+            return;
+        }
+
+        m_offset += regionLength;
+    }
+}
+
+// Sets the chunk to the current piece clipped to the current region
+void ChunkIterator::loadChunk() {
+    auto& region = m_regions[m_region];
+
+    if (region.m_isInsertBuffer) {
+        m_chunk = m_insertedText;
+        return;
+    }
+
+    auto pieceStart = m_piece.getPieceStartOffset();
+    auto start = std::max(pieceStart, region.m_start);
+    auto end = std::min(pieceStart + m_piece->getLength(), region.m_end);
+    auto buffer = m_piece->getSource() == SourceType::Original ? m_originalData : m_addBuffer->getData(m_piece->getChunk());
+
+    m_chunk = std::string_view(buffer + m_piece->getStart() + (start - pieceStart), end - start);
+}
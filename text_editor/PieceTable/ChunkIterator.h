@@ -0,0 +1,55 @@
+#ifndef TEXT_EDITOR_CHUNKITERATOR_H
+#define TEXT_EDITOR_CHUNKITERATOR_H
+
+#include "PieceTree.h"
+
+#include <string_view>
+
+class AddBuffer;
+class DocumentSnapshot;
+class PieceTable;
+
+// Iterates over the text of a PieceTable or a DocumentSnapshot as it is shown, one contiguous chunk at a time.
+// Chunks are views straight into the original and add buffers or the unflushed insert buffer,
+// so reading the text never copies it. Any edit of the table invalidates an iterator over the table,
+// an iterator over a snapshot stays valid as long as the snapshot does.
+class ChunkIterator {
+public:
+    ChunkIterator(const PieceTable* table, size_t index);
+    ChunkIterator(const DocumentSnapshot* snapshot, size_t index);
+
+    std::string_view operator*() const;
+    ChunkIterator& operator++();
+    ChunkIterator& operator--();
+    bool operator==(const ChunkIterator& other) const;
+    bool operator!=(const ChunkIterator& other) const;
+
+    size_t getOffset() const;
+    bool isEnd() const;
+private:
+    // A run of flushed text [m_start, m_end) or the content of the insert buffer
+    struct Region {
+        size_t m_start;
+        size_t m_end;
+        bool m_isInsertBuffer;
+    };
+
+    void addRegions(size_t size, size_t insertIndex, size_t deleteStart, size_t deleteEnd);
+    void addRegion(size_t start, size_t end, bool isInsertBuffer);
+    void moveTo(size_t index);
+    void loadChunk();
+
+    const PieceTree::Node* m_root;
+    const char* m_originalData;
+    const AddBuffer* m_addBuffer;
+    std::string_view m_insertedText;
+    Region m_regions[3];
+    size_t m_regionCount;
+    size_t m_region;
+    PieceTree::Iterator m_piece;
+    std::string_view m_chunk;
+    size_t m_offset;
+};
+
+
+#endif //TEXT_EDITOR_CHUNKITERATOR_H
@@ -5,6 +5,7 @@
 #ifndef TEXT_EDITOR_DELETEBUFFER_H
 #define TEXT_EDITOR_DELETEBUFFER_H
 
+#include <cstddef>
 
 class DeleteBuffer {
 public:
@@ -0,0 +1,216 @@
+#include "DocumentSnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+DocumentSnapshot::DocumentSnapshot()
+    : m_root(nullptr), m_insertIndex(0), m_deleteStart(0), m_deleteEnd(0), m_piecesSize(0), m_version(0) {}
+
+// The copy takes its own reference to the root, the rest of the tree stays shared
+DocumentSnapshot::DocumentSnapshot(const DocumentSnapshot &other)
+    : m_root(other.m_root), m_nodePool(other.m_nodePool), m_originalBuffer(other.m_originalBuffer),
+      m_originalLineBreaks(other.m_originalLineBreaks), m_addBuffer(other.m_addBuffer),
+      m_insertedText(other.m_insertedText), m_insertIndex(other.m_insertIndex), m_deleteStart(other.m_deleteStart),
+      m_deleteEnd(other.m_deleteEnd), m_piecesSize(other.m_piecesSize), m_version(other.m_version) {
+    if (m_root != nullptr)
+        m_root->m_refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+DocumentSnapshot::DocumentSnapshot(DocumentSnapshot &&other) noexcept
+    : m_root(other.m_root), m_nodePool(std::move(other.m_nodePool)), m_originalBuffer(std::move(other.m_originalBuffer)),
+      m_originalLineBreaks(std::move(other.m_originalLineBreaks)), m_addBuffer(std::move(other.m_addBuffer)),
+      m_insertedText(std::move(other.m_insertedText)), m_insertIndex(other.m_insertIndex), m_deleteStart(other.m_deleteStart),
+      m_deleteEnd(other.m_deleteEnd), m_piecesSize(other.m_piecesSize), m_version(other.m_version) {
+    other.m_root = nullptr;
+}
+
+DocumentSnapshot &DocumentSnapshot::operator=(DocumentSnapshot other) {
+    std::swap(m_root, other.m_root);
+    std::swap(m_nodePool, other.m_nodePool);
+    std::swap(m_originalBuffer, other.m_originalBuffer);
+    std::swap(m_originalLineBreaks, other.m_originalLineBreaks);
+    std::swap(m_addBuffer, other.m_addBuffer);
+    std::swap(m_insertedText, other.m_insertedText);
+    std::swap(m_insertIndex, other.m_insertIndex);
+    std::swap(m_deleteStart, other.m_deleteStart);
+    std::swap(m_deleteEnd, other.m_deleteEnd);
+    std::swap(m_piecesSize, other.m_piecesSize);
+    std::swap(m_version, other.m_version);
+    return *this;
+}
+
+// Frees the nodes only this snapshot was still referring to
+DocumentSnapshot::~DocumentSnapshot() {
+    if (m_root != nullptr)
+        PieceTree::release(m_root, *m_nodePool);
+}
+
+// The version of the table the snapshot was taken at, every visible change of the table increments it
+size_t DocumentSnapshot::getVersion() const { return m_version; }
+
+size_t DocumentSnapshot::getSize() const {
+    return m_piecesSize + m_insertedText.size() - (m_deleteEnd - m_deleteStart);
+}
+
+bool DocumentSnapshot::isEmpty() const { return getSize() == 0; }
+
+std::string DocumentSnapshot::getText(size_t index, size_t length) const {
+    std::string text;
+    text.reserve(std::min(length, getSize()));
+
+    for (auto it = chunkAt(index); !it.isEnd() && text.size() < length; ++it) {
+        auto chunk = *it;
+        auto skip = index > it.getOffset() ? index - it.getOffset() : 0;
+        text.append(chunk.substr(skip, length - text.size()));
+    }
+
+    return text;
+}
+
+ChunkIterator DocumentSnapshot::chunkBegin() const { return {this, 0}; }
+
+ChunkIterator DocumentSnapshot::chunkEnd() const { return {this, std::string::npos}; }
+
+ChunkIterator DocumentSnapshot::chunkAt(size_t index) const { return {this, index}; }
+
+size_t DocumentSnapshot::getLineCount() const { return countLineBreaksBefore(getSize()) + 1; }
+
+size_t DocumentSnapshot::getLineStart(size_t line) const {
+    if (line == 0)
+        return 0;
+
+    return findLineBreak(line - 1) + 1;
+}
+
+std::pair<size_t, size_t> DocumentSnapshot::getLineAndColumn(size_t index) const {
+    auto line = countLineBreaksBefore(index);
+    return {line, index - getLineStart(line)};
+}
+
+// Same as PieceTable::countLineBreaksBefore, with the buffers as they were when the snapshot was taken
+size_t DocumentSnapshot::countLineBreaksBefore(size_t index) const {
+    if (!m_insertedText.empty()) {
+        if (index <= m_insertIndex)
+            return countPieceLineBreaksBefore(index);
+
+        auto textLength = std::min(index - m_insertIndex, m_insertedText.size());
+        auto textLineBreaks = (size_t) std::count(m_insertedText.begin(), m_insertedText.begin() + textLength, '\n');
+
+        return countPieceLineBreaksBefore(index - textLength) + textLineBreaks;
+    }
+
+    if (m_deleteStart < m_deleteEnd) {
+        if (index <= m_deleteStart)
+            return countPieceLineBreaksBefore(index);
+
+        auto deletedLineBreaks = countPieceLineBreaksBefore(m_deleteEnd) - countPieceLineBreaksBefore(m_deleteStart);
+        return countPieceLineBreaksBefore(index + m_deleteEnd - m_deleteStart) - deletedLineBreaks;
+    }
+
+    return countPieceLineBreaksBefore(index);
+}
+
+// Same as PieceTable::findLineBreak, with the buffers as they were when the snapshot was taken
+size_t DocumentSnapshot::findLineBreak(size_t n) const {
+    if (!m_insertedText.empty()) {
+        auto lineBreaksBefore = countPieceLineBreaksBefore(m_insertIndex);
+
+        if (n < lineBreaksBefore)
+            return findPieceLineBreak(n);
+
+        n -= lineBreaksBefore;
+
+        for (size_t i=0; i<m_insertedText.size(); ++i) {
+            if (m_insertedText[i] == '\n' && n-- == 0)
+                return m_insertIndex + i;
+        }
+
+        return findPieceLineBreak(lineBreaksBefore + n) + m_insertedText.size();
+    }
+
+    if (m_deleteStart < m_deleteEnd) {
+        auto lineBreaksBefore = countPieceLineBreaksBefore(m_deleteStart);
+
+        if (n < lineBreaksBefore)
+            return findPieceLineBreak(n);
+
+        auto deletedLineBreaks = countPieceLineBreaksBefore(m_deleteEnd) - lineBreaksBefore;
+        return findPieceLineBreak(n + deletedLineBreaks) - (m_deleteEnd - m_deleteStart);
+    }
+
+    return findPieceLineBreak(n);
+}
+
+// Counts the line breaks in [0, offset) of the pieces. The nodes cache the counts of their subtrees, only the piece
+// the offset falls into is looked at. The add buffer's line break index keeps changing on the UI thread,
+// so add buffer pieces are scanned instead, while the original buffer's index never changes once it is built.
+size_t DocumentSnapshot::countPieceLineBreaksBefore(size_t offset) const {
+    size_t result = 0;
+    auto node = m_root;
+
+    while (node != nullptr) {
+        auto leftLength = node->m_left == nullptr ? 0 : node->m_left->m_length;
+        auto leftLineBreaks = node->m_left == nullptr ? 0 : node->m_left->m_lineBreaks;
+        auto& piece = node->m_piece;
+
+        if (offset <= leftLength) {
+            node = node->m_left;
+        } else if (offset < leftLength + piece.getLength()) {
+            auto length = offset - leftLength;
+
+            if (piece.getSource() == SourceType::Original)
+                return result + leftLineBreaks + m_originalLineBreaks->count(piece.getStart(), length);
+
+            auto data = getPieceData(piece);
+            return result + leftLineBreaks + (size_t) std::count(data, data + length, '\n');
+        } else {
+            result += leftLineBreaks + piece.getLineBreaks();
+            offset -= leftLength + piece.getLength();
+            node = node->m_right;
+        }
+    }
+
+    return result;
+}
+
+// Returns the offset of the n-th (zero based) line break of the pieces
+size_t DocumentSnapshot::findPieceLineBreak(size_t n) const {
+    size_t offset = 0;
+    auto node = m_root;
+
+    while (node != nullptr) {
+        auto leftLength = node->m_left == nullptr ? 0 : node->m_left->m_length;
+        auto leftLineBreaks = node->m_left == nullptr ? 0 : node->m_left->m_lineBreaks;
+        auto& piece = node->m_piece;
+
+        if (n < leftLineBreaks) {
+            node = node->m_left;
+        } else if (n < leftLineBreaks + piece.getLineBreaks()) {
+            n -= leftLineBreaks;
+            offset += leftLength;
+
+            if (piece.getSource() == SourceType::Original)
+                return offset + m_originalLineBreaks->find(piece.getStart(), n) - piece.getStart();
+
+            auto data = getPieceData(piece);
+            auto end = data + piece.getLength();
+
+            for (auto it = data; ; ++it) {
+                it = static_cast<const char*>(std::memchr(it, '\n', end - it));
+                if (n-- == 0)
+                    return offset + (it - data);
+            }
+        } else {
+            n -= leftLineBreaks + piece.getLineBreaks();
+            offset += leftLength + piece.getLength();
+            node = node->m_right;
+        }
+    }
+
+    return offset;
+}
+
+const char *DocumentSnapshot::getPieceData(const PieceDescriptor &piece) const {
+    auto buffer = piece.getSource() == SourceType::Original ? m_originalBuffer->data() : m_addBuffer->getData(piece.getChunk());
+    return buffer + piece.getStart();
+}
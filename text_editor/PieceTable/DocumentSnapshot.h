@@ -0,0 +1,64 @@
+#ifndef TEXT_EDITOR_DOCUMENTSNAPSHOT_H
+#define TEXT_EDITOR_DOCUMENTSNAPSHOT_H
+
+#include "AddBuffer.h"
+#include "ChunkIterator.h"
+#include "LineBreakIndex.h"
+#include "OriginalBuffer.h"
+#include "PieceTree.h"
+
+#include <memory>
+#include <string>
+
+class PieceTable;
+
+// Immutable view of a PieceTable's text at one version, made for reading the document off the UI thread.
+// It shares the piece tree nodes with the table, which copies a shared node before changing it,
+// so taking a snapshot is O(1) and every later edit copies only the O(log n) nodes it touches.
+// Copying a snapshot is cheap and a snapshot stays valid after the table is edited or destroyed.
+// A snapshot can be read from any thread, but a single snapshot object must not be used by two threads at once.
+class DocumentSnapshot {
+public:
+    friend class ChunkIterator;
+    friend class PieceTable;
+
+    DocumentSnapshot();
+    DocumentSnapshot(const DocumentSnapshot& other);
+    DocumentSnapshot(DocumentSnapshot&& other) noexcept;
+    DocumentSnapshot& operator=(DocumentSnapshot other);
+    ~DocumentSnapshot();
+
+    size_t getVersion() const;
+    size_t getSize() const;
+    bool isEmpty() const;
+    std::string getText(size_t index, size_t length) const;
+    ChunkIterator chunkBegin() const;
+    ChunkIterator chunkEnd() const;
+    ChunkIterator chunkAt(size_t index) const;
+    size_t getLineCount() const;
+    size_t getLineStart(size_t line) const;
+    std::pair<size_t, size_t> getLineAndColumn(size_t index) const;
+private:
+    size_t countLineBreaksBefore(size_t index) const;
+    size_t findLineBreak(size_t n) const;
+    size_t countPieceLineBreaksBefore(size_t offset) const;
+    size_t findPieceLineBreak(size_t n) const;
+    const char* getPieceData(const PieceDescriptor& piece) const;
+
+    const PieceTree::Node* m_root;
+    std::shared_ptr<PieceTree::NodePool> m_nodePool;
+    std::shared_ptr<const OriginalBuffer> m_originalBuffer;
+    std::shared_ptr<const LineBreakIndex> m_originalLineBreaks;
+    std::shared_ptr<const AddBuffer> m_addBuffer;
+    // Copy of the unflushed insert buffer and the range of the unflushed delete buffer,
+    // the range is empty when nothing is waiting to be deleted
+    std::string m_insertedText;
+    size_t m_insertIndex;
+    size_t m_deleteStart;
+    size_t m_deleteEnd;
+    size_t m_piecesSize;
+    size_t m_version;
+};
+
+
+#endif //TEXT_EDITOR_DOCUMENTSNAPSHOT_H
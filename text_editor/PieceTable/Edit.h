@@ -0,0 +1,16 @@
+#ifndef TEXT_EDITOR_EDIT_H
+#define TEXT_EDITOR_EDIT_H
+
+#include <cstddef>
+#include <string>
+
+// One replacement of a batch passed to PieceTable::applyEdits. The removed range
+// [m_index, m_index + m_removedLength) is given in the text from before the batch.
+struct Edit {
+    size_t m_index;
+    size_t m_removedLength;
+    std::string m_text;
+};
+
+
+#endif //TEXT_EDITOR_EDIT_H
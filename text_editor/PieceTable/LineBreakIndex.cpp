@@ -0,0 +1,49 @@
+#include "LineBreakIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+LineBreakIndex::LineBreakIndex() {}
+
+LineBreakIndex::~LineBreakIndex() {}
+
+// Records the line breaks of text that was written to the buffer at offset.
+// Text has to be appended in buffer order, so the positions stay sorted.
+void LineBreakIndex::append(const char *text, size_t length, size_t offset) {
+    auto it = text;
+    auto end = text + length;
+
+    while (it != end) {
+        auto lineBreak = static_cast<const char*>(std::memchr(it, '\n', end - it));
+
+        if (lineBreak == nullptr)
+            break;
+
+        m_positions.push_back(offset + (lineBreak - text));
+        it = lineBreak + 1;
+    }
+}
+
+// Removes the line breaks in the buffer range [start, end)
+void LineBreakIndex::erase(size_t start, size_t end) {
+    auto first = std::lower_bound(m_positions.begin(), m_positions.end(), start);
+    auto last = std::lower_bound(first, m_positions.end(), end);
+    m_positions.erase(first, last);
+}
+
+void LineBreakIndex::clear() { m_positions.clear(); }
+
+// Returns the number of line breaks in the buffer range [start, start + length)
+size_t LineBreakIndex::count(size_t start, size_t length) const {
+    auto first = std::lower_bound(m_positions.begin(), m_positions.end(), start);
+    auto last = std::lower_bound(first, m_positions.end(), start + length);
+    return last - first;
+}
+
+// Returns the buffer offset of the n-th (zero based) line break at or after start
+size_t LineBreakIndex::find(size_t start, size_t n) const {
+    auto first = std::lower_bound(m_positions.begin(), m_positions.end(), start);
+    return *(first + n);
+}
+
+size_t LineBreakIndex::getSize() const { return m_positions.size(); }
@@ -0,0 +1,26 @@
+#ifndef TEXT_EDITOR_LINEBREAKINDEX_H
+#define TEXT_EDITOR_LINEBREAKINDEX_H
+
+#include <cstddef>
+#include <vector>
+
+// Sorted positions of the '\n' characters of one piece table buffer.
+// Lets pieces count and locate their line breaks with a binary search instead of a scan.
+class LineBreakIndex {
+public:
+    LineBreakIndex();
+    ~LineBreakIndex();
+
+    void append(const char* text, size_t length, size_t offset);
+    void erase(size_t start, size_t end);
+    void clear();
+
+    size_t count(size_t start, size_t length) const;
+    size_t find(size_t start, size_t n) const;
+    size_t getSize() const;
+private:
+    std::vector<size_t> m_positions;
+};
+
+
+#endif //TEXT_EDITOR_LINEBREAKINDEX_H
@@ -0,0 +1,46 @@
+#ifndef TEXT_EDITOR_LINEREADER_H
+#define TEXT_EDITOR_LINEREADER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Calls the callback with the lines [start, end) of a PieceTable or a DocumentSnapshot one after another, read in
+// a single pass over its chunks, until it returns false
+template <typename Text>
+void readLines(const Text& text, size_t start, size_t end, const std::function<bool(size_t, std::string&)>& callback) {
+    if (start >= end)
+        return;
+
+    auto lineStart = text.getLineStart(start);
+    std::string line;
+    size_t row = start;
+
+    for (auto it = text.chunkAt(lineStart); !it.isEnd(); ++it) {
+        auto chunk = *it;
+
+        // The first chunk can start before the line
+        if (it.getOffset() < lineStart)
+            chunk.remove_prefix(lineStart - it.getOffset());
+
+        while (!chunk.empty()) {
+            auto newLine = chunk.find('\n');
+            line.append(chunk.substr(0, newLine));
+
+            if (newLine == std::string_view::npos)
+                break;
+
+            if (!callback(row, line) || ++row == end)
+                return;
+
+            line.clear();
+            chunk.remove_prefix(newLine + 1);
+        }
+    }
+
+    // The last line doesn't end with a line break
+    callback(row, line);
+}
+
+
+#endif //TEXT_EDITOR_LINEREADER_H
@@ -0,0 +1,136 @@
+#include "OriginalBuffer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+OriginalBuffer::OriginalBuffer() : m_data(m_text.data()), m_size(0)
+#ifdef _WIN32
+    , m_file(nullptr), m_mapping(nullptr)
+#endif
+{}
+
+OriginalBuffer::OriginalBuffer(const std::string &text) : m_text(text), m_data(m_text.data()), m_size(m_text.size())
+#ifdef _WIN32
+    , m_file(nullptr), m_mapping(nullptr)
+#endif
+{}
+
+OriginalBuffer::~OriginalBuffer() {
+    unmap();
+}
+
+// Maps the file read-only into memory, returns false if the file couldn't be mapped
+bool OriginalBuffer::map(const std::string &filePath) {
+    unmap();
+
+#ifdef _WIN32
+    auto file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const char*>(view);
+    m_size = (size_t) fileSize.QuadPart;
+#else
+    auto file = ::open(filePath.c_str(), O_RDONLY);
+    if (file == -1)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) == -1 || fileStat.st_size == 0) {
+        ::close(file);
+        return false;
+    }
+
+    auto view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping stays valid after the file is closed
+    ::close(file);
+
+    if (view == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<const char*>(view);
+    m_size = (size_t) fileStat.st_size;
+#endif
+
+    m_text.clear();
+    m_mappedPath = filePath;
+    return true;
+}
+
+// Makes room in memory for size characters that the caller writes itself, the memory doesn't move afterwards
+char* OriginalBuffer::allocate(size_t size) {
+    unmap();
+
+    m_text.assign(size, '\0');
+    m_data = m_text.data();
+    m_size = m_text.size();
+    return m_text.data();
+}
+
+// Copies the mapped text into memory and releases the mapping, so the file can be overwritten
+void OriginalBuffer::detach() {
+    if (!isMapped())
+        return;
+
+    std::string text(m_data, m_size);
+    unmap();
+
+    m_text = std::move(text);
+    m_data = m_text.data();
+    m_size = m_text.size();
+}
+
+const char* OriginalBuffer::data() const { return m_data; }
+
+size_t OriginalBuffer::size() const { return m_size; }
+
+bool OriginalBuffer::isMapped() const { return !m_mappedPath.empty(); }
+
+const std::string& OriginalBuffer::getMappedPath() const { return m_mappedPath; }
+
+void OriginalBuffer::unmap() {
+    if (!isMapped())
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_file = nullptr;
+    m_mapping = nullptr;
+#else
+    munmap(const_cast<char*>(m_data), m_size);
+#endif
+
+    m_mappedPath.clear();
+    m_data = m_text.data();
+    m_size = m_text.size();
+}
@@ -0,0 +1,39 @@
+#ifndef TEXT_EDITOR_ORIGINALBUFFER_H
+#define TEXT_EDITOR_ORIGINALBUFFER_H
+
+#include <string>
+
+// Holds the text a PieceTable was created with. The text is either kept in memory
+// or is a read-only mapping of the opened file, so only the parts that are read get loaded.
+class OriginalBuffer {
+public:
+    OriginalBuffer();
+    explicit OriginalBuffer(const std::string& text);
+    ~OriginalBuffer();
+
+    OriginalBuffer(const OriginalBuffer&) = delete;
+    OriginalBuffer& operator=(const OriginalBuffer&) = delete;
+
+    bool map(const std::string& filePath);
+    char* allocate(size_t size);
+    void detach();
+
+    const char* data() const;
+    size_t size() const;
+    bool isMapped() const;
+    const std::string& getMappedPath() const;
+private:
+    void unmap();
+
+    std::string m_text;
+    const char* m_data;
+    size_t m_size;
+    std::string m_mappedPath;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+};
+
+
+#endif //TEXT_EDITOR_ORIGINALBUFFER_H
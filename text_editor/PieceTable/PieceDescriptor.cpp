@@ -6,18 +6,18 @@
 
 std::ostream& operator<<(std::ostream& out, const PieceDescriptor& piece) {
     out << (piece.getSource() == SourceType::Add ? "Add, " : "Original, ")
-        << piece.getStart() << ", " << piece.getLength();
+        << piece.getChunk() << ", " << piece.getStart() << ", " << piece.getLength();
     return out;
 }
 
-PieceDescriptor::PieceDescriptor(SourceType source, size_t start, size_t length)
-    : m_source(source), m_start(start), m_length(length) {}
+PieceDescriptor::PieceDescriptor(SourceType source, size_t chunk, size_t start, size_t length, size_t lineBreaks)
+    : m_source(source), m_chunk(chunk), m_start(start), m_length(length), m_lineBreaks(lineBreaks) {}
 
-PieceDescriptor::PieceDescriptor(PieceDescriptor &piece)
-    : m_source(piece.getSource()), m_start(piece.getStart()), m_length(piece.getLength()) {}
+PieceDescriptor::PieceDescriptor(const PieceDescriptor &piece)
+    : m_source(piece.getSource()), m_chunk(piece.getChunk()), m_start(piece.getStart()), m_length(piece.getLength()), m_lineBreaks(piece.getLineBreaks()) {}
 
 PieceDescriptor::PieceDescriptor(PieceDescriptor *piece)
-    : m_source(piece->getSource()), m_start(piece->getStart()), m_length(piece->getLength())  {}
+    : m_source(piece->getSource()), m_chunk(piece->getChunk()), m_start(piece->getStart()), m_length(piece->getLength()), m_lineBreaks(piece->getLineBreaks())  {}
 
 PieceDescriptor::~PieceDescriptor() {}
 
@@ -25,6 +25,10 @@ SourceType PieceDescriptor::getSource() const {
     return m_source;
 }
 
+size_t PieceDescriptor::getChunk() const {
+    return m_chunk;
+}
+
 size_t PieceDescriptor::getStart() const {
     return m_start;
 }
@@ -33,10 +37,18 @@ size_t PieceDescriptor::getLength() const {
     return m_length;
 }
 
+size_t PieceDescriptor::getLineBreaks() const {
+    return m_lineBreaks;
+}
+
 void PieceDescriptor::setSource(SourceType mSource) {
     m_source = mSource;
 }
 
+void PieceDescriptor::setChunk(size_t chunk) {
+    m_chunk = chunk;
+}
+
 void PieceDescriptor::setStart(size_t mStart) {
     m_start = mStart;
 }
@@ -45,43 +57,15 @@ void PieceDescriptor::setLength(size_t mLength) {
     m_length = mLength;
 }
 
-std::pair<PieceDescriptor *, PieceDescriptor *> PieceDescriptor::splitPiece(PieceDescriptor *piece, size_t splitIndex) {
-    if (splitIndex == 0 || splitIndex >= piece->getLength()) {
-        std::cerr << "SplitPiece returned nullptr" << std::endl;
-        return {nullptr, nullptr};
-    }
-
-    auto leftPiece = new PieceDescriptor(piece->getSource(), piece->getStart(), splitIndex);
-    auto rightPiece = new PieceDescriptor(piece->getSource(), piece->getStart() + splitIndex, piece->getLength() - splitIndex);
-
-    return {leftPiece, rightPiece};
+void PieceDescriptor::setLineBreaks(size_t lineBreaks) {
+    m_lineBreaks = lineBreaks;
 }
 
-PieceDescriptor* PieceDescriptor::cutoffFromLeft(PieceDescriptor *piece, size_t offset) {
-    if (offset >= piece->getLength() || offset == 0) {
-        std::cerr << "cutoffFromLeft returned nullptr" << std::endl;
-        return nullptr;
-    }
-
-    auto cutoffPiece = new PieceDescriptor(piece->getSource(), piece->getStart(), offset);
+// Splits the piece into [0, splitIndex) and [splitIndex, length), splitIndex has to be inside the piece.
+// The line breaks of the halves are left for the caller to count.
+std::pair<PieceDescriptor, PieceDescriptor> PieceDescriptor::splitPiece(const PieceDescriptor& piece, size_t splitIndex) {
+    PieceDescriptor leftPiece(piece.getSource(), piece.getChunk(), piece.getStart(), splitIndex);
+    PieceDescriptor rightPiece(piece.getSource(), piece.getChunk(), piece.getStart() + splitIndex, piece.getLength() - splitIndex);
 
-    piece->setStart(piece->getStart() + offset);
-    piece->setLength(piece->getLength() - offset);
-
-    return cutoffPiece;
-}
-
-PieceDescriptor* PieceDescriptor::cutoffFromRight(PieceDescriptor *piece, size_t offset) {
-    if (offset >= piece->getLength() || offset == 0) {
-        std::cerr << "cutoffFromRight returned nullptr" << std::endl;
-        return nullptr;
-    }
-
-    auto cutoffPiece = new PieceDescriptor(piece->getSource(), piece->getStart() + piece->getLength() - offset, offset);
-
-    piece->setLength(piece->getLength() - offset);
-
-    return cutoffPiece;
+    return {leftPiece, rightPiece};
 }
-
-
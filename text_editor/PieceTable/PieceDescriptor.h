@@ -14,27 +14,34 @@ class PieceDescriptor {
 public:
     friend std::ostream& operator<<(std::ostream& out, const PieceDescriptor& piece);
 
-    PieceDescriptor(SourceType source, size_t start, size_t length);
-    PieceDescriptor(PieceDescriptor& piece);
+    PieceDescriptor(SourceType source, size_t chunk, size_t start, size_t length, size_t lineBreaks = 0);
+    PieceDescriptor(const PieceDescriptor& piece);
     PieceDescriptor(PieceDescriptor* piece);
     ~PieceDescriptor();
 
     SourceType getSource() const;
+    size_t getChunk() const;
     size_t getStart() const;
     size_t getLength() const;
+    size_t getLineBreaks() const;
 
     void setSource(SourceType mSource);
+    void setChunk(size_t chunk);
     void setStart(size_t mStart);
     void setLength(size_t mLength);
+    void setLineBreaks(size_t lineBreaks);
 
-    static PieceDescriptor* cutoffFromRight(PieceDescriptor* piece, size_t offset);
-    static PieceDescriptor* cutoffFromLeft(PieceDescriptor* piece, size_t offset);
+    PieceDescriptor& operator=(const PieceDescriptor& piece) = default;
 
-    static std::pair<PieceDescriptor*, PieceDescriptor*> splitPiece(PieceDescriptor* piece, size_t splitIndex);
+    static std::pair<PieceDescriptor, PieceDescriptor> splitPiece(const PieceDescriptor& piece, size_t splitIndex);
 private:
     SourceType m_source;
+    // Chunk of the add buffer the text is in, the original buffer has a single chunk
+    size_t m_chunk;
+    // Offset of the text inside the chunk
     size_t m_start;
     size_t m_length;
+    size_t m_lineBreaks;
 };
 
 
@@ -3,129 +3,54 @@
 //
 
 #include "PieceTable.h"
+#include "../Search/RegexSearch.h"
+#include "../Search/TextSearch.h"
 
-std::ostream& operator<<(std::ostream& out, const PieceTable& table) {
-    bool shouldPrintInsertBuffer = !table.m_insertBuffer->isFlushed();
-    bool shouldPrintDeleteBuffer = !table.m_deleteBuffer->isFlushed();
-
-    size_t current_index = 0;
-
-    if (table.m_pieces.empty() && !table.m_insertBuffer->isFlushed()) {
-        out << table.m_insertBuffer->getContent();
-        shouldPrintInsertBuffer = false;
-    }
-
-    auto pieceIt = table.m_pieces.begin();
-    while (pieceIt != table.m_pieces.end()) {
-        auto piece = *pieceIt;
-
-        std::string* buffer = piece->getSource() == SourceType::Original ? table.m_originalBuffer : table.m_addBuffer;
-
-        if (shouldPrintInsertBuffer && PieceTable::isInsidePiece(table.m_insertBuffer->getStartIndex(), current_index, piece->getLength())) {
-            auto leftStringLen = table.m_insertBuffer->getStartIndex() - current_index;
-
-            out << buffer->substr(piece->getStart(), leftStringLen);
-            out << table.m_insertBuffer->getContent();
-            out << buffer->substr(piece->getStart() + leftStringLen, piece->getLength() - leftStringLen);
-
-            shouldPrintInsertBuffer = false;
-        } else if (shouldPrintDeleteBuffer && PieceTable::isInsidePiece(table.m_deleteBuffer->getStartIndex(), current_index, piece->getLength())) {
-            //std::cerr << "Printing delete buffer" << std::endl;
-            //std::cerr << "Piece" << *piece << std::endl;
-            //std::cerr << "Current index: " << current_index << std::endl;
-            auto deleteBufferStart = table.m_deleteBuffer->getStartIndex();
-            auto deleteBufferEnd = table.m_deleteBuffer->getEndIndex();
-
-            //std::cerr << "start: " << deleteBufferStart << std::endl;
-            //std::cerr << "end: " << deleteBufferEnd << std::endl;
-
-            if (deleteBufferStart == current_index && deleteBufferEnd == current_index + piece->getLength()) {
-                //std::cerr << "Doing nothing" << std::endl;
-                // Do nothing
-            } else if (deleteBufferStart >= current_index && deleteBufferEnd <= current_index + piece->getLength()) {
-                //std::cerr << "Deleting in-between" << std::endl;
-
-                auto leftStringLen = deleteBufferStart - current_index;
-                auto deleteLen = deleteBufferEnd - deleteBufferStart;
-                auto rightStringLen = piece->getLength() - deleteLen - leftStringLen;
-                auto rightOffset = std::min(leftStringLen + deleteLen, piece->getLength()-1);
-
-                out << buffer->substr(piece->getStart(), leftStringLen);
-                out << buffer->substr(piece->getStart() + rightOffset, rightStringLen);
-            } else {
-                //std::cerr << "Deleting across multiple pieces" << std::endl;
+#include <memory>
 
-                auto leftLen = table.m_deleteBuffer->getStartIndex() - current_index;
-                //std::cerr << "left len: " << leftLen << std::endl;
+const size_t PieceTable::m_smallPieceLength = 32;
+const size_t PieceTable::m_minSmallPieceRun = 16;
+const size_t PieceTable::m_maxSmallPieceRunLength = 4096;
 
-                out << buffer->substr(piece->getStart(), leftLen);
-
-
-                while (pieceIt != table.m_pieces.end() && !PieceTable::isInsidePieceInclusive(table.m_deleteBuffer->getEndIndex(), current_index, piece->getLength())) {
-                    //std::cerr << "Iterating over piece" << std::endl;
-                    current_index += piece->getLength();
-                    pieceIt = std::next(pieceIt);
-                    piece = pieceIt == table.m_pieces.end() ? nullptr : *pieceIt;
-                }
-
-                if (pieceIt == table.m_pieces.end()) {
-                    //std::cerr << "Reached end, breaking out of loop" << std::endl;
-                    break;
-                }
-
-                piece = *pieceIt;
-                //std::cerr << "Piece: " << *piece << std::endl;
-
-                auto rightOffset = table.m_deleteBuffer->getEndIndex() - current_index;
-                //std::cerr << "right offset: " << rightOffset << std::endl;
-
-                out << buffer->substr(piece->getStart() + rightOffset, piece->getLength() - rightOffset);
-            }
-
-            shouldPrintDeleteBuffer = false;
-        } else {
-            //std::cerr << "Printing whole: " << buffer->substr(piece->getStart(), piece->getLength()) << std::endl;
-            out << buffer->substr(piece->getStart(), piece->getLength());
-        }
-
-        current_index += piece->getLength();
-        pieceIt = std::next(pieceIt);
-    }
-
-    if (shouldPrintInsertBuffer) {
-        out << table.m_insertBuffer->getContent();
+std::ostream& operator<<(std::ostream& out, const PieceTable& table) {
+    for (auto it = table.chunkBegin(); !it.isEnd(); ++it) {
+        auto chunk = *it;
+        out.write(chunk.data(), chunk.size());
     }
 
-    //std::cerr << "EXITED PRINTING" << std::endl;
-
     return out;
 }
 
-PieceTable::PieceTable() : m_size(0) {
-    m_originalBuffer = new std::string("");
-    m_addBuffer = new std::string("");
+PieceTable::PieceTable() : m_originalBuffer(std::make_shared<OriginalBuffer>()),
+      m_originalLineBreaks(std::make_shared<LineBreakIndex>()), m_addBuffer(std::make_shared<AddBuffer>()),
+      m_pieces(m_originalLineBreaks.get(), m_addBuffer.get()), m_undoStack(m_addBuffer.get()), m_redoStack(m_addBuffer.get()),
+      m_batching(false), m_batchChanged(false), m_groupNextAction(false), m_batchChange({0, 0, 0}), m_size(0), m_version(0),
+      m_loadedOriginalSize(0) {
     m_insertBuffer = new InsertBuffer();
     m_deleteBuffer = new DeleteBuffer();
 }
 
-PieceTable::PieceTable(std::string& originalBuffer) : m_size(0) {
-    m_originalBuffer = new std::string(originalBuffer);
-    m_addBuffer = new std::string("");
+PieceTable::PieceTable(std::string& originalBuffer) : PieceTable(new OriginalBuffer(originalBuffer)) {}
+
+// Takes ownership of the original buffer, which can be a mapped file
+PieceTable::PieceTable(OriginalBuffer* originalBuffer) : PieceTable(originalBuffer, originalBuffer->size()) {}
+
+// Starts with only the first loadedSize characters of the original buffer, the rest is added with appendOriginal
+PieceTable::PieceTable(OriginalBuffer* originalBuffer, size_t loadedSize) : m_originalBuffer(originalBuffer),
+      m_originalLineBreaks(std::make_shared<LineBreakIndex>()), m_addBuffer(std::make_shared<AddBuffer>()),
+      m_pieces(m_originalLineBreaks.get(), m_addBuffer.get()), m_undoStack(m_addBuffer.get()), m_redoStack(m_addBuffer.get()),
+      m_batching(false), m_batchChanged(false), m_groupNextAction(false), m_batchChange({0, 0, 0}), m_size(0), m_version(0),
+      m_loadedOriginalSize(0) {
     m_insertBuffer = new InsertBuffer();
     m_deleteBuffer = new DeleteBuffer();
 
-    insert(SourceType::Original, 0, m_originalBuffer->size(), 0, true);
+    appendOriginal(loadedSize);
 }
 
 PieceTable::~PieceTable() {
-    delete m_originalBuffer;
-    delete m_addBuffer;
     delete m_insertBuffer;
     delete m_deleteBuffer;
 
-    for (auto piece : m_pieces)
-        delete piece;
-
     clearUndoStack();
     clearRedoStack();
 }
@@ -133,6 +58,8 @@ PieceTable::~PieceTable() {
 
 // Inserts char to add buffer, returns if the buffer has been initialized
 bool PieceTable::insertChar(char c, size_t index) {
+    flushDeleteBuffer();
+
     if (index != m_insertBuffer->getEndIndex()) {
         flushInsertBuffer();
     }
@@ -147,80 +74,31 @@ bool PieceTable::insertChar(char c, size_t index) {
     }
 
     m_insertBuffer->appendToContent(c);
+    notifyListeners({index, 0, 1});
     return  result;
 }
 
-// Inserts text from the addBuffer into the pieceTable
-void PieceTable::insert(SourceType sourceType, size_t start, size_t length, size_t index, bool undoRedo) {
-    if (length == 0) {
+// Inserts text that is already in one of the buffers into the pieceTable
+void PieceTable::insert(const PieceDescriptor& piece, size_t index, bool undoRedo) {
+    if (piece.getLength() == 0) {
         return;
     }
 
     if (index > m_size)
         index = m_size;
 
-    auto newPiece = new PieceDescriptor(sourceType, start, length);
-
-
-    if (index == 0) {
-        prepend(newPiece);
-    } else if (index == m_size) {
-        auto endPiece = m_pieces.back();
-
-        // If the piece is on the end of the add buffer we just extend the current piece
-        if (isPieceOnEndOffBuffer(endPiece)) {
-            endPiece->setLength(endPiece->getLength() + length);
-        } else {
-            append(newPiece);
-        }
-    } else {
-        // Else we iterate through the pieces to find the correct index
-        size_t currentIndex = 0;
-        size_t i = 0;
-        PieceDescriptor* previousPiece = nullptr;
-
-        for (auto piece : m_pieces) {
-            auto pieceLength = piece->getLength();
-
-            // If the index is exactly between two pieces then we insert a new piece between them
-            if (index == currentIndex) {
-                // If the piece is on the end of the buffer we append to the previous piece
-                if (isPieceOnEndOffBuffer(previousPiece)) {
-                    previousPiece->setLength(previousPiece->getLength() + length);
-                } else {
-                    insertPiece(newPiece, i);
-                }
-
-                break;
-            } else if (index > currentIndex && index < currentIndex + pieceLength) {
-                // If the inserting index is inside a piece we split it into two then add the new piece between them
-                auto [leftPiece, rightPiece] = PieceDescriptor::splitPiece(piece, index - currentIndex);
-
-                erasePiece(i);
-
-                insertPiece(leftPiece, i);
-                insertPiece(newPiece, i+1);
-                insertPiece(rightPiece, i+2);
-                break;
-            }
-
-            ++i;
-            currentIndex += pieceLength;
-            previousPiece = piece;
-        }
-    }
-
-    addToUndo(new ActionDescriptor(ActionType::Insert, {new PieceDescriptor(newPiece)}, index), undoRedo);
-    m_size += length;
+    applyInsert(piece, index, undoRedo);
+    notifyListeners({index, 0, piece.getLength()});
 }
 
 void PieceTable::insert(std::string text, size_t index, bool undoRedo) {
-    insert(SourceType::Add, m_addBuffer->size(), text.size(), index, undoRedo);
-    insertTextInBuffer(text);
+    auto [chunk, start] = m_addBuffer->append(text);
+    insert(PieceDescriptor(SourceType::Add, chunk, start, text.size()), index, undoRedo);
 }
 
 bool PieceTable::backspace(size_t index) {
-    std::cerr << "Entered backspace" << std::endl;
+    flushInsertBuffer();
+
     if (index != m_deleteBuffer->getDeleteIndex()) {
         flushDeleteBuffer();
     }
@@ -235,8 +113,10 @@ bool PieceTable::backspace(size_t index) {
         result = true;
     }
 
-    if (m_deleteBuffer->getStartIndex() != 0)
+    if (m_deleteBuffer->getStartIndex() != 0) {
         m_deleteBuffer->setStartIndex(m_deleteBuffer->getStartIndex()-1);
+        notifyListeners({m_deleteBuffer->getStartIndex(), 1, 0});
+    }
     if (index != 0)
         m_deleteBuffer->setDeleteIndex(index-1);
 
@@ -244,7 +124,7 @@ bool PieceTable::backspace(size_t index) {
 }
 
 bool PieceTable::charDelete(size_t index) {
-    std::cerr << "ENTERED CHAR DELETE!" << std::endl;
+    flushInsertBuffer();
 
     if (index != m_deleteBuffer->getDeleteIndex()) {
         flushDeleteBuffer();
@@ -261,133 +141,186 @@ bool PieceTable::charDelete(size_t index) {
     }
 
     auto newIndex = std::min(m_deleteBuffer->getEndIndex()+1, getSize());
-    std::cerr << "END INDEX: " << m_deleteBuffer->getEndIndex() << std::endl;
-    std::cerr << "SIZE: " << getSize() << std::endl;
-    std::cerr << "NEW INDEX: " << newIndex << std::endl;
-    m_deleteBuffer->setEndIndex(newIndex);
+    if (newIndex != m_deleteBuffer->getEndIndex()) {
+        m_deleteBuffer->setEndIndex(newIndex);
+        notifyListeners({m_deleteBuffer->getStartIndex(), 1, 0});
+    }
 
     return result;
 }
 
 bool PieceTable::addTabs(const std::vector<size_t> &indices) {
-    for (const size_t index : indices) {
-        insert("\t", index);
-    }
+    std::vector<Edit> edits;
 
-    return !indices.empty();
+    for (const size_t index : indices)
+        edits.push_back({index, 0, "\t"});
+
+    return applyEdits(edits);
 }
 
 bool PieceTable::removeTabs(const std::vector<size_t> &indices) {
-    for (const size_t index : indices) {
-        deleteText(index, index+1);
-    }
+    std::vector<Edit> edits;
+
+    for (const size_t index : indices)
+        edits.push_back({index, 1, ""});
 
-    return !indices.empty();
+    return applyEdits(edits);
 }
 
 
 // Deletes text from range [start, end)
 void PieceTable::deleteText(size_t start, size_t end, bool undoRedo) {
-    if (start >= end || start >= m_size || m_pieces.empty())
+    if (start >= end || start >= m_size || m_pieces.isEmpty())
         return;
 
     if (end > m_size)
         end = m_size;
 
-    size_t deleteLength = end - start;
-    size_t currentIndex = 0;
-    size_t i = 0;
+    applyDelete(start, end, undoRedo);
+    notifyListeners({start, end - start, 0});
+}
 
-    std::vector<PieceDescriptor*> pieceDescriptors;
+// Applies a batch of edits sorted by index whose ranges don't overlap. They are applied from the last
+// to the first, so the indices of the ones still to come stay valid. The whole batch is undone as a
+// single action and the listeners get a single change covering it. A batch that isn't sorted, has overlapping
+// ranges or goes past the end of the text is rejected, applying it would corrupt the text and its undo.
+// Returns whether the text changed
+bool PieceTable::applyEdits(const std::vector<Edit> &edits) {
+    for (size_t i=0; i<edits.size(); ++i) {
+        auto end = edits[i].m_index + edits[i].m_removedLength;
+        auto limit = i + 1 < edits.size() ? edits[i+1].m_index : getTextSize();
+
+        if (end < edits[i].m_index || end > limit)
+            return false;
+    }
 
-    for (auto piece : m_pieces) {
-        auto pieceLength = piece->getLength();
+    flushInsertBuffer();
+    flushDeleteBuffer();
 
-        if (start == currentIndex && deleteLength == pieceLength) {
-            pieceDescriptors.push_back(new PieceDescriptor(piece));
-            erasePiece(i);
+    beginBatch();
 
-            break;
-        } else if (start >= currentIndex && start < currentIndex + pieceLength && end <= currentIndex + pieceLength) {
-            PieceDescriptor* deletePiece;
-
-            if (start == currentIndex) {
-                deletePiece = PieceDescriptor::cutoffFromLeft(piece, deleteLength);
-            } else if (end == currentIndex + pieceLength) {
-                deletePiece = PieceDescriptor::cutoffFromRight(piece, deleteLength);
-            } else {
-                deletePiece = cutoffFromMiddle(piece, i, start - currentIndex, pieceLength - (end - currentIndex));
-            }
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        deleteText(it->m_index, it->m_index + it->m_removedLength);
 
-            if (deletePiece != nullptr)
-                pieceDescriptors.push_back(deletePiece);
+        if (!it->m_text.empty())
+            insert(it->m_text, it->m_index);
+    }
 
-            break;
-        } else if (start >= currentIndex && start < currentIndex + pieceLength) {
+    auto changed = m_batchChanged;
+    endBatch();
 
+    return changed;
+}
 
-            size_t newCurrentIndex = currentIndex + pieceLength;
-            auto it = std::next(m_pieces.begin(), i);
+// Replaces every match of the pattern in one pass. The replacement is appended to the add buffer once,
+// the run of pieces from the first match to the last is rebuilt with a piece for every gap between the
+// matches and one for every replacement, and the tree takes it in a single split and join. The old and
+// the new run are recorded as one grouped undo step. Returns the number of replaced matches
+size_t PieceTable::replaceAll(const std::string &pattern, const std::string &replacement, const SearchOptions &options) {
+    flushInsertBuffer();
+    flushDeleteBuffer();
 
-            std::vector<decltype(it)> toDelete;
+    auto matches = findAll(pattern, options);
+    if (matches.empty())
+        return 0;
 
-            auto deleteOffset = start - currentIndex;
-            auto cutoffLength = pieceLength - deleteOffset;
+    auto start = matches.front().m_start;
+    auto end = matches.back().m_start + matches.back().m_length;
 
-            if (deleteOffset == 0) {
-                pieceDescriptors.push_back(new PieceDescriptor(piece));
-                toDelete.push_back(it);
-            } else {
-                auto cutoffPiece = PieceDescriptor::cutoffFromRight(piece, cutoffLength);
+    m_erasedPieces.clear();
+    m_pieces.erase(start, end, m_erasedPieces);
 
-                if (cutoffPiece != nullptr)
-                    pieceDescriptors.push_back(cutoffPiece);
-            }
+    PieceDescriptor replacementPiece(SourceType::Add, 0, 0, 0);
+    if (!replacement.empty()) {
+        auto [chunk, chunkStart] = m_addBuffer->append(replacement);
+        replacementPiece = PieceDescriptor(SourceType::Add, chunk, chunkStart, replacement.size());
+    }
 
-            it = std::next(it);
+    // The gaps are cut out of the erased pieces, walking them once alongside the matches
+    std::vector<PieceDescriptor> pieces;
+    size_t insertedLength = 0;
+    size_t erasedPiece = 0;
+    size_t erasedOffset = 0;
+    size_t position = start;
 
-            while (it != m_pieces.end()) {
-                auto itPiece = (*it);
+    auto advance = [&](size_t length, bool keep) {
+        while (length > 0) {
+            auto& piece = m_erasedPieces[erasedPiece];
+            auto taken = std::min(length, piece.getLength() - erasedOffset);
 
-                if (newCurrentIndex + itPiece->getLength() - 1 < end) {
-                    toDelete.push_back(it);
-                    pieceDescriptors.push_back(new PieceDescriptor(itPiece));
-                } else {
-                    auto offset = end - newCurrentIndex;
+            if (keep)
+                pieces.emplace_back(piece.getSource(), piece.getChunk(), piece.getStart() + erasedOffset, taken);
 
-                    auto cutoffPiece = PieceDescriptor::cutoffFromLeft(itPiece, offset);
+            erasedOffset += taken;
+            length -= taken;
 
-                    if (cutoffPiece != nullptr)
-                        pieceDescriptors.push_back(cutoffPiece);
+            if (erasedOffset == piece.getLength()) {
+                ++erasedPiece;
+                erasedOffset = 0;
+            }
+        }
+    };
 
-                    break;
-                }
+    for (auto& match : matches) {
+        advance(match.m_start - position, true);
+        advance(match.m_length, false);
 
-                newCurrentIndex += itPiece->getLength();
-                it = std::next(it);
-            }
+        if (replacementPiece.getLength() > 0)
+            pieces.push_back(replacementPiece);
 
-            for (size_t j=0; j<toDelete.size(); ++j) {
-                m_pieces.erase(toDelete[j]);
-            }
+        insertedLength += match.m_start - position + replacementPiece.getLength();
+        position = match.m_start + match.m_length;
+    }
 
-            break;
-        }
+    m_pieces.insert(pieces.data(), pieces.size(), start);
+    m_size += insertedLength - (end - start);
 
-        ++i;
-        currentIndex += piece->getLength();
+    beginBatch();
+    addToUndo(ActionType::Delete, start, m_erasedPieces.data(), m_erasedPieces.size(), false);
+    addToUndo(ActionType::Insert, start, pieces.data(), pieces.size(), false);
+    notifyListeners({start, end - start, insertedLength});
+    endBatch();
+
+    return matches.size();
+}
+
+// Adds the next length characters of the original buffer to the end of the text. A file that is still
+// being loaded grows this way as its characters arrive, which isn't an edit and can't be undone
+void PieceTable::appendOriginal(size_t length) {
+    if (length == 0)
+        return;
+
+    flushInsertBuffer();
+    flushDeleteBuffer();
+
+    // Snapshots keep reading the index they were taken with
+    if (m_originalLineBreaks.use_count() > 1) {
+        m_originalLineBreaks = std::make_shared<LineBreakIndex>(*m_originalLineBreaks);
+        m_pieces.setOriginalLineBreaks(m_originalLineBreaks.get());
     }
 
-    addToUndo(new ActionDescriptor(ActionType::Delete, pieceDescriptors, start), undoRedo);
-    m_size -= deleteLength;
+    auto start = m_loadedOriginalSize;
+    m_originalLineBreaks->append(m_originalBuffer->data() + start, length, start);
+    m_loadedOriginalSize += length;
+
+    auto index = m_size;
+    auto lastPiece = index == 0 ? nullptr : m_pieces.pieceEndingAt(index);
+
+    if (lastPiece != nullptr && lastPiece->getSource() == SourceType::Original && lastPiece->getStart() + lastPiece->getLength() == start)
+        m_pieces.extendPieceEndingAt(index, length);
+    else
+        m_pieces.insert(PieceDescriptor(SourceType::Original, 0, start, length), index);
+
+    m_size += length;
+    notifyListeners({index, 0, length});
 }
 
 void PieceTable::undo() {
-    reverseOperation(m_undoStack, m_redoStack);
+    reverseGroup(m_undoStack, m_redoStack);
 }
 
 void PieceTable::redo() {
-    reverseOperation(m_redoStack, m_undoStack);
+    reverseGroup(m_redoStack, m_undoStack);
 }
 
 void PieceTable::save(const std::string &filename) {
@@ -396,10 +329,10 @@ void PieceTable::save(const std::string &filename) {
 
 bool PieceTable::flushInsertBuffer() {
     if (!m_insertBuffer->isFlushed()) {
-        std::cerr << "Flushing buffer with index: " << m_insertBuffer->getStartIndex() << std::endl;
-        std::cerr << "Table Size: " << m_size << std::endl;
-        std::cerr << "Content: " << m_insertBuffer->getContent() << std::endl;
-        insert(m_insertBuffer->getContent(), m_insertBuffer->getStartIndex());
+        auto& content = m_insertBuffer->getContent();
+        auto [chunk, start] = m_addBuffer->append(content);
+        PieceDescriptor piece(SourceType::Add, chunk, start, content.size());
+        applyInsert(piece, std::min(m_insertBuffer->getStartIndex(), m_size), false);
         m_insertBuffer->clearContent();
         m_insertBuffer->setFlushed(true);
         return true;
@@ -410,9 +343,12 @@ bool PieceTable::flushInsertBuffer() {
 
 bool PieceTable::flushDeleteBuffer() {
     if (!m_deleteBuffer->isFlushed()) {
-        std::cerr << "Flushing delete buffer" << std::endl;
-        std::cerr << "Flushing delete from " << m_deleteBuffer->getStartIndex() << " to " << m_deleteBuffer->getEndIndex() << std::endl;
-        deleteText(m_deleteBuffer->getStartIndex(), m_deleteBuffer->getEndIndex());
+        auto start = m_deleteBuffer->getStartIndex();
+        auto end = std::min(m_deleteBuffer->getEndIndex(), m_size);
+
+        if (start < end)
+            applyDelete(start, end, false);
+
         m_deleteBuffer->setFlushed(true);
         return true;
     }
@@ -420,140 +356,488 @@ bool PieceTable::flushDeleteBuffer() {
     return false;
 }
 
+// Rebuilds the piece tree with the pieces that continue each other in the same buffer merged, and with
+// long runs of small add buffer pieces copied into one contiguous piece. The text and its offsets stay
+// the same, so the unflushed buffers and the undo history, which keeps its pieces by value, stay valid.
+// Meant to run while the editor is idle. Returns whether the number of pieces went down
+bool PieceTable::compact() {
+    std::vector<PieceDescriptor> pieces;
+    pieces.reserve(m_pieces.getPieceCount());
+
+    for (auto it = m_pieces.begin(); it != m_pieces.end(); ++it) {
+        if (!pieces.empty() && continues(pieces.back(), *it))
+            pieces.back().setLength(pieces.back().getLength() + it->getLength());
+        else
+            pieces.push_back(*it);
+    }
+
+    std::vector<PieceDescriptor> merged;
+    mergeSmallPieces(pieces.data(), pieces.size(), merged);
+
+    if (merged.size() == m_pieces.getPieceCount())
+        return false;
+
+    m_pieces.assign(merged.data(), merged.size());
+    collectGarbage();
+    return true;
+}
+
 void PieceTable::clearUndoAndRedoStacks() {
     clearUndoStack();
     clearRedoStack();
+    collectGarbage();
+}
+
+// An edit made after an undo starts a new history, so the stacks are cleared if there is anything to redo.
+// Returns whether they were cleared
+bool PieceTable::clearStacksIfRedoable() {
+    if (isRedoEmpty())
+        return false;
+
+    clearUndoAndRedoStacks();
+    return true;
+}
+
+// Limits the memory each of the undo and redo histories can use before its oldest actions are spilled to disk
+void PieceTable::setUndoMemoryLimit(size_t memoryLimit) {
+    m_undoStack.setMemoryLimit(memoryLimit);
+    m_redoStack.setMemoryLimit(memoryLimit);
+    enforceMemoryLimit(m_undoStack);
+    enforceMemoryLimit(m_redoStack);
+}
+
+// Copies the original buffer into memory if it is a mapping of filePath, so the file can be written to.
+// Snapshots may be reading the mapping, so while there are any the table moves to a copy and leaves the mapping to them
+void PieceTable::detachOriginalBuffer(const std::string &filePath) {
+    if (!m_originalBuffer->isMapped() || m_originalBuffer->getMappedPath() != filePath)
+        return;
+
+    if (m_originalBuffer.use_count() > 1)
+        m_originalBuffer = std::make_shared<OriginalBuffer>(std::string(m_originalBuffer->data(), m_originalBuffer->size()));
+    else
+        m_originalBuffer->detach();
+}
+
+void PieceTable::addListener(TextChangeListener *listener) {
+    m_listeners.push_back(listener);
+}
+
+void PieceTable::removeListener(TextChangeListener *listener) {
+    m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
 }
 
 size_t PieceTable::getSize() const { return m_size; }
 
-bool PieceTable::isUndoEmpty() const { return m_undoStack.empty(); }
+// The size of the text as it is shown, including the unflushed buffers
+size_t PieceTable::getTextSize() const {
+    auto size = m_size;
 
-bool PieceTable::isRedoEmpty() const { return m_redoStack.empty(); }
+    if (!m_insertBuffer->isFlushed())
+        size += m_insertBuffer->getContent().size();
+    if (!m_deleteBuffer->isFlushed())
+        size -= m_deleteBuffer->getDeleteSize();
 
-void PieceTable::append(PieceDescriptor* piece) {
-    m_pieces.push_back(piece);
+    return size;
 }
 
-void PieceTable::prepend(PieceDescriptor* piece) {
-    m_pieces.push_front(piece);
+// Returns length characters of the text as it is shown starting at index, including the unflushed buffers
+std::string PieceTable::getText(size_t index, size_t length) const {
+    std::string text;
+    text.reserve(length);
+
+    for (auto it = chunkAt(index); !it.isEnd() && text.size() < length; ++it) {
+        auto chunk = *it;
+        auto skip = index > it.getOffset() ? index - it.getOffset() : 0;
+        text.append(chunk.substr(skip, length - text.size()));
+    }
+
+    return text;
 }
 
-inline void PieceTable::insertPiece(PieceDescriptor *piece, size_t index) {
-        m_pieces.insert(std::next(m_pieces.begin(), index), piece);
+ChunkIterator PieceTable::chunkBegin() const { return {this, 0}; }
+
+ChunkIterator PieceTable::chunkEnd() const { return {this, std::string::npos}; }
+
+// Returns the iterator over the chunk that contains index
+ChunkIterator PieceTable::chunkAt(size_t index) const { return {this, index}; }
+
+// Returns an immutable view of the text as it is shown now. Taking it only adds a reference to the piece tree root
+// and copies the unflushed insert buffer, which holds at most the characters typed since the last flush
+DocumentSnapshot PieceTable::snapshot() const {
+    DocumentSnapshot snapshot;
+
+    snapshot.m_root = m_pieces.share();
+    snapshot.m_nodePool = m_pieces.getNodePool();
+    snapshot.m_originalBuffer = m_originalBuffer;
+    snapshot.m_originalLineBreaks = m_originalLineBreaks;
+    snapshot.m_addBuffer = m_addBuffer;
+    snapshot.m_piecesSize = m_size;
+    snapshot.m_insertIndex = m_size;
+    snapshot.m_deleteStart = m_size;
+    snapshot.m_deleteEnd = m_size;
+    snapshot.m_version = m_version;
+
+    if (!m_insertBuffer->isFlushed()) {
+        snapshot.m_insertedText = m_insertBuffer->getContent();
+        snapshot.m_insertIndex = std::min(m_insertBuffer->getStartIndex(), m_size);
+    } else if (!m_deleteBuffer->isFlushed()) {
+        snapshot.m_deleteStart = std::min(m_deleteBuffer->getStartIndex(), m_size);
+        snapshot.m_deleteEnd = std::min(m_deleteBuffer->getEndIndex(), m_size);
+    }
+
+    return snapshot;
 }
 
-inline void PieceTable::erasePiece(size_t index) {
-    auto it = std::next(m_pieces.begin(), index);
-    auto ptr = *it;
+// Every visible change of the text increments the version
+size_t PieceTable::getVersion() const { return m_version; }
+
+// Returns the next match of the pattern in the shown text, an invalid regex doesn't match anything
+SearchMatch PieceTable::find(const std::string &pattern, size_t from, const SearchOptions &options) const {
+    if (options.m_regex)
+        return RegexSearch(pattern, options).find(*this, from);
 
-    m_pieces.erase(it);
-    delete ptr;
+    TextSearch search(pattern, options);
+    return {search.find(*this, from), search.getLength()};
 }
 
-bool PieceTable::isPieceOnEndOffBuffer(PieceDescriptor *piece) const {
-    return piece->getSource() == SourceType::Add && piece->getStart() + piece->getLength() == m_addBuffer->size();
+size_t PieceTable::getLineCount() const { return countLineBreaksBefore(getTextSize()) + 1; }
+
+// Returns the index of the first character of the line (zero based)
+size_t PieceTable::getLineStart(size_t line) const {
+    if (line == 0)
+        return 0;
+
+    return findLineBreak(line - 1) + 1;
 }
 
-bool PieceTable::isInsidePiece(const size_t &index, const size_t &currentIndex, const size_t &length) {
-    return index >= currentIndex && index < currentIndex + length;
+// Returns the zero based line and column of the index
+std::pair<size_t, size_t> PieceTable::getLineAndColumn(size_t index) const {
+    auto line = countLineBreaksBefore(index);
+    return {line, index - getLineStart(line)};
+}
+
+bool PieceTable::isUndoEmpty() const { return m_undoStack.isEmpty(); }
+
+bool PieceTable::isRedoEmpty() const { return m_redoStack.isEmpty(); }
+
+// Checks if the newPiece continues the piece in the add buffer
+bool PieceTable::isPieceOnEndOffBuffer(const PieceDescriptor *piece, const PieceDescriptor& newPiece) const {
+    return piece->getSource() == SourceType::Add && piece->getChunk() == newPiece.getChunk() &&
+           piece->getStart() + piece->getLength() == newPiece.getStart();
+}
+
+// Counts the line breaks in [0, index) of the text as it is shown, including the unflushed buffers
+size_t PieceTable::countLineBreaksBefore(size_t index) const {
+    if (!m_insertBuffer->isFlushed()) {
+        auto& content = m_insertBuffer->getContent();
+        auto start = m_insertBuffer->getStartIndex();
+
+        if (index <= start)
+            return m_pieces.countLineBreaksBefore(index);
+
+        auto contentLength = std::min(index - start, content.size());
+        auto contentLineBreaks = (size_t) std::count(content.begin(), content.begin() + contentLength, '\n');
+
+        return m_pieces.countLineBreaksBefore(index - contentLength) + contentLineBreaks;
+    }
+
+    if (!m_deleteBuffer->isFlushed()) {
+        auto start = m_deleteBuffer->getStartIndex();
+        auto end = m_deleteBuffer->getEndIndex();
+
+        if (index <= start)
+            return m_pieces.countLineBreaksBefore(index);
+
+        auto deletedLineBreaks = m_pieces.countLineBreaksBefore(end) - m_pieces.countLineBreaksBefore(start);
+        return m_pieces.countLineBreaksBefore(index + end - start) - deletedLineBreaks;
+    }
+
+    return m_pieces.countLineBreaksBefore(index);
 }
 
-bool PieceTable::isInsidePieceInclusive(const size_t& index, const size_t& currentIndex, const size_t& length) {
-    return index >= currentIndex && index <= currentIndex + length;
+// Finds the index of the n-th line break of the text as it is shown, including the unflushed buffers
+size_t PieceTable::findLineBreak(size_t n) const {
+    if (!m_insertBuffer->isFlushed()) {
+        auto& content = m_insertBuffer->getContent();
+        auto start = m_insertBuffer->getStartIndex();
+        auto lineBreaksBefore = m_pieces.countLineBreaksBefore(start);
+
+        if (n < lineBreaksBefore)
+            return m_pieces.findLineBreak(n);
+
+        n -= lineBreaksBefore;
+
+        for (size_t i=0; i<content.size(); ++i) {
+            if (content[i] == '\n' && n-- == 0)
+                return start + i;
+        }
+
+        return m_pieces.findLineBreak(lineBreaksBefore + n) + content.size();
+    }
+
+    if (!m_deleteBuffer->isFlushed()) {
+        auto start = m_deleteBuffer->getStartIndex();
+        auto end = m_deleteBuffer->getEndIndex();
+        auto lineBreaksBefore = m_pieces.countLineBreaksBefore(start);
+
+        if (n < lineBreaksBefore)
+            return m_pieces.findLineBreak(n);
+
+        auto deletedLineBreaks = m_pieces.countLineBreaksBefore(end) - lineBreaksBefore;
+        return m_pieces.findLineBreak(n + deletedLineBreaks) - (end - start);
+    }
+
+    return m_pieces.findLineBreak(n);
 }
 
-PieceDescriptor* PieceTable::cutoffFromMiddle(PieceDescriptor *piece, size_t index, size_t leftOffset, size_t rightOffset) {
-    if (leftOffset > piece->getLength() || rightOffset > piece->getLength())
-        return nullptr;
+void PieceTable::applyInsert(const PieceDescriptor& newPiece, size_t index, bool undoRedo) {
+    auto length = newPiece.getLength();
 
-    auto length = piece->getLength();
+    // If the new text was just appended to the add buffer and directly continues the piece before it
+    // we just extend that piece instead of inserting a new one
+    bool isNewText = newPiece.getSource() == SourceType::Add &&
+                     newPiece.getStart() + length == m_addBuffer->getChunkSize(newPiece.getChunk());
+    auto previousPiece = index == 0 ? nullptr : m_pieces.pieceEndingAt(index);
+
+    if (isNewText && previousPiece != nullptr && isPieceOnEndOffBuffer(previousPiece, newPiece)) {
+        m_pieces.extendPieceEndingAt(index, length);
+    } else {
+        m_pieces.insert(newPiece, index);
+    }
 
-    auto cutoffRightPiece = PieceDescriptor::cutoffFromRight(piece, length - leftOffset);
-    auto cutoffMiddlePiece = PieceDescriptor::cutoffFromLeft(cutoffRightPiece, length - rightOffset - leftOffset);
+    addToUndo(ActionType::Insert, index, &newPiece, 1, undoRedo);
+    m_size += length;
+}
 
-    insertPiece(cutoffRightPiece, index+1);
+void PieceTable::applyDelete(size_t start, size_t end, bool undoRedo) {
+    // The erased pieces are collected in a reused vector and copied by value into the undo stack
+    m_erasedPieces.clear();
+    m_pieces.erase(start, end, m_erasedPieces);
 
-    return  cutoffMiddlePiece;
+    addToUndo(ActionType::Delete, start, m_erasedPieces.data(), m_erasedPieces.size(), undoRedo);
+    m_size -= end - start;
 }
 
-inline void PieceTable::insertTextInBuffer(std::string &text) {
-    *m_addBuffer += text;
+// Returns the matches of a replace all from the start of the text, or none if the search was cancelled.
+// After an empty match the search continues from the next character
+std::vector<SearchMatch> PieceTable::findAll(const std::string &pattern, const SearchOptions &options) const {
+    SearchOptions forwardOptions = options;
+    forwardOptions.m_backward = false;
+
+    std::unique_ptr<RegexSearch> regexSearch;
+    std::unique_ptr<TextSearch> textSearch;
+
+    if (forwardOptions.m_regex)
+        regexSearch = std::make_unique<RegexSearch>(pattern, forwardOptions);
+    else
+        textSearch = std::make_unique<TextSearch>(pattern, forwardOptions);
+
+    std::vector<SearchMatch> matches;
+    size_t from = 0;
+
+    while (from <= m_size) {
+        SearchMatch match;
+
+        if (regexSearch != nullptr)
+            match = regexSearch->find(*this, from);
+        else
+            match = {textSearch->find(*this, from), textSearch->getLength()};
+
+        if (!match.isFound())
+            break;
+
+        matches.push_back(match);
+        from = match.m_start + std::max(match.m_length, (size_t)1);
+    }
+
+    if (options.m_cancel != nullptr && options.m_cancel->load())
+        matches.clear();
+
+    return matches;
 }
 
-void PieceTable::reverseOperation(std::stack<ActionDescriptor *> &stack, std::stack<ActionDescriptor *> &reverseStack) {
-    std::cerr << "ENTERED REVERSE OPERATION" << std::endl;
+void PieceTable::notifyListeners(const TextChange &change) {
+    ++m_version;
 
-    if (stack.empty()) {
-        std::cerr << "RETURNED" << std::endl;
+    for (auto listener : m_listeners) {
+        if (!m_batching || listener->tracksPositions())
+            listener->onTextChange(change);
+    }
+
+    if (!m_batching)
+        return;
+
+    if (!m_batchChanged) {
+        m_batchChange = change;
+        m_batchChanged = true;
         return;
     }
 
-    auto action = stack.top();
-    stack.pop();
+    // Grow the batch change so it covers this one too. The text the batch covers gets the parts
+    // of this change that were outside of it, which were still unchanged, added to its removed text
+    auto start = std::min(m_batchChange.m_index, change.m_index);
+    auto end = std::max(m_batchChange.m_index + m_batchChange.m_insertedLength, change.m_index + change.m_removedLength);
 
-    auto actionType = action->getActionType();
-    auto descriptors = action->getDescriptors();
-    auto index = action->getIndex();
-    size_t totalLength = 0;
+    m_batchChange.m_removedLength += (m_batchChange.m_index - start) + (end - m_batchChange.m_index - m_batchChange.m_insertedLength);
+    m_batchChange.m_insertedLength = end - start - change.m_removedLength + change.m_insertedLength;
+    m_batchChange.m_index = start;
+}
 
-    std::cerr << "Descriptors.size() = " << descriptors.size() << std::endl;
+void PieceTable::beginBatch() {
+    m_batching = true;
+    m_batchChanged = false;
+    m_groupNextAction = false;
+}
 
-    if (actionType == ActionType::Insert) {
-        std::cerr << "REVERSING INSERT" << std::endl;
+void PieceTable::endBatch() {
+    m_batching = false;
+    m_groupNextAction = false;
 
-        totalLength = std::accumulate(descriptors.begin(), descriptors.end(), (size_t)0,
-                                      [](size_t acc, PieceDescriptor* descriptor) { return  acc + descriptor->getLength(); }
-                                      );
+    if (!m_batchChanged)
+        return;
 
+    // The position listeners already heard about each change of the batch
+    for (auto listener : m_listeners) {
+        if (!listener->tracksPositions())
+            listener->onTextChange(m_batchChange);
+    }
+}
 
-        std::cerr << "Exited for loop" << std::endl;
+// Reverses the top action together with the actions grouped with it
+void PieceTable::reverseGroup(ActionStack &stack, ActionStack &reverseStack) {
+    beginBatch();
 
-        deleteText(index, index+totalLength, true);
-    } else {
-        std::cerr << "REVERSING DELETE" << std::endl;
+    // The actions are reversed in the opposite order, so the first one reversed ends up at the bottom of the group
+    bool grouped = false;
 
-        for (size_t i=0; i<descriptors.size(); ++i) {
-            std::cerr << "Entering iteration" << std::endl;
-            auto source = descriptors[i]->getSource();
-            auto start = descriptors[i]->getStart();
-            auto length = descriptors[i]->getLength();
+    while (stack.loadTop()) {
+        auto isLast = !stack.top().isGrouped();
+        reverseOperation(stack, reverseStack, grouped);
+        grouped = true;
 
-            std::cerr << "Starting " << i << "th insert" << std::endl;
-            insert(source, start, length, index + totalLength, true);
+        if (isLast)
+            break;
+    }
 
-            totalLength += length;
-        }
+    endBatch();
+}
+
+void PieceTable::reverseOperation(ActionStack &stack, ActionStack &reverseStack, bool grouped) {
+    if (!stack.loadTop())
+        return;
 
-        std::cerr << "Finishing reversing delete" << std::endl;
+    auto action = stack.top();
+
+    auto actionType = action.getActionType();
+    auto descriptors = stack.getPieces(action);
+    auto descriptorCount = action.getPieceCount();
+    auto index = action.getIndex();
+    auto totalLength = std::accumulate(descriptors, descriptors + descriptorCount, (size_t)0,
+                                       [](size_t acc, const PieceDescriptor& descriptor) { return  acc + descriptor.getLength(); }
+                                       );
+
+    if (actionType == ActionType::Insert) {
+        deleteText(index, index+totalLength, true);
+    } else {
+        // All the pieces go back into the tree at once, a replace all can have erased a lot of them
+        m_pieces.insert(descriptors, descriptorCount, index);
+        m_size += totalLength;
+        notifyListeners({index, 0, totalLength});
     }
 
+    // The pieces stay valid until the action is popped, so they are copied to the other stack first
     auto oppositeActionType = ActionDescriptor::getOppositeActionType(actionType);
-    action->setActionType(oppositeActionType);
-
-    reverseStack.push(action);
+    reverseStack.push(oppositeActionType, index, descriptors, descriptorCount, grouped);
+    stack.pop();
+    enforceMemoryLimit(reverseStack);
 }
 
 
-void PieceTable::addToUndo(ActionDescriptor *actionDescriptor, bool undoRedo) {
+void PieceTable::addToUndo(ActionType actionType, size_t index, const PieceDescriptor *pieces, size_t pieceCount, bool undoRedo) {
     if (!undoRedo) {
-        m_undoStack.push(actionDescriptor);
+        m_undoStack.push(actionType, index, pieces, pieceCount, m_groupNextAction);
+        m_groupNextAction = m_batching;
+        enforceMemoryLimit(m_undoStack);
     }
 }
 
-void PieceTable::clearUndoStack() {
-    while (!m_undoStack.empty()) {
-        m_undoStack.pop();
+void PieceTable::enforceMemoryLimit(ActionStack &stack) {
+    if (stack.isOverMemoryLimit()) {
+        stack.spill();
+        collectGarbage();
     }
 }
 
-void PieceTable::clearRedoStack() {
-    while (!m_redoStack.empty()) {
-        m_redoStack.pop();
+// Frees the add buffer chunks that no piece and no undo or redo action kept in memory refers to anymore.
+// Snapshots can refer to any chunk, so nothing is freed while there are any, a later collection frees the chunks
+void PieceTable::collectGarbage() {
+    if (m_addBuffer.use_count() > 1)
+        return;
+
+    std::vector<bool> referenced(m_addBuffer->getChunkCount(), false);
+
+    for (auto it = m_pieces.begin(); it != m_pieces.end(); ++it) {
+        if (it->getSource() == SourceType::Add)
+            referenced[it->getChunk()] = true;
+    }
+
+    m_undoStack.markReferencedChunks(referenced);
+    m_redoStack.markReferencedChunks(referenced);
+
+    for (size_t chunk=0; chunk<referenced.size(); ++chunk) {
+        if (!referenced[chunk])
+            m_addBuffer->release(chunk);
     }
 }
 
+// Copies the pieces to merged, replacing every long enough run of small add buffer pieces with a fresh copy of its text
+void PieceTable::mergeSmallPieces(const PieceDescriptor *pieces, size_t pieceCount, std::vector<PieceDescriptor> &merged) {
+    auto isSmall = [](const PieceDescriptor& piece) {
+        return piece.getSource() == SourceType::Add && piece.getLength() < m_smallPieceLength;
+    };
 
+    // Runs cut by the length limit are copied next to each other, so they are merged again
+    auto add = [&merged](const PieceDescriptor& piece) {
+        if (!merged.empty() && continues(merged.back(), piece))
+            merged.back().setLength(merged.back().getLength() + piece.getLength());
+        else
+            merged.push_back(piece);
+    };
 
+    std::string text;
 
+    for (size_t i=0; i<pieceCount;) {
+        size_t runEnd = i;
+        size_t runLength = 0;
+
+        while (runEnd < pieceCount && isSmall(pieces[runEnd]) && runLength + pieces[runEnd].getLength() <= m_maxSmallPieceRunLength)
+            runLength += pieces[runEnd++].getLength();
+
+        if (runEnd - i < m_minSmallPieceRun) {
+            add(pieces[i++]);
+            continue;
+        }
 
+        text.clear();
+
+        for (; i<runEnd; ++i)
+            text.append(m_addBuffer->getData(pieces[i].getChunk()) + pieces[i].getStart(), pieces[i].getLength());
+
+        auto [chunk, start] = m_addBuffer->append(text);
+        add(PieceDescriptor(SourceType::Add, chunk, start, text.size()));
+    }
+}
+
+// Whether the text of next directly follows the text of piece in the same buffer
+bool PieceTable::continues(const PieceDescriptor &piece, const PieceDescriptor &next) {
+    return piece.getSource() == next.getSource() && piece.getChunk() == next.getChunk() &&
+           piece.getStart() + piece.getLength() == next.getStart();
+}
+
+void PieceTable::clearUndoStack() {
+    m_undoStack.clear();
+}
+
+void PieceTable::clearRedoStack() {
+    m_redoStack.clear();
+}
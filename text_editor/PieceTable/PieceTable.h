@@ -5,14 +5,25 @@
 #ifndef TEXT_EDITOR_PIECETABLE_H
 #define TEXT_EDITOR_PIECETABLE_H
 
-#include "ActionDescriptor.h"
+#include "ActionStack.h"
+#include "AddBuffer.h"
+#include "ChunkIterator.h"
 #include "DeleteBuffer.h"
+#include "DocumentSnapshot.h"
+#include "Edit.h"
 #include "InsertBuffer.h"
+#include "LineBreakIndex.h"
+#include "OriginalBuffer.h"
 #include "PieceDescriptor.h"
+#include "PieceTree.h"
+#include "TextChangeListener.h"
+#include "../Search/SearchMatch.h"
+#include "../Search/SearchOptions.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <list>
+#include <memory>
 #include <numeric>
 #include <stack>
 #include <string>
@@ -20,13 +31,16 @@
 class PieceTable {
 public:
     friend std::ostream& operator<<(std::ostream& out, const PieceTable& table);
+    friend class ChunkIterator;
 
     PieceTable();
     PieceTable(std::string& originalBuffer);
+    explicit PieceTable(OriginalBuffer* originalBuffer);
+    PieceTable(OriginalBuffer* originalBuffer, size_t loadedSize);
     ~PieceTable();
 
     bool insertChar(char c, size_t index);
-    void insert(SourceType sourceType, size_t start, size_t length, size_t index, bool undoRedo = false);
+    void insert(const PieceDescriptor& piece, size_t index, bool undoRedo = false);
     void insert(std::string text, size_t index, bool undoRedo = false);
 
     bool backspace(size_t index);
@@ -34,6 +48,9 @@ public:
     bool addTabs(const std::vector<size_t>& indices);
     bool removeTabs(const std::vector<size_t>& indices);
     void deleteText(size_t start, size_t end, bool undoRedo = false);
+    void appendOriginal(size_t length);
+    bool applyEdits(const std::vector<Edit>& edits);
+    size_t replaceAll(const std::string& pattern, const std::string& replacement, const SearchOptions& options = SearchOptions());
 
     void undo();
     void redo();
@@ -43,40 +60,82 @@ public:
     bool flushInsertBuffer();
     bool flushDeleteBuffer();
 
+    bool compact();
+
     void clearUndoAndRedoStacks();
+    bool clearStacksIfRedoable();
+    void setUndoMemoryLimit(size_t memoryLimit);
+    void detachOriginalBuffer(const std::string& filePath);
+
+    void addListener(TextChangeListener* listener);
+    void removeListener(TextChangeListener* listener);
 
     size_t getSize() const;
+    size_t getTextSize() const;
+    std::string getText(size_t index, size_t length) const;
+    ChunkIterator chunkBegin() const;
+    ChunkIterator chunkEnd() const;
+    ChunkIterator chunkAt(size_t index) const;
+    DocumentSnapshot snapshot() const;
+    size_t getVersion() const;
+    SearchMatch find(const std::string& pattern, size_t from, const SearchOptions& options = SearchOptions()) const;
+    size_t getLineCount() const;
+    size_t getLineStart(size_t line) const;
+    std::pair<size_t, size_t> getLineAndColumn(size_t index) const;
     bool isUndoEmpty() const;
     bool isRedoEmpty() const;
 private:
-    void append(PieceDescriptor* piece);
-    void prepend(PieceDescriptor* piece);
-
-    void insertPiece(PieceDescriptor* piece, size_t index);
-    void erasePiece(size_t index);
-
-    bool isPieceOnEndOffBuffer(PieceDescriptor* piece) const;
-    static bool isInsidePiece(const size_t& index, const size_t& currentIndex, const size_t& length);
-    static bool isInsidePieceInclusive(const size_t& index, const size_t& currentIndex, const size_t& length);
+    bool isPieceOnEndOffBuffer(const PieceDescriptor* piece, const PieceDescriptor& newPiece) const;
+
+    void applyInsert(const PieceDescriptor& newPiece, size_t index, bool undoRedo);
+    void applyDelete(size_t start, size_t end, bool undoRedo);
+    std::vector<SearchMatch> findAll(const std::string& pattern, const SearchOptions& options) const;
+    void notifyListeners(const TextChange& change);
+    void beginBatch();
+    void endBatch();
+
+    void reverseGroup(ActionStack& stack, ActionStack& reverseStack);
+    void reverseOperation(ActionStack& stack, ActionStack& reverseStack, bool grouped);
+
+    void addToUndo(ActionType actionType, size_t index, const PieceDescriptor* pieces, size_t pieceCount, bool undoRedo);
+    void enforceMemoryLimit(ActionStack& stack);
+    void collectGarbage();
+    void mergeSmallPieces(const PieceDescriptor* pieces, size_t pieceCount, std::vector<PieceDescriptor>& merged);
+    void clearUndoStack();
+    void clearRedoStack();
 
-    PieceDescriptor* cutoffFromMiddle(PieceDescriptor* piece, size_t index, size_t leftOffset, size_t rightOffset);
 
-    void reverseOperation(std::stack<ActionDescriptor*>& stack, std::stack<ActionDescriptor*>& reverseStack);
+    static bool continues(const PieceDescriptor& piece, const PieceDescriptor& next);
 
-    void addToUndo(ActionDescriptor* actionDescriptor, bool undoRedo);
-    void clearUndoStack();
-    void clearRedoStack();
+    size_t countLineBreaksBefore(size_t index) const;
+    size_t findLineBreak(size_t n) const;
 
-    void insertTextInBuffer(std::string& text);
+    // Runs of at least m_minSmallPieceRun add buffer pieces shorter than m_smallPieceLength are copied
+    // into one piece by compact, as long as their text fits into m_maxSmallPieceRunLength
+    static const size_t m_smallPieceLength;
+    static const size_t m_minSmallPieceRun;
+    static const size_t m_maxSmallPieceRunLength;
 
-    std::string* m_originalBuffer;
-    std::string* m_addBuffer;
+    // The buffers are shared with the snapshots, so they outlive the table as long as a snapshot reads them
+    std::shared_ptr<OriginalBuffer> m_originalBuffer;
     InsertBuffer* m_insertBuffer;
     DeleteBuffer* m_deleteBuffer;
-    std::list<PieceDescriptor*> m_pieces;
-    std::stack<ActionDescriptor*> m_undoStack;
-    std::stack<ActionDescriptor*> m_redoStack;
+    std::shared_ptr<LineBreakIndex> m_originalLineBreaks;
+    std::shared_ptr<AddBuffer> m_addBuffer;
+    PieceTree m_pieces;
+    ActionStack m_undoStack;
+    ActionStack m_redoStack;
+    std::vector<PieceDescriptor> m_erasedPieces;
+    std::vector<TextChangeListener*> m_listeners;
+    // While a batch is applied or undone its changes are merged into one, and its actions are grouped
+    bool m_batching;
+    bool m_batchChanged;
+    bool m_groupNextAction;
+    TextChange m_batchChange;
     size_t m_size;
+    size_t m_version;
+    // How much of the original buffer is part of the text, less than all of it while a file is loading
+    size_t m_loadedOriginalSize;
 };
 
 
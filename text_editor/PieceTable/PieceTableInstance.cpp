@@ -4,40 +4,150 @@
 
 #include "PieceTableInstance.h"
 
-PieceTableInstance::PieceTableInstance() : m_file(nullptr) {
+const size_t PieceTableInstance::m_loadingStep = 8 * 1024 * 1024;
+
+PieceTableInstance::PieceTableInstance() : m_file(nullptr), m_loader(nullptr), m_loaderTableCreated(false), m_loadedSize(0),
+      m_journal(nullptr), m_recoveredEdits(false) {
     m_pieceTable = new PieceTable();
+
+    // Registered first, so the anchors are up to date when the other listeners hear about a change
+    m_anchors = new AnchorTree();
+    addListener(m_anchors);
 }
 
+// Closing the editor throws the unsaved edits away, so their journal goes with them
 PieceTableInstance::~PieceTableInstance() {
+    discardJournal();
+
+    // The loader writes into the table's original buffer
+    delete m_loader;
     delete m_pieceTable;
+    delete m_anchors;
     delete m_file;
 }
 
 void PieceTableInstance::newFile() {
+    cancelLoading();
+    discardJournal();
+
     auto oldFile = m_file;
     m_file = nullptr;
     delete oldFile;
 
-    auto oldTable = m_pieceTable;
-    m_pieceTable = new PieceTable();
-    delete oldTable;
+    replaceTable(new PieceTable());
+}
+
+// Shows the text without a file behind it, nothing gets journaled
+void PieceTableInstance::openText(std::string &buffer) {
+    cancelLoading();
+    discardJournal();
+
+    auto oldFile = m_file;
+    m_file = nullptr;
+    delete oldFile;
+
+    replaceTable(new PieceTable(buffer));
 }
 
 void PieceTableInstance::open(std::string &buffer, std::string& filePath) {
+    cancelLoading();
+    discardJournal();
+
     // Create new instance for PieceTable and delete old One
-    auto oldTable = m_pieceTable;
-    m_pieceTable = new PieceTable(buffer);
-    delete oldTable;
+    replaceTable(new PieceTable(buffer));
 
     // Update file information
-    m_file = new File(filePath);
+    setFile(filePath);
+    startJournal(true);
+}
+
+// Starts loading the file in the background, the text shows up as continueLoading adds it to the piece table
+bool PieceTableInstance::open(std::string &filePath) {
+    std::ifstream input(filePath);
+    if (!input.is_open())
+        return false;
+    input.close();
+
+    cancelLoading();
+    discardJournal();
+
+    m_loader = new FileLoader(filePath);
+    m_loaderTableCreated = false;
+    m_loadedSize = 0;
+
+    replaceTable(new PieceTable());
+    setFile(filePath);
+    return true;
+}
+
+// Adds the part of the file the loader has finished since the last call to the piece table, at most m_loadingStep
+// characters at a time so a frame never waits for the whole file. Returns false if the file couldn't be loaded,
+// the instance then holds a new file
+bool PieceTableInstance::continueLoading() {
+    if (m_loader == nullptr)
+        return true;
+
+    auto state = m_loader->getState();
+
+    if (state == FileLoader::State::Preparing)
+        return true;
+
+    if (state == FileLoader::State::Failed) {
+        newFile();
+        return false;
+    }
+
+    if (!m_loaderTableCreated) {
+        replaceTable(new PieceTable(m_loader->takeBuffer(), 0));
+        m_loaderTableCreated = true;
+    }
+
+    // The state is read first, a loaded state means the loaded size is final
+    auto loadedSize = m_loader->getLoadedSize();
+    auto step = std::min(loadedSize - m_loadedSize, m_loadingStep);
+
+    m_pieceTable->appendOriginal(step);
+    m_loadedSize += step;
+
+    if (state == FileLoader::State::Loaded && m_loadedSize == loadedSize) {
+        delete m_loader;
+        m_loader = nullptr;
+        startJournal(true);
+    }
+
+    return true;
+}
+
+// Stops loading the file, the text loaded so far stays in the piece table
+void PieceTableInstance::cancelLoading() {
+    delete m_loader;
+    m_loader = nullptr;
 }
 
 PieceTable& PieceTableInstance::getInstance() const { return *m_pieceTable; }
 
+AnchorTree& PieceTableInstance::getAnchors() const { return *m_anchors; }
+
 File* PieceTableInstance::getFile() const { return m_file; }
 
+bool PieceTableInstance::isLoading() const { return m_loader != nullptr; }
+
+// Returns the part of the file that is in the piece table, between 0 and 1
+float PieceTableInstance::getLoadingProgress() const {
+    if (m_loader == nullptr)
+        return 1.0f;
+
+    auto state = m_loader->getState();
+    if (state == FileLoader::State::Preparing || m_loader->getFileSize() == 0)
+        return 0.0f;
+
+    return std::min(1.0f, (float) m_loadedSize / (float) m_loader->getFileSize());
+}
+
+// The edits journaled so far belong to the file that was there before
 void PieceTableInstance::setFile(std::string &filePath) {
+    discardJournal();
+
     if (m_file != nullptr) {
         auto oldFile = m_file;
         m_file = nullptr;
@@ -46,3 +156,65 @@ void PieceTableInstance::setFile(std::string &filePath) {
 
     m_file = new File(filePath);
 }
+
+// The file on the disk now holds the text, the journal starts over from it
+void PieceTableInstance::fileSaved() {
+    discardJournal();
+    startJournal(false);
+}
+
+// Whether the text holds edits recovered from a journal that haven't been saved yet
+bool PieceTableInstance::hasRecoveredEdits() const { return m_recoveredEdits; }
+
+// Applies the journal a crash left next to the file when recovering, then journals the edits that follow
+void PieceTableInstance::startJournal(bool recover) {
+    if (m_file == nullptr)
+        return;
+
+    m_journal = new EditJournal(*m_pieceTable, m_file->getPath());
+
+    if (recover && m_journal->recover(*m_pieceTable) > 0)
+        m_recoveredEdits = true;
+
+    if (!m_journal->start()) {
+        delete m_journal;
+        m_journal = nullptr;
+        return;
+    }
+
+    m_pieceTable->addListener(m_journal);
+}
+
+void PieceTableInstance::discardJournal() {
+    m_recoveredEdits = false;
+
+    if (m_journal == nullptr)
+        return;
+
+    m_pieceTable->removeListener(m_journal);
+    m_journal->discard();
+    delete m_journal;
+    m_journal = nullptr;
+}
+
+// Listeners are kept here, so they stay registered when the piece table gets replaced
+void PieceTableInstance::addListener(TextChangeListener *listener) {
+    m_listeners.push_back(listener);
+    m_pieceTable->addListener(listener);
+}
+
+void PieceTableInstance::removeListener(TextChangeListener *listener) {
+    m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+    m_pieceTable->removeListener(listener);
+}
+
+void PieceTableInstance::replaceTable(PieceTable *pieceTable) {
+    auto oldTable = m_pieceTable;
+    m_pieceTable = pieceTable;
+    delete oldTable;
+
+    for (auto listener : m_listeners) {
+        m_pieceTable->addListener(listener);
+        listener->onTextReset();
+    }
+}
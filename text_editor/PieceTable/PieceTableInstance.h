@@ -5,8 +5,11 @@
 #ifndef TEXT_EDITOR_PIECETABLEINSTANCE_H
 #define TEXT_EDITOR_PIECETABLEINSTANCE_H
 
+#include "AnchorTree.h"
 #include "PieceTable.h"
 #include "../File.h"
+#include "../EditJournal.h"
+#include "../FileLoader.h"
 
 class PieceTableInstance {
 public:
@@ -15,14 +18,43 @@ public:
 
     void newFile();
     void open(std::string& buffer, std::string& filePath);
+    void openText(std::string& buffer);
+    bool open(std::string& filePath);
+    bool continueLoading();
 
     PieceTable& getInstance() const;
+    AnchorTree& getAnchors() const;
     File* getFile() const;
+    bool isLoading() const;
+    float getLoadingProgress() const;
+    bool hasRecoveredEdits() const;
 
     void setFile(std::string& filePath);
+    void fileSaved();
+
+    void addListener(TextChangeListener* listener);
+    void removeListener(TextChangeListener* listener);
 private:
+    void replaceTable(PieceTable* pieceTable);
+    void cancelLoading();
+    void startJournal(bool recover);
+    void discardJournal();
+
+    // At most this much of a loading file is added to the piece table per frame
+    static const size_t m_loadingStep;
+
     PieceTable* m_pieceTable;
+    // Positions that move with the edits, they are kept when the piece table gets replaced
+    AnchorTree* m_anchors;
     File* m_file;
+    // Loads the opened file in the background, the piece table gets the loaded text bit by bit
+    FileLoader* m_loader;
+    bool m_loaderTableCreated;
+    size_t m_loadedSize;
+    // Keeps the unsaved edits of the file on the disk until it is saved, started once the file is loaded
+    EditJournal* m_journal;
+    bool m_recoveredEdits;
+    std::vector<TextChangeListener*> m_listeners;
 };
 
 
@@ -0,0 +1,576 @@
+#include "PieceTree.h"
+
+#include <algorithm>
+
+PieceTree::Node::Node(const PieceDescriptor &piece)
+    : m_piece(piece), m_left(nullptr), m_right(nullptr), m_height(1), m_length(piece.getLength()),
+      m_lineBreaks(piece.getLineBreaks()), m_count(1), m_refs(1) {}
+
+// Copies a node that is about to be changed, the copy has the same children
+PieceTree::Node::Node(const Node &node)
+    : m_piece(node.m_piece), m_left(node.m_left), m_right(node.m_right), m_height(node.m_height), m_length(node.m_length),
+      m_lineBreaks(node.m_lineBreaks), m_count(node.m_count), m_refs(1) {}
+
+PieceTree::Iterator::Iterator() : m_root(nullptr), m_pieceStartOffset(0) {}
+
+// Creates the end iterator
+PieceTree::Iterator::Iterator(const Node *root) : m_root(root), m_pieceStartOffset(length(root)) {}
+
+// Positions the iterator on the piece that contains offset
+PieceTree::Iterator::Iterator(const Node *root, size_t offset) : m_root(root), m_pieceStartOffset(0) {
+    auto node = root;
+
+    while (node != nullptr) {
+        auto leftLength = length(node->m_left);
+        m_path.push_back(node);
+
+        if (offset < leftLength) {
+            node = node->m_left;
+        } else if (offset < leftLength + node->m_piece.getLength()) {
+            m_pieceStartOffset += leftLength;
+            return;
+        } else {
+            offset -= leftLength + node->m_piece.getLength();
+            m_pieceStartOffset += leftLength + node->m_piece.getLength();
+            node = node->m_right;
+        }
+    }
+
+    // The offset is past the last piece, so this is the end iterator
+    m_path.clear();
+    m_pieceStartOffset = length(root);
+}
+
+const PieceDescriptor &PieceTree::Iterator::operator*() const { return m_path.back()->m_piece; }
+
+const PieceDescriptor *PieceTree::Iterator::operator->() const { return &m_path.back()->m_piece; }
+
+// The path holds every ancestor of the current piece, so we can move in both directions
+PieceTree::Iterator &PieceTree::Iterator::operator++() {
+    auto node = m_path.back();
+    m_pieceStartOffset += node->m_piece.getLength();
+
+    if (node->m_right != nullptr) {
+        pushLeftPath(node->m_right);
+    } else {
+        // Go up until we come from a left child
+        const Node* child;
+        do {
+            child = m_path.back();
+            m_path.pop_back();
+        } while (!m_path.empty() && m_path.back()->m_right == child);
+    }
+
+    return *this;
+}
+
+PieceTree::Iterator &PieceTree::Iterator::operator--() {
+    if (m_path.empty()) {
+        // Decrementing the end iterator gives the last piece
+        pushRightPath(m_root);
+    } else if (m_path.back()->m_left != nullptr) {
+        pushRightPath(m_path.back()->m_left);
+    } else {
+        // Go up until we come from a right child
+        const Node* child;
+        do {
+            child = m_path.back();
+            m_path.pop_back();
+        } while (!m_path.empty() && m_path.back()->m_left == child);
+    }
+
+    if (!m_path.empty())
+        m_pieceStartOffset -= m_path.back()->m_piece.getLength();
+
+    return *this;
+}
+
+bool PieceTree::Iterator::operator==(const Iterator &other) const {
+    if (m_path.empty() || other.m_path.empty())
+        return m_path.empty() && other.m_path.empty();
+
+    return m_path.back() == other.m_path.back();
+}
+
+bool PieceTree::Iterator::operator!=(const Iterator &other) const { return !(*this == other); }
+
+size_t PieceTree::Iterator::getPieceStartOffset() const { return m_pieceStartOffset; }
+
+void PieceTree::Iterator::pushLeftPath(const Node *node) {
+    while (node != nullptr) {
+        m_path.push_back(node);
+        node = node->m_left;
+    }
+}
+
+void PieceTree::Iterator::pushRightPath(const Node *node) {
+    while (node != nullptr) {
+        m_path.push_back(node);
+        node = node->m_right;
+    }
+}
+
+PieceTree::PieceTree(const LineBreakIndex* originalLineBreaks, const AddBuffer* addBuffer)
+    : m_root(nullptr), m_nodePool(std::make_shared<NodePool>()), m_originalLineBreaks(originalLineBreaks), m_addBuffer(addBuffer) {}
+
+// Without snapshots the nodes are freed together with the blocks of the pool
+PieceTree::~PieceTree() {
+    if (m_nodePool.use_count() > 1)
+        release(m_root, *m_nodePool);
+}
+
+PieceTree::Iterator PieceTree::begin() const { return Iterator(m_root, 0); }
+
+PieceTree::Iterator PieceTree::end() const { return Iterator(m_root); }
+
+PieceTree::Iterator PieceTree::find(size_t offset) const { return Iterator(m_root, offset); }
+
+// Inserts the piece at the offset, splitting the piece that contains the offset if needed
+void PieceTree::insert(const PieceDescriptor &piece, size_t offset) {
+    if (piece.getLength() == 0)
+        return;
+
+    Node* left;
+    Node* right;
+
+    PieceDescriptor countedPiece(piece);
+    countedPiece.setLineBreaks(countLineBreaks(piece));
+
+    split(m_root, offset, left, right);
+    m_root = join(left, m_nodePool->create(countedPiece), right);
+}
+
+// Inserts a run of non empty pieces at the offset. The run is built into a balanced tree of its own first,
+// so this takes O(k + log n) instead of k separate insertions
+void PieceTree::insert(const PieceDescriptor *pieces, size_t pieceCount, size_t offset) {
+    auto run = build(pieces, pieceCount);
+    if (run == nullptr)
+        return;
+
+    Node* left;
+    Node* right;
+
+    split(m_root, offset, left, right);
+    m_root = join(join(left, run), right);
+}
+
+// Erases the range [start, end) and appends the erased pieces to erased in document order
+void PieceTree::erase(size_t start, size_t end, std::vector<PieceDescriptor>& erased) {
+    if (start >= end)
+        return;
+
+    Node* left;
+    Node* middle;
+    Node* right;
+
+    split(m_root, start, left, right);
+    split(right, end - start, middle, right);
+
+    collect(middle, erased);
+    release(middle, *m_nodePool);
+
+    m_root = join(left, right);
+}
+
+// Replaces all the pieces with a run of non empty pieces, building the tree in O(k)
+void PieceTree::assign(const PieceDescriptor *pieces, size_t pieceCount) {
+    clear();
+    m_root = build(pieces, pieceCount);
+}
+
+void PieceTree::clear() {
+    if (m_nodePool.use_count() > 1)
+        release(m_root, *m_nodePool);
+    else
+        m_nodePool->clear();
+
+    m_root = nullptr;
+}
+
+// The cached line break counts stay valid as long as the new index holds the same line breaks
+void PieceTree::setOriginalLineBreaks(const LineBreakIndex *originalLineBreaks) {
+    m_originalLineBreaks = originalLineBreaks;
+}
+
+const PieceTree::Node *PieceTree::getRoot() const { return m_root; }
+
+// Returns the root with a reference added for a snapshot, which has to release it
+const PieceTree::Node *PieceTree::share() const {
+    if (m_root != nullptr)
+        m_root->m_refs.fetch_add(1, std::memory_order_relaxed);
+
+    return m_root;
+}
+
+const std::shared_ptr<PieceTree::NodePool> &PieceTree::getNodePool() const { return m_nodePool; }
+
+// Drops a reference to the node. The last reference frees the node and drops its references to its children
+void PieceTree::release(const Node *node, NodePool &pool) {
+    while (node != nullptr && node->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        auto left = node->m_left;
+        auto right = node->m_right;
+
+        pool.destroy(const_cast<Node*>(node));
+        release(left, pool);
+        node = right;
+    }
+}
+
+// Returns the piece that ends exactly at the offset, or nullptr if the offset is inside a piece
+const PieceDescriptor *PieceTree::pieceEndingAt(size_t offset) const {
+    auto node = m_root;
+
+    while (node != nullptr) {
+        auto leftLength = length(node->m_left);
+        auto pieceEnd = leftLength + node->m_piece.getLength();
+
+        if (offset <= leftLength) {
+            node = node->m_left;
+        } else if (offset == pieceEnd) {
+            return &node->m_piece;
+        } else if (offset > pieceEnd) {
+            offset -= pieceEnd;
+            node = node->m_right;
+        } else {
+            return nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+// Grows the piece that ends at the offset by length characters
+void PieceTree::extendPieceEndingAt(size_t offset, size_t length) {
+    extendPieceEndingAt(m_root, offset, length);
+}
+
+// Returns the number of line breaks in the range [0, offset)
+size_t PieceTree::countLineBreaksBefore(size_t offset) const {
+    size_t result = 0;
+    auto node = m_root;
+
+    while (node != nullptr) {
+        auto leftLength = length(node->m_left);
+        auto& piece = node->m_piece;
+
+        if (offset <= leftLength) {
+            node = node->m_left;
+        } else if (offset < leftLength + piece.getLength()) {
+            auto& index = getLineBreakIndex(piece.getSource());
+            return result + lineBreaks(node->m_left) + index.count(getIndexPosition(piece, 0), offset - leftLength);
+        } else {
+            result += lineBreaks(node->m_left) + piece.getLineBreaks();
+            offset -= leftLength + piece.getLength();
+            node = node->m_right;
+        }
+    }
+
+    return result;
+}
+
+// Returns the offset of the n-th (zero based) line break, n has to be less than getLineBreakCount()
+size_t PieceTree::findLineBreak(size_t n) const {
+    size_t offset = 0;
+    auto node = m_root;
+
+    while (node != nullptr) {
+        auto leftLineBreaks = lineBreaks(node->m_left);
+        auto& piece = node->m_piece;
+
+        if (n < leftLineBreaks) {
+            node = node->m_left;
+        } else if (n < leftLineBreaks + piece.getLineBreaks()) {
+            auto& index = getLineBreakIndex(piece.getSource());
+            auto position = index.find(getIndexPosition(piece, 0), n - leftLineBreaks);
+            return offset + length(node->m_left) + (position - getIndexPosition(piece, 0));
+        } else {
+            n -= leftLineBreaks + piece.getLineBreaks();
+            offset += length(node->m_left) + piece.getLength();
+            node = node->m_right;
+        }
+    }
+
+    return offset;
+}
+
+size_t PieceTree::getSize() const { return length(m_root); }
+
+size_t PieceTree::getLineBreakCount() const { return lineBreaks(m_root); }
+
+size_t PieceTree::getPieceCount() const { return count(m_root); }
+
+bool PieceTree::isEmpty() const { return m_root == nullptr; }
+
+int PieceTree::height(const Node *node) { return node == nullptr ? 0 : node->m_height; }
+
+size_t PieceTree::length(const Node *node) { return node == nullptr ? 0 : node->m_length; }
+
+size_t PieceTree::lineBreaks(const Node *node) { return node == nullptr ? 0 : node->m_lineBreaks; }
+
+size_t PieceTree::count(const Node *node) { return node == nullptr ? 0 : node->m_count; }
+
+void PieceTree::update(Node *node) {
+    node->m_height = 1 + std::max(height(node->m_left), height(node->m_right));
+    node->m_length = length(node->m_left) + node->m_piece.getLength() + length(node->m_right);
+    node->m_lineBreaks = lineBreaks(node->m_left) + node->m_piece.getLineBreaks() + lineBreaks(node->m_right);
+    node->m_count = count(node->m_left) + 1 + count(node->m_right);
+}
+
+// Returns a node that can be changed in place. A shared node is copied, the reference of the caller
+// moves to the copy and its children get the copy as another parent
+PieceTree::Node *PieceTree::own(Node *node) {
+    if (node == nullptr || node->m_refs.load(std::memory_order_acquire) == 1)
+        return node;
+
+    auto copy = m_nodePool->create(*node);
+
+    if (copy->m_left != nullptr)
+        copy->m_left->m_refs.fetch_add(1, std::memory_order_relaxed);
+    if (copy->m_right != nullptr)
+        copy->m_right->m_refs.fetch_add(1, std::memory_order_relaxed);
+
+    release(node, *m_nodePool);
+    return copy;
+}
+
+PieceTree::Node *PieceTree::rotateLeft(Node *node) {
+    node = own(node);
+    auto right = own(node->m_right);
+    node->m_right = right->m_left;
+    update(node);
+    right->m_left = node;
+    update(right);
+    return right;
+}
+
+PieceTree::Node *PieceTree::rotateRight(Node *node) {
+    node = own(node);
+    auto left = own(node->m_left);
+    node->m_left = left->m_right;
+    update(node);
+    left->m_right = node;
+    update(left);
+    return left;
+}
+
+// Joins two trees with a middle node when the left tree is higher,
+// by walking down the right spine of the left tree until the heights match
+PieceTree::Node *PieceTree::joinRight(Node *left, Node *middle, Node *right) {
+    left = own(left);
+    auto child = left->m_right;
+
+    if (height(child) <= height(right) + 1) {
+        middle = own(middle);
+        middle->m_left = child;
+        middle->m_right = right;
+        update(middle);
+
+        if (height(middle) <= height(left->m_left) + 1) {
+            left->m_right = middle;
+            update(left);
+            return left;
+        }
+
+        left->m_right = rotateRight(middle);
+        update(left);
+        return rotateLeft(left);
+    }
+
+    auto joined = joinRight(child, middle, right);
+    left->m_right = joined;
+    update(left);
+
+    if (height(joined) <= height(left->m_left) + 1)
+        return left;
+
+    return rotateLeft(left);
+}
+
+// Mirror image of joinRight for when the right tree is higher
+PieceTree::Node *PieceTree::joinLeft(Node *left, Node *middle, Node *right) {
+    right = own(right);
+    auto child = right->m_left;
+
+    if (height(child) <= height(left) + 1) {
+        middle = own(middle);
+        middle->m_left = left;
+        middle->m_right = child;
+        update(middle);
+
+        if (height(middle) <= height(right->m_right) + 1) {
+            right->m_left = middle;
+            update(right);
+            return right;
+        }
+
+        right->m_left = rotateLeft(middle);
+        update(right);
+        return rotateRight(right);
+    }
+
+    auto joined = joinLeft(left, middle, child);
+    right->m_left = joined;
+    update(right);
+
+    if (height(joined) <= height(right->m_right) + 1)
+        return right;
+
+    return rotateRight(right);
+}
+
+// Concatenates left, middle and right into one balanced tree in O(|height(left) - height(right)|)
+PieceTree::Node *PieceTree::join(Node *left, Node *middle, Node *right) {
+    if (height(left) > height(right) + 1)
+        return joinRight(left, middle, right);
+
+    if (height(right) > height(left) + 1)
+        return joinLeft(left, middle, right);
+
+    middle = own(middle);
+    middle->m_left = left;
+    middle->m_right = right;
+    update(middle);
+    return middle;
+}
+
+PieceTree::Node *PieceTree::join(Node *left, Node *right) {
+    if (left == nullptr)
+        return right;
+    if (right == nullptr)
+        return left;
+
+    Node* rest;
+    Node* last;
+    splitLast(left, rest, last);
+
+    return join(rest, last, right);
+}
+
+// Splits the tree so that the left tree holds the first offset characters.
+// If the offset falls inside a piece that piece is cut in two.
+void PieceTree::split(Node *node, size_t offset, Node *&left, Node *&right) {
+    if (node == nullptr) {
+        left = nullptr;
+        right = nullptr;
+        return;
+    }
+
+    node = own(node);
+    auto leftChild = node->m_left;
+    auto rightChild = node->m_right;
+    auto leftLength = length(leftChild);
+    auto pieceLength = node->m_piece.getLength();
+
+    node->m_left = nullptr;
+    node->m_right = nullptr;
+
+    if (offset <= leftLength) {
+        Node* leftRest;
+        split(leftChild, offset, left, leftRest);
+        right = join(leftRest, node, rightChild);
+    } else if (offset >= leftLength + pieceLength) {
+        Node* rightRest;
+        split(rightChild, offset - leftLength - pieceLength, rightRest, right);
+        left = join(leftChild, node, rightRest);
+    } else {
+        auto [leftPiece, rightPiece] = PieceDescriptor::splitPiece(node->m_piece, offset - leftLength);
+        leftPiece.setLineBreaks(countLineBreaks(leftPiece));
+        rightPiece.setLineBreaks(node->m_piece.getLineBreaks() - leftPiece.getLineBreaks());
+
+        node->m_piece = leftPiece;
+        left = join(leftChild, node, nullptr);
+        right = join(nullptr, m_nodePool->create(rightPiece), rightChild);
+    }
+}
+
+// Detaches the last node of the tree
+void PieceTree::splitLast(Node *node, Node *&rest, Node *&last) {
+    node = own(node);
+
+    if (node->m_right == nullptr) {
+        rest = node->m_left;
+        last = node;
+        node->m_left = nullptr;
+        return;
+    }
+
+    Node* rightRest;
+    splitLast(node->m_right, rightRest, last);
+
+    auto leftChild = node->m_left;
+    node->m_left = nullptr;
+    node->m_right = nullptr;
+    rest = join(leftChild, node, rightRest);
+}
+
+// Builds a perfectly balanced tree out of the pieces
+PieceTree::Node *PieceTree::build(const PieceDescriptor *pieces, size_t pieceCount) {
+    if (pieceCount == 0)
+        return nullptr;
+
+    auto middle = pieceCount / 2;
+    PieceDescriptor countedPiece(pieces[middle]);
+    countedPiece.setLineBreaks(countLineBreaks(countedPiece));
+
+    auto node = m_nodePool->create(countedPiece);
+    node->m_left = build(pieces, middle);
+    node->m_right = build(pieces + middle + 1, pieceCount - middle - 1);
+    update(node);
+    return node;
+}
+
+void PieceTree::collect(Node *node, std::vector<PieceDescriptor> &pieces) {
+    if (node == nullptr)
+        return;
+
+    collect(node->m_left, pieces);
+    pieces.push_back(node->m_piece);
+    collect(node->m_right, pieces);
+}
+
+bool PieceTree::extendPieceEndingAt(Node *&node, size_t offset, size_t length) {
+    if (node == nullptr)
+        return false;
+
+    node = own(node);
+
+    auto leftLength = PieceTree::length(node->m_left);
+    auto pieceEnd = leftLength + node->m_piece.getLength();
+    bool extended;
+
+    if (offset <= leftLength) {
+        extended = extendPieceEndingAt(node->m_left, offset, length);
+    } else if (offset == pieceEnd) {
+        auto& piece = node->m_piece;
+        auto& index = getLineBreakIndex(piece.getSource());
+
+        piece.setLineBreaks(piece.getLineBreaks() + index.count(getIndexPosition(piece, piece.getLength()), length));
+        piece.setLength(piece.getLength() + length);
+        extended = true;
+    } else if (offset > pieceEnd) {
+        extended = extendPieceEndingAt(node->m_right, offset - pieceEnd, length);
+    } else {
+        extended = false;
+    }
+
+    if (extended)
+        update(node);
+
+    return extended;
+}
+
+const LineBreakIndex &PieceTree::getLineBreakIndex(SourceType source) const {
+    return source == SourceType::Original ? *m_originalLineBreaks : m_addBuffer->getLineBreaks();
+}
+
+// Position of the offset inside the piece in the line break index of its buffer
+size_t PieceTree::getIndexPosition(const PieceDescriptor &piece, size_t offset) const {
+    if (piece.getSource() == SourceType::Original)
+        return piece.getStart() + offset;
+
+    return m_addBuffer->getIndexPosition(piece.getChunk(), piece.getStart() + offset);
+}
+
+size_t PieceTree::countLineBreaks(const PieceDescriptor &piece) const {
+    return getLineBreakIndex(piece.getSource()).count(getIndexPosition(piece, 0), piece.getLength());
+}
@@ -0,0 +1,131 @@
+#ifndef TEXT_EDITOR_PIECETREE_H
+#define TEXT_EDITOR_PIECETREE_H
+
+#include "AddBuffer.h"
+#include "LineBreakIndex.h"
+#include "PieceDescriptor.h"
+#include "Pool.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Height balanced (AVL) tree of pieces ordered by their position in the document.
+// Every node caches the total length, line break count and piece count of its subtree,
+// so finding, splitting, inserting and erasing at a text offset, as well as mapping
+// between offsets and lines, are all O(log n) in the number of pieces.
+//
+// Nodes are reference counted and shared with snapshots. A node that is referenced more than
+// once is never changed, an edit copies it first, so an edit after a snapshot copies only the
+// O(log n) nodes on the paths it touches and the snapshot keeps seeing the old tree.
+class PieceTree {
+public:
+    struct Node {
+        explicit Node(const PieceDescriptor& piece);
+        Node(const Node& node);
+
+        PieceDescriptor m_piece;
+        Node* m_left;
+        Node* m_right;
+        int m_height;
+        size_t m_length;
+        size_t m_lineBreaks;
+        size_t m_count;
+        // Number of parents and snapshots referring to the node
+        mutable std::atomic<size_t> m_refs;
+    };
+
+    typedef Pool<Node> NodePool;
+
+    class Iterator {
+    public:
+        Iterator();
+        explicit Iterator(const Node* root);
+        Iterator(const Node* root, size_t offset);
+
+        const PieceDescriptor& operator*() const;
+        const PieceDescriptor* operator->() const;
+        Iterator& operator++();
+        Iterator& operator--();
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+
+        size_t getPieceStartOffset() const;
+    private:
+        void pushLeftPath(const Node* node);
+        void pushRightPath(const Node* node);
+
+        const Node* m_root;
+        std::vector<const Node*> m_path;
+        size_t m_pieceStartOffset;
+    };
+
+    PieceTree(const LineBreakIndex* originalLineBreaks, const AddBuffer* addBuffer);
+    ~PieceTree();
+
+    PieceTree(const PieceTree&) = delete;
+    PieceTree& operator=(const PieceTree&) = delete;
+
+    Iterator begin() const;
+    Iterator end() const;
+    Iterator find(size_t offset) const;
+
+    void insert(const PieceDescriptor& piece, size_t offset);
+    void insert(const PieceDescriptor* pieces, size_t pieceCount, size_t offset);
+    void erase(size_t start, size_t end, std::vector<PieceDescriptor>& erased);
+    void assign(const PieceDescriptor* pieces, size_t pieceCount);
+    void clear();
+
+    const Node* getRoot() const;
+    const Node* share() const;
+    const std::shared_ptr<NodePool>& getNodePool() const;
+    static void release(const Node* node, NodePool& pool);
+
+    void setOriginalLineBreaks(const LineBreakIndex* originalLineBreaks);
+
+    const PieceDescriptor* pieceEndingAt(size_t offset) const;
+    void extendPieceEndingAt(size_t offset, size_t length);
+
+    size_t countLineBreaksBefore(size_t offset) const;
+    size_t findLineBreak(size_t n) const;
+
+    size_t getSize() const;
+    size_t getLineBreakCount() const;
+    size_t getPieceCount() const;
+    bool isEmpty() const;
+private:
+    static int height(const Node* node);
+    static size_t length(const Node* node);
+    static size_t lineBreaks(const Node* node);
+    static size_t count(const Node* node);
+    static void update(Node* node);
+
+    Node* own(Node* node);
+
+    Node* rotateLeft(Node* node);
+    Node* rotateRight(Node* node);
+    Node* joinRight(Node* left, Node* middle, Node* right);
+    Node* joinLeft(Node* left, Node* middle, Node* right);
+    Node* join(Node* left, Node* middle, Node* right);
+    Node* join(Node* left, Node* right);
+    void split(Node* node, size_t offset, Node*& left, Node*& right);
+    void splitLast(Node* node, Node*& rest, Node*& last);
+    Node* build(const PieceDescriptor* pieces, size_t pieceCount);
+
+    static void collect(Node* node, std::vector<PieceDescriptor>& pieces);
+
+    bool extendPieceEndingAt(Node*& node, size_t offset, size_t length);
+
+    const LineBreakIndex& getLineBreakIndex(SourceType source) const;
+    size_t getIndexPosition(const PieceDescriptor& piece, size_t offset) const;
+    size_t countLineBreaks(const PieceDescriptor& piece) const;
+
+    Node* m_root;
+    // Shared with the snapshots, which free their nodes into it when they are released
+    std::shared_ptr<NodePool> m_nodePool;
+    const LineBreakIndex* m_originalLineBreaks;
+    const AddBuffer* m_addBuffer;
+};
+
+
+#endif //TEXT_EDITOR_PIECETREE_H
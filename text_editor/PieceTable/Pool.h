@@ -0,0 +1,73 @@
+#ifndef TEXT_EDITOR_POOL_H
+#define TEXT_EDITOR_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Hands out objects from big blocks and keeps the destroyed ones in a free list for reuse,
+// so creating and destroying objects doesn't go through malloc/free every time.
+// Clearing the pool frees all of its blocks at once. Objects can be created and destroyed
+// from different threads, which snapshots releasing their nodes on a worker thread need.
+template <typename T>
+class Pool {
+public:
+    explicit Pool(size_t blockSize = 256) : m_free(nullptr), m_blockSize(blockSize) {}
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_free == nullptr)
+            allocateBlock();
+
+        auto slot = m_free;
+        m_free = slot->m_next;
+
+        return new (slot->m_storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        object->~T();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto slot = reinterpret_cast<Slot*>(object);
+        slot->m_next = m_free;
+        m_free = slot;
+    }
+
+    // Frees every block, the objects in the pool must not be used afterwards
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_blocks.clear();
+        m_free = nullptr;
+    }
+private:
+    union Slot {
+        Slot* m_next;
+        alignas(T) unsigned char m_storage[sizeof(T)];
+    };
+
+    void allocateBlock() {
+        auto block = std::make_unique<Slot[]>(m_blockSize);
+
+        for (size_t i=0; i<m_blockSize; ++i)
+            block[i].m_next = i + 1 < m_blockSize ? &block[i + 1] : m_free;
+
+        m_free = &block[0];
+        m_blocks.push_back(std::move(block));
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> m_blocks;
+    Slot* m_free;
+    size_t m_blockSize;
+    std::mutex m_mutex;
+};
+
+
+#endif //TEXT_EDITOR_POOL_H
@@ -0,0 +1,28 @@
+#ifndef TEXT_EDITOR_TEXTCHANGELISTENER_H
+#define TEXT_EDITOR_TEXTCHANGELISTENER_H
+
+#include <cstddef>
+
+// Describes a change of the text as it is shown: at m_index, m_removedLength characters were
+// replaced by m_insertedLength characters
+struct TextChange {
+    size_t m_index;
+    size_t m_removedLength;
+    size_t m_insertedLength;
+};
+
+// Gets notified about every visible change of a piece table's text
+class TextChangeListener {
+public:
+    virtual ~TextChangeListener() = default;
+
+    virtual void onTextChange(const TextChange& change) = 0;
+    // The whole text was replaced (new file or open)
+    virtual void onTextReset() = 0;
+    // Listeners that follow positions in the text (anchors) hear about every change of a batch as it happens,
+    // the others get a single change covering the whole batch when it ends
+    virtual bool tracksPositions() const { return false; }
+};
+
+
+#endif //TEXT_EDITOR_TEXTCHANGELISTENER_H
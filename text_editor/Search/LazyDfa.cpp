@@ -0,0 +1,175 @@
+#include "LazyDfa.h"
+
+#include <algorithm>
+
+const size_t LazyDfa::m_maxCachedStates = 4096;
+const int LazyDfa::m_unknownNext = -2;
+
+LazyDfa::LazyDfa(const RegexProgram &program, bool anchored, bool longest)
+    : m_program(program), m_anchored(anchored), m_longest(longest), m_start{nullptr, nullptr}, m_cacheClears(0),
+      m_seen(program.getStateCount(), 0), m_generation(0) {
+    if (!m_anchored) {
+        bool matched = false;
+        ++m_generation;
+        addClosure(m_idleStates, m_program.getUnanchoredStart(), false, m_unknownNext, matched);
+    }
+}
+
+LazyDfa::~LazyDfa() {}
+
+// Returns the state before reading anything, the text before it decides if ^ passes at the start
+LazyDfa::State *LazyDfa::getStart(bool lastWasLineBreak) {
+    auto& start = m_start[lastWasLineBreak];
+
+    if (start == nullptr) {
+        std::vector<int> nfaStates;
+        bool matched = false;
+
+        ++m_generation;
+        addClosure(nfaStates, m_anchored ? m_program.getAnchoredStart() : m_program.getUnanchoredStart(),
+                   lastWasLineBreak, m_unknownNext, matched);
+
+        // Can't be cleared while adding the start state, since that is the only one needed
+        auto state = findOrAdd(nfaStates, lastWasLineBreak);
+        m_start[lastWasLineBreak] = state;
+    }
+
+    return m_start[lastWasLineBreak];
+}
+
+LazyDfa::State *LazyDfa::computeNext(State *state, unsigned char c) {
+    // The $ states waiting for the next byte can be decided now
+    resolveNextLineBreak(state->m_nfaStates, state->m_lastWasLineBreak, c, m_resolved);
+
+    m_next.clear();
+    bool matched = false;
+    ++m_generation;
+
+    for (auto nfaState : m_resolved) {
+        auto& current = m_program.getState(nfaState);
+
+        // In the leftmost first mode nothing after a match is tried
+        if (current.m_type == MatchState) {
+            if (!m_longest)
+                break;
+            continue;
+        }
+
+        if (current.m_type == BytesState && current.m_bytes.test(c)) {
+            addClosure(m_next, current.m_out, c == '\n', m_unknownNext, matched);
+
+            if (matched && !m_longest)
+                break;
+        }
+    }
+
+    auto cacheClears = m_cacheClears;
+    auto next = findOrAdd(m_next, c == '\n');
+
+    // If the cache was cleared the state is gone, so the transition isn't stored
+    if (cacheClears == m_cacheClears)
+        state->m_next[c] = next;
+
+    return next;
+}
+
+void LazyDfa::resolveNextLineBreak(const std::vector<int> &nfaStates, bool lastWasLineBreak, int next, std::vector<int> &resolved) {
+    resolved.clear();
+    bool matched = false;
+    ++m_generation;
+
+    for (auto nfaState : nfaStates) {
+        addClosure(resolved, nfaState, lastWasLineBreak, next, matched);
+
+        if (matched && !m_longest)
+            break;
+    }
+}
+
+// Adds the NFA states reachable from start without reading a byte, in priority order. The $ states are
+// kept while the next byte is unknown, and followed or dropped once it is known.
+void LazyDfa::addClosure(std::vector<int> &nfaStates, int start, bool lastWasLineBreak, int next, bool &matched) {
+    m_stack.clear();
+    m_stack.push_back(start);
+
+    while (!m_stack.empty()) {
+        auto nfaState = m_stack.back();
+        m_stack.pop_back();
+
+        if (m_seen[nfaState] == m_generation)
+            continue;
+
+        m_seen[nfaState] = m_generation;
+        auto& current = m_program.getState(nfaState);
+
+        switch (current.m_type) {
+            case BytesState:
+                nfaStates.push_back(nfaState);
+                break;
+            case MatchState:
+                nfaStates.push_back(nfaState);
+                matched = true;
+
+                // Whatever is left on the stack has a lower priority than the match
+                if (!m_longest) {
+                    m_stack.clear();
+                    return;
+                }
+                break;
+            case SplitState:
+                m_stack.push_back(current.m_out1);
+                m_stack.push_back(current.m_out);
+                break;
+            case EpsilonState:
+                m_stack.push_back(current.m_out);
+                break;
+            case LastLineBreakState:
+                if (lastWasLineBreak)
+                    m_stack.push_back(current.m_out);
+                break;
+            case NextLineBreakState:
+                if (next == m_unknownNext)
+                    nfaStates.push_back(nfaState);
+                else if (next == '\n' || next < 0)
+                    m_stack.push_back(current.m_out);
+                break;
+        }
+    }
+}
+
+LazyDfa::State *LazyDfa::findOrAdd(std::vector<int> &nfaStates, bool lastWasLineBreak) {
+    std::string key(reinterpret_cast<const char*>(nfaStates.data()), nfaStates.size() * sizeof(int));
+    key.push_back(lastWasLineBreak ? 1 : 0);
+
+    auto found = m_states.find(key);
+    if (found != m_states.end())
+        return found->second.get();
+
+    if (m_states.size() >= m_maxCachedStates)
+        clearCache();
+
+    auto state = std::make_unique<State>();
+    state->m_nfaStates = nfaStates;
+    state->m_lastWasLineBreak = lastWasLineBreak;
+    state->m_match = std::any_of(nfaStates.begin(), nfaStates.end(),
+                                 [this](int nfaState) { return m_program.getState(nfaState).m_type == MatchState; });
+
+    resolveNextLineBreak(nfaStates, lastWasLineBreak, '\n', m_resolved);
+    state->m_matchBeforeLineBreak = std::any_of(m_resolved.begin(), m_resolved.end(),
+                                                [this](int nfaState) { return m_program.getState(nfaState).m_type == MatchState; });
+    state->m_dead = nfaStates.empty();
+    state->m_idle = !m_anchored && !lastWasLineBreak && nfaStates == m_idleStates;
+
+    std::fill(std::begin(state->m_next), std::end(state->m_next), state->m_dead ? state.get() : nullptr);
+
+    auto result = state.get();
+    m_states.emplace(std::move(key), std::move(state));
+    return result;
+}
+
+void LazyDfa::clearCache() {
+    m_states.clear();
+    m_start[0] = nullptr;
+    m_start[1] = nullptr;
+    ++m_cacheClears;
+}
@@ -0,0 +1,77 @@
+#ifndef TEXT_EDITOR_LAZYDFA_H
+#define TEXT_EDITOR_LAZYDFA_H
+
+#include "RegexProgram.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// DFA built from a RegexProgram while it runs. A DFA state is the ordered list of the NFA states the
+// program can be in, and its transitions are filled in the first time they are taken, so only the
+// states the text actually reaches are ever built. Once too many states are cached they are all
+// thrown away and built again as needed, which keeps the memory bounded.
+//
+// In the leftmost first mode the NFA states are kept in priority order and everything after a match
+// is dropped, like a backtracking engine would never try it. In the longest mode nothing is dropped.
+class LazyDfa {
+public:
+    struct State {
+        std::vector<int> m_nfaStates;
+        bool m_lastWasLineBreak;
+        bool m_match;
+        // Whether the state matches when the next byte is a line break or the end of the text
+        bool m_matchBeforeLineBreak;
+        bool m_dead;
+        // Whether the state is the unanchored start in the middle of a line
+        bool m_idle;
+        State* m_next[256];
+    };
+
+    LazyDfa(const RegexProgram& program, bool anchored, bool longest);
+    ~LazyDfa();
+
+    LazyDfa(const LazyDfa&) = delete;
+    LazyDfa& operator=(const LazyDfa&) = delete;
+
+    State* getStart(bool lastWasLineBreak);
+
+    // Follows the transition for the byte, building the next state the first time
+    inline State* step(State* state, unsigned char c) {
+        auto next = state->m_next[c];
+        return next != nullptr ? next : computeNext(state, c);
+    }
+
+    // Whether there is a match ending before next, which is -1 at the end of the text
+    static inline bool isMatch(const State* state, int next) {
+        return state->m_match || (state->m_matchBeforeLineBreak && (next == '\n' || next < 0));
+    }
+private:
+    State* computeNext(State* state, unsigned char c);
+    void resolveNextLineBreak(const std::vector<int>& nfaStates, bool lastWasLineBreak, int next, std::vector<int>& resolved);
+    void addClosure(std::vector<int>& nfaStates, int start, bool lastWasLineBreak, int next, bool& matched);
+    State* findOrAdd(std::vector<int>& nfaStates, bool lastWasLineBreak);
+    void clearCache();
+
+    static const size_t m_maxCachedStates;
+    // Passed as the next byte while it isn't known yet
+    static const int m_unknownNext;
+
+    const RegexProgram& m_program;
+    bool m_anchored;
+    bool m_longest;
+    std::unordered_map<std::string, std::unique_ptr<State>> m_states;
+    State* m_start[2];
+    size_t m_cacheClears;
+    // Marks of the NFA states already added to the list being built
+    std::vector<size_t> m_seen;
+    size_t m_generation;
+    std::vector<int> m_stack;
+    std::vector<int> m_resolved;
+    std::vector<int> m_next;
+    std::vector<int> m_idleStates;
+};
+
+
+#endif //TEXT_EDITOR_LAZYDFA_H
@@ -0,0 +1,209 @@
+#include "LiteralMatcher.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TEXT_EDITOR_SEARCH_VECTOR
+
+// Compares 32 positions at once
+typedef __m256i Vector;
+static const size_t vectorSize = 32;
+
+static inline Vector broadcast(char c) { return _mm256_set1_epi8(c); }
+static inline Vector load(const char* text) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text)); }
+
+static inline uint32_t matchMask(Vector block, Vector fold, Vector byte) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_or_si256(block, fold), byte)));
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXT_EDITOR_SEARCH_VECTOR
+
+// Compares 16 positions at once
+typedef __m128i Vector;
+static const size_t vectorSize = 16;
+
+static inline Vector broadcast(char c) { return _mm_set1_epi8(c); }
+static inline Vector load(const char* text) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(text)); }
+
+static inline uint32_t matchMask(Vector block, Vector fold, Vector byte) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(block, fold), byte)));
+}
+#endif
+
+#ifdef TEXT_EDITOR_SEARCH_VECTOR
+#ifdef _MSC_VER
+#include <intrin.h>
+
+static inline unsigned lowestBit(uint32_t mask) {
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return bit;
+}
+
+static inline unsigned highestBit(uint32_t mask) {
+    unsigned long bit;
+    _BitScanReverse(&bit, mask);
+    return bit;
+}
+#else
+static inline unsigned lowestBit(uint32_t mask) { return __builtin_ctz(mask); }
+
+static inline unsigned highestBit(uint32_t mask) { return 31 - __builtin_clz(mask); }
+#endif
+#endif
+
+const size_t LiteralMatcher::npos = std::string::npos;
+
+LiteralMatcher::LiteralMatcher(const std::string &pattern, bool caseInsensitive)
+    : m_pattern(pattern), m_caseInsensitive(caseInsensitive) {
+    auto length = m_pattern.size();
+
+    if (m_caseInsensitive) {
+        for (auto& c : m_pattern)
+            c = static_cast<char>(fold(static_cast<unsigned char>(c)));
+    }
+
+    for (size_t i=0; i<256; ++i) {
+        m_shift[i] = length;
+        m_backwardShift[i] = length;
+    }
+
+    for (size_t i=0; i+1<length; ++i)
+        m_shift[static_cast<unsigned char>(m_pattern[i])] = length - 1 - i;
+
+    for (size_t i=length; i>1; --i)
+        m_backwardShift[static_cast<unsigned char>(m_pattern[i-1])] = i - 1;
+}
+
+LiteralMatcher::~LiteralMatcher() {}
+
+// Returns the position of the first match in the text, or npos
+size_t LiteralMatcher::findFirst(const char *text, size_t length) const {
+    auto patternLength = m_pattern.size();
+
+    if (patternLength == 0 || length < patternLength)
+        return npos;
+
+    size_t start = 0;
+
+#ifdef TEXT_EDITOR_SEARCH_VECTOR
+    // Letters are compared with their case bit set, the pattern is already lower case
+    auto first = static_cast<unsigned char>(m_pattern.front());
+    auto last = static_cast<unsigned char>(m_pattern.back());
+    auto firstByte = broadcast(static_cast<char>(first));
+    auto lastByte = broadcast(static_cast<char>(last));
+    auto firstFold = broadcast(m_caseInsensitive && first >= 'a' && first <= 'z' ? 0x20 : 0);
+    auto lastFold = broadcast(m_caseInsensitive && last >= 'a' && last <= 'z' ? 0x20 : 0);
+
+    for (; start + patternLength - 1 + vectorSize <= length; start += vectorSize) {
+        auto mask = matchMask(load(text + start), firstFold, firstByte) &
+                    matchMask(load(text + start + patternLength - 1), lastFold, lastByte);
+
+        while (mask != 0) {
+            auto bit = lowestBit(mask);
+
+            if (matchesAt(text + start + bit))
+                return start + bit;
+
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    return findFirstHorspool(text, start, length);
+}
+
+// Returns the position of the last match in the text, or npos
+size_t LiteralMatcher::findLast(const char *text, size_t length) const {
+    auto patternLength = m_pattern.size();
+
+    if (patternLength == 0 || length < patternLength)
+        return npos;
+
+    // Matches can start anywhere before end
+    size_t end = length - patternLength + 1;
+
+#ifdef TEXT_EDITOR_SEARCH_VECTOR
+    auto first = static_cast<unsigned char>(m_pattern.front());
+    auto last = static_cast<unsigned char>(m_pattern.back());
+    auto firstByte = broadcast(static_cast<char>(first));
+    auto lastByte = broadcast(static_cast<char>(last));
+    auto firstFold = broadcast(m_caseInsensitive && first >= 'a' && first <= 'z' ? 0x20 : 0);
+    auto lastFold = broadcast(m_caseInsensitive && last >= 'a' && last <= 'z' ? 0x20 : 0);
+
+    for (; end >= vectorSize; end -= vectorSize) {
+        auto start = end - vectorSize;
+        auto mask = matchMask(load(text + start), firstFold, firstByte) &
+                    matchMask(load(text + start + patternLength - 1), lastFold, lastByte);
+
+        while (mask != 0) {
+            auto bit = highestBit(mask);
+
+            if (matchesAt(text + start + bit))
+                return start + bit;
+
+            mask &= ~(static_cast<uint32_t>(1) << bit);
+        }
+    }
+#endif
+
+    return findLastHorspool(text, end);
+}
+
+size_t LiteralMatcher::getLength() const { return m_pattern.size(); }
+
+bool LiteralMatcher::matchesAt(const char *text) const {
+    if (!m_caseInsensitive)
+        return std::memcmp(text, m_pattern.data(), m_pattern.size()) == 0;
+
+    for (size_t i=0; i<m_pattern.size(); ++i) {
+        if (fold(static_cast<unsigned char>(text[i])) != static_cast<unsigned char>(m_pattern[i]))
+            return false;
+    }
+
+    return true;
+}
+
+// Looks for the first match starting at or after start
+size_t LiteralMatcher::findFirstHorspool(const char *text, size_t start, size_t length) const {
+    auto patternLength = m_pattern.size();
+
+    while (start + patternLength <= length) {
+        if (matchesAt(text + start))
+            return start;
+
+        auto last = static_cast<unsigned char>(text[start + patternLength - 1]);
+        start += m_shift[m_caseInsensitive ? fold(last) : last];
+    }
+
+    return npos;
+}
+
+// Looks for the last match starting before end, the text has to hold a whole pattern at every such start
+size_t LiteralMatcher::findLastHorspool(const char *text, size_t end) const {
+    auto start = end;
+
+    while (start > 0) {
+        --start;
+
+        if (matchesAt(text + start))
+            return start;
+
+        auto first = static_cast<unsigned char>(text[start]);
+        auto shift = m_backwardShift[m_caseInsensitive ? fold(first) : first];
+
+        if (start < shift)
+            break;
+
+        start -= shift - 1;
+    }
+
+    return npos;
+}
+
+unsigned char LiteralMatcher::fold(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
@@ -0,0 +1,37 @@
+#ifndef TEXT_EDITOR_LITERALMATCHER_H
+#define TEXT_EDITOR_LITERALMATCHER_H
+
+#include <cstddef>
+#include <string>
+
+// Finds a literal pattern in a contiguous block of text. Candidate positions are found by comparing
+// the first and the last byte of the pattern against 16 or 32 positions at once with SSE2 or AVX2,
+// and then checked byte by byte. Without SIMD, and for the ends of blocks too short for a vector,
+// Horspool's algorithm is used.
+class LiteralMatcher {
+public:
+    LiteralMatcher(const std::string& pattern, bool caseInsensitive);
+    ~LiteralMatcher();
+
+    size_t findFirst(const char* text, size_t length) const;
+    size_t findLast(const char* text, size_t length) const;
+
+    size_t getLength() const;
+
+    static const size_t npos;
+private:
+    bool matchesAt(const char* text) const;
+    size_t findFirstHorspool(const char* text, size_t start, size_t length) const;
+    size_t findLastHorspool(const char* text, size_t end) const;
+
+    static unsigned char fold(unsigned char c);
+
+    std::string m_pattern;
+    bool m_caseInsensitive;
+    // Horspool shifts for searching forwards and backwards, indexed by the folded byte
+    size_t m_shift[256];
+    size_t m_backwardShift[256];
+};
+
+
+#endif //TEXT_EDITOR_LITERALMATCHER_H
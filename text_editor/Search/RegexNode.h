@@ -0,0 +1,33 @@
+#ifndef TEXT_EDITOR_REGEXNODE_H
+#define TEXT_EDITOR_REGEXNODE_H
+
+#include <bitset>
+#include <memory>
+#include <vector>
+
+enum RegexNodeType {
+    EmptyNode,
+    BytesNode,
+    ConcatNode,
+    AlternateNode,
+    RepeatNode,
+    LineStartNode,
+    LineEndNode
+};
+
+// Syntax tree of a parsed regular expression. Character classes, escapes and single characters
+// all become a set of bytes the node matches.
+struct RegexNode {
+    static const size_t m_unbounded = static_cast<size_t>(-1);
+
+    RegexNodeType m_type = EmptyNode;
+    std::bitset<256> m_bytes;
+    std::vector<std::unique_ptr<RegexNode>> m_children;
+    // Repetition bounds, m_max is m_unbounded for * and +
+    size_t m_min = 0;
+    size_t m_max = 0;
+    bool m_greedy = true;
+};
+
+
+#endif //TEXT_EDITOR_REGEXNODE_H
@@ -0,0 +1,403 @@
+#include "RegexParser.h"
+
+#include <cctype>
+
+const size_t RegexParser::m_maxRepetition = 1000;
+
+RegexParser::RegexParser(const std::string &pattern, bool caseInsensitive)
+    : m_pattern(pattern), m_position(0), m_caseInsensitive(caseInsensitive) {}
+
+RegexParser::~RegexParser() {}
+
+// Returns the syntax tree, or nullptr if the pattern is not valid
+std::unique_ptr<RegexNode> RegexParser::parse() {
+    m_position = 0;
+    m_error.clear();
+
+    auto node = parseAlternation();
+
+    if (node != nullptr && !isEnd()) {
+        fail("Unmatched )");
+        return nullptr;
+    }
+
+    return node;
+}
+
+const std::string &RegexParser::getError() const { return m_error; }
+
+std::unique_ptr<RegexNode> RegexParser::parseAlternation() {
+    auto first = parseConcatenation();
+
+    if (first == nullptr || isEnd() || peek() != '|')
+        return first;
+
+    auto node = std::make_unique<RegexNode>();
+    node->m_type = AlternateNode;
+    node->m_children.push_back(std::move(first));
+
+    while (!isEnd() && peek() == '|') {
+        ++m_position;
+
+        auto next = parseConcatenation();
+        if (next == nullptr)
+            return nullptr;
+
+        node->m_children.push_back(std::move(next));
+    }
+
+    return node;
+}
+
+std::unique_ptr<RegexNode> RegexParser::parseConcatenation() {
+    auto node = std::make_unique<RegexNode>();
+    node->m_type = ConcatNode;
+
+    while (!isEnd() && peek() != '|' && peek() != ')') {
+        auto next = parseRepetition();
+        if (next == nullptr)
+            return nullptr;
+
+        node->m_children.push_back(std::move(next));
+    }
+
+    if (node->m_children.size() == 1)
+        return std::move(node->m_children.front());
+
+    return node;
+}
+
+std::unique_ptr<RegexNode> RegexParser::parseRepetition() {
+    auto node = parseAtom();
+
+    while (node != nullptr && !isEnd()) {
+        size_t min;
+        size_t max;
+        auto c = peek();
+
+        if (c == '*') {
+            min = 0;
+            max = RegexNode::m_unbounded;
+            ++m_position;
+        } else if (c == '+') {
+            min = 1;
+            max = RegexNode::m_unbounded;
+            ++m_position;
+        } else if (c == '?') {
+            min = 0;
+            max = 1;
+            ++m_position;
+        } else if (c == '{') {
+            if (!parseBounds(min, max))
+                return nullptr;
+        } else {
+            break;
+        }
+
+        auto repeat = std::make_unique<RegexNode>();
+        repeat->m_type = RepeatNode;
+        repeat->m_min = min;
+        repeat->m_max = max;
+
+        if (!isEnd() && peek() == '?') {
+            repeat->m_greedy = false;
+            ++m_position;
+        }
+
+        repeat->m_children.push_back(std::move(node));
+        node = std::move(repeat);
+    }
+
+    return node;
+}
+
+std::unique_ptr<RegexNode> RegexParser::parseAtom() {
+    auto c = peek();
+    ++m_position;
+
+    switch (c) {
+        case '(': {
+            if (m_pattern.compare(m_position, 2, "?:") == 0)
+                m_position += 2;
+            else if (!isEnd() && peek() == '?') {
+                fail("Unsupported group");
+                return nullptr;
+            }
+
+            auto node = parseAlternation();
+            if (node == nullptr)
+                return nullptr;
+
+            if (isEnd() || peek() != ')') {
+                fail("Missing )");
+                return nullptr;
+            }
+
+            ++m_position;
+            return node;
+        }
+        case '[':
+            return parseClass();
+        case '.': {
+            std::bitset<256> bytes;
+            bytes.set();
+            bytes.reset('\n');
+            return makeBytes(bytes);
+        }
+        case '^': {
+            auto node = std::make_unique<RegexNode>();
+            node->m_type = LineStartNode;
+            return node;
+        }
+        case '$': {
+            auto node = std::make_unique<RegexNode>();
+            node->m_type = LineEndNode;
+            return node;
+        }
+        case '\\': {
+            std::bitset<256> bytes;
+            if (!parseEscape(bytes))
+                return nullptr;
+
+            return makeBytes(bytes);
+        }
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            fail("Nothing to repeat");
+            return nullptr;
+        default: {
+            std::bitset<256> bytes;
+            bytes.set(static_cast<unsigned char>(c));
+            return makeBytes(bytes);
+        }
+    }
+}
+
+std::unique_ptr<RegexNode> RegexParser::parseClass() {
+    std::bitset<256> bytes;
+    bool negated = false;
+    bool first = true;
+
+    if (!isEnd() && peek() == '^') {
+        negated = true;
+        ++m_position;
+    }
+
+    while (!isEnd() && (first || peek() != ']')) {
+        first = false;
+
+        std::bitset<256> item;
+        unsigned char low;
+
+        if (peek() == '\\') {
+            ++m_position;
+            if (!parseEscape(item))
+                return nullptr;
+
+            // Only a single byte can start a range
+            if (item.count() != 1) {
+                bytes |= item;
+                continue;
+            }
+
+            low = 0;
+            while (!item.test(low))
+                ++low;
+        } else {
+            low = static_cast<unsigned char>(peek());
+            ++m_position;
+        }
+
+        if (m_position + 1 < m_pattern.size() && peek() == '-' && m_pattern[m_position + 1] != ']') {
+            ++m_position;
+
+            unsigned char high;
+
+            if (peek() == '\\') {
+                ++m_position;
+                if (!parseEscape(item) || item.count() != 1) {
+                    fail("Invalid range");
+                    return nullptr;
+                }
+
+                high = 0;
+                while (!item.test(high))
+                    ++high;
+            } else {
+                high = static_cast<unsigned char>(peek());
+                ++m_position;
+            }
+
+            if (high < low) {
+                fail("Invalid range");
+                return nullptr;
+            }
+
+            for (unsigned c = low; c <= high; ++c)
+                bytes.set(c);
+        } else {
+            bytes.set(low);
+        }
+    }
+
+    if (isEnd()) {
+        fail("Missing ]");
+        return nullptr;
+    }
+
+    ++m_position;
+
+    // Folding before negating, so [^a] doesn't match A either
+    if (m_caseInsensitive) {
+        for (unsigned c = 'a'; c <= 'z'; ++c) {
+            if (bytes.test(c) || bytes.test(c - 'a' + 'A')) {
+                bytes.set(c);
+                bytes.set(c - 'a' + 'A');
+            }
+        }
+    }
+
+    if (negated)
+        bytes.flip();
+
+    auto node = std::make_unique<RegexNode>();
+    node->m_type = BytesNode;
+    node->m_bytes = bytes;
+    return node;
+}
+
+// Parses the escape after a backslash into the set of bytes it matches
+bool RegexParser::parseEscape(std::bitset<256> &bytes) {
+    if (isEnd())
+        return fail("Trailing \\");
+
+    auto c = peek();
+    ++m_position;
+
+    switch (c) {
+        case 'd':
+        case 'D':
+            for (unsigned i = '0'; i <= '9'; ++i)
+                bytes.set(i);
+            break;
+        case 'w':
+        case 'W':
+            for (unsigned i = 0; i < 256; ++i) {
+                if ((i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || (i >= '0' && i <= '9') || i == '_')
+                    bytes.set(i);
+            }
+            break;
+        case 's':
+        case 'S':
+            for (auto space : {' ', '\t', '\n', '\r', '\f', '\v'})
+                bytes.set(static_cast<unsigned char>(space));
+            break;
+        case 'n':
+            bytes.set('\n');
+            break;
+        case 't':
+            bytes.set('\t');
+            break;
+        case 'r':
+            bytes.set('\r');
+            break;
+        case 'f':
+            bytes.set('\f');
+            break;
+        case 'v':
+            bytes.set('\v');
+            break;
+        case 'x': {
+            if (m_position + 2 > m_pattern.size() || !std::isxdigit(static_cast<unsigned char>(m_pattern[m_position])) ||
+                !std::isxdigit(static_cast<unsigned char>(m_pattern[m_position + 1])))
+                return fail("Invalid \\x escape");
+
+            bytes.set(std::stoi(m_pattern.substr(m_position, 2), nullptr, 16));
+            m_position += 2;
+            break;
+        }
+        default:
+            if (std::isalnum(static_cast<unsigned char>(c)))
+                return fail(std::string("Unsupported escape \\") + c);
+
+            bytes.set(static_cast<unsigned char>(c));
+    }
+
+    if (c == 'D' || c == 'W' || c == 'S')
+        bytes.flip();
+
+    return true;
+}
+
+// Parses {n}, {n,} or {n,m}, a { that doesn't start a valid repetition is an error
+bool RegexParser::parseBounds(size_t &min, size_t &max) {
+    ++m_position;
+
+    if (!parseNumber(min))
+        return fail("Invalid repetition");
+
+    max = min;
+
+    if (!isEnd() && peek() == ',') {
+        ++m_position;
+        max = RegexNode::m_unbounded;
+
+        if (!isEnd() && peek() != '}' && !parseNumber(max))
+            return fail("Invalid repetition");
+    }
+
+    if (isEnd() || peek() != '}')
+        return fail("Missing }");
+
+    ++m_position;
+
+    if (max < min)
+        return fail("Invalid repetition");
+
+    if (min > m_maxRepetition || (max != RegexNode::m_unbounded && max > m_maxRepetition))
+        return fail("Repetition is too large");
+
+    return true;
+}
+
+bool RegexParser::parseNumber(size_t &number) {
+    auto start = m_position;
+    number = 0;
+
+    while (!isEnd() && std::isdigit(static_cast<unsigned char>(peek())) && number <= m_maxRepetition) {
+        number = number * 10 + (peek() - '0');
+        ++m_position;
+    }
+
+    return m_position > start;
+}
+
+std::unique_ptr<RegexNode> RegexParser::makeBytes(std::bitset<256> bytes) const {
+    if (m_caseInsensitive) {
+        for (unsigned c = 'a'; c <= 'z'; ++c) {
+            if (bytes.test(c) || bytes.test(c - 'a' + 'A')) {
+                bytes.set(c);
+                bytes.set(c - 'a' + 'A');
+            }
+        }
+    }
+
+    auto node = std::make_unique<RegexNode>();
+    node->m_type = BytesNode;
+    node->m_bytes = bytes;
+    return node;
+}
+
+// Records the first error, always returns false
+bool RegexParser::fail(const std::string &error) {
+    if (m_error.empty())
+        m_error = error + " at position " + std::to_string(m_position);
+
+    return false;
+}
+
+bool RegexParser::isEnd() const { return m_position >= m_pattern.size(); }
+
+char RegexParser::peek() const { return m_pattern[m_position]; }
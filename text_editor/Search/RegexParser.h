@@ -0,0 +1,45 @@
+#ifndef TEXT_EDITOR_REGEXPARSER_H
+#define TEXT_EDITOR_REGEXPARSER_H
+
+#include "RegexNode.h"
+
+#include <string>
+
+// Parses the supported regular expression syntax: literals, ., [...] classes with ranges and negation,
+// the \d \w \s \D \W \S classes, \n \t \r \f \v \xHH escapes, (...) and (?:...) groups, |, the
+// quantifiers * + ? {n} {n,} {n,m} and their lazy forms, and the line anchors ^ and $.
+// Matching works on bytes, case insensitivity only folds ASCII letters.
+class RegexParser {
+public:
+    RegexParser(const std::string& pattern, bool caseInsensitive);
+    ~RegexParser();
+
+    std::unique_ptr<RegexNode> parse();
+
+    const std::string& getError() const;
+private:
+    std::unique_ptr<RegexNode> parseAlternation();
+    std::unique_ptr<RegexNode> parseConcatenation();
+    std::unique_ptr<RegexNode> parseRepetition();
+    std::unique_ptr<RegexNode> parseAtom();
+    std::unique_ptr<RegexNode> parseClass();
+    bool parseEscape(std::bitset<256>& bytes);
+    bool parseBounds(size_t& min, size_t& max);
+    bool parseNumber(size_t& number);
+
+    std::unique_ptr<RegexNode> makeBytes(std::bitset<256> bytes) const;
+    bool fail(const std::string& error);
+
+    bool isEnd() const;
+    char peek() const;
+
+    static const size_t m_maxRepetition;
+
+    std::string m_pattern;
+    size_t m_position;
+    bool m_caseInsensitive;
+    std::string m_error;
+};
+
+
+#endif //TEXT_EDITOR_REGEXPARSER_H
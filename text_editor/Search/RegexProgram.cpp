@@ -0,0 +1,199 @@
+#include "RegexProgram.h"
+
+const size_t RegexProgram::m_maxStates = 100000;
+
+RegexProgram::RegexProgram(const RegexNode &root, bool reverse) : m_reverse(reverse), m_tooLarge(false) {
+    auto fragment = compile(root);
+    auto match = addState(MatchState);
+    patch(fragment.m_holes, match);
+    m_anchoredStart = fragment.m_start;
+
+    // The unanchored start prefers starting the match here over skipping another byte
+    auto any = addState(BytesState);
+    m_states[any].m_bytes.set();
+    m_unanchoredStart = addState(SplitState, m_anchoredStart, any);
+    m_states[any].m_out = m_unanchoredStart;
+}
+
+RegexProgram::~RegexProgram() {}
+
+const RegexProgram::State &RegexProgram::getState(int state) const { return m_states[state]; }
+
+size_t RegexProgram::getStateCount() const { return m_states.size(); }
+
+int RegexProgram::getAnchoredStart() const { return m_anchoredStart; }
+
+int RegexProgram::getUnanchoredStart() const { return m_unanchoredStart; }
+
+// Returns whether every match has to start at the beginning of a line
+bool RegexProgram::isLineAnchored() const {
+    std::vector<bool> seen(m_states.size(), false);
+    std::vector<int> stack = {m_anchoredStart};
+
+    while (!stack.empty()) {
+        auto state = stack.back();
+        stack.pop_back();
+
+        if (seen[state])
+            continue;
+
+        seen[state] = true;
+        auto& current = m_states[state];
+
+        switch (current.m_type) {
+            case SplitState:
+                stack.push_back(current.m_out1);
+                stack.push_back(current.m_out);
+                break;
+            case EpsilonState:
+                stack.push_back(current.m_out);
+                break;
+            case LastLineBreakState:
+                if (!m_reverse)
+                    break;
+                return false;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool RegexProgram::isTooLarge() const { return m_tooLarge; }
+
+RegexProgram::Fragment RegexProgram::compile(const RegexNode &node) {
+    if (m_states.size() > m_maxStates) {
+        m_tooLarge = true;
+        auto state = addState(EpsilonState);
+        return {state, {{state, false}}};
+    }
+
+    switch (node.m_type) {
+        case BytesNode: {
+            auto state = addState(BytesState);
+            m_states[state].m_bytes = node.m_bytes;
+            return {state, {{state, false}}};
+        }
+        case LineStartNode: {
+            auto state = addState(m_reverse ? NextLineBreakState : LastLineBreakState);
+            return {state, {{state, false}}};
+        }
+        case LineEndNode: {
+            auto state = addState(m_reverse ? LastLineBreakState : NextLineBreakState);
+            return {state, {{state, false}}};
+        }
+        case ConcatNode: {
+            if (node.m_children.empty()) {
+                auto state = addState(EpsilonState);
+                return {state, {{state, false}}};
+            }
+
+            // The reverse program reads the parts from the last to the first
+            Fragment result = {-1, {}};
+
+            for (size_t i=0; i<node.m_children.size(); ++i) {
+                auto& child = m_reverse ? node.m_children[node.m_children.size() - 1 - i] : node.m_children[i];
+                auto fragment = compile(*child);
+
+                if (result.m_start < 0) {
+                    result = std::move(fragment);
+                } else {
+                    patch(result.m_holes, fragment.m_start);
+                    result.m_holes = std::move(fragment.m_holes);
+                }
+            }
+
+            return result;
+        }
+        case AlternateNode: {
+            // A chain of splits, earlier alternatives are preferred
+            auto last = compile(*node.m_children.back());
+            Fragment result = last;
+
+            for (size_t i=node.m_children.size()-1; i>0; --i) {
+                auto fragment = compile(*node.m_children[i-1]);
+                auto split = addState(SplitState, fragment.m_start, result.m_start);
+
+                result.m_start = split;
+                result.m_holes.insert(result.m_holes.end(), fragment.m_holes.begin(), fragment.m_holes.end());
+            }
+
+            return result;
+        }
+        case RepeatNode:
+            return compileRepeat(node);
+        default: {
+            auto state = addState(EpsilonState);
+            return {state, {{state, false}}};
+        }
+    }
+}
+
+// Writes out the required copies followed by a loop or by the optional copies
+RegexProgram::Fragment RegexProgram::compileRepeat(const RegexNode &node) {
+    auto& child = *node.m_children.front();
+    Fragment result = {-1, {}};
+
+    auto append = [this, &result](Fragment fragment) {
+        if (result.m_start < 0) {
+            result = std::move(fragment);
+        } else {
+            patch(result.m_holes, fragment.m_start);
+            result.m_holes = std::move(fragment.m_holes);
+        }
+    };
+
+    for (size_t i=0; i<node.m_min; ++i)
+        append(compile(child));
+
+    if (node.m_max == RegexNode::m_unbounded) {
+        auto split = addState(SplitState);
+        auto body = compile(child);
+        patch(body.m_holes, split);
+
+        if (node.m_greedy) {
+            m_states[split].m_out = body.m_start;
+            append({split, {{split, true}}});
+        } else {
+            m_states[split].m_out1 = body.m_start;
+            append({split, {{split, false}}});
+        }
+    } else {
+        for (size_t i=node.m_min; i<node.m_max; ++i) {
+            auto split = addState(SplitState);
+            auto body = compile(child);
+
+            if (node.m_greedy) {
+                m_states[split].m_out = body.m_start;
+                body.m_holes.emplace_back(split, true);
+            } else {
+                m_states[split].m_out1 = body.m_start;
+                body.m_holes.emplace_back(split, false);
+            }
+
+            append({split, std::move(body.m_holes)});
+        }
+    }
+
+    if (result.m_start < 0) {
+        auto state = addState(EpsilonState);
+        result = {state, {{state, false}}};
+    }
+
+    return result;
+}
+
+int RegexProgram::addState(RegexStateType type, int out, int out1) {
+    m_states.push_back({type, out, out1, {}});
+    return static_cast<int>(m_states.size() - 1);
+}
+
+void RegexProgram::patch(const std::vector<std::pair<int, bool>> &holes, int target) {
+    for (auto& [state, second] : holes) {
+        if (second)
+            m_states[state].m_out1 = target;
+        else
+            m_states[state].m_out = target;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef TEXT_EDITOR_REGEXPROGRAM_H
+#define TEXT_EDITOR_REGEXPROGRAM_H
+
+#include "RegexNode.h"
+
+#include <bitset>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum RegexStateType {
+    BytesState,
+    SplitState,
+    EpsilonState,
+    // Passes if the last byte read was a line break, or the program is at the start of the text
+    LastLineBreakState,
+    // Passes if the next byte to read is a line break, or the program is at the end of the text
+    NextLineBreakState,
+    MatchState
+};
+
+// Thompson NFA compiled from a regex syntax tree. A reverse program matches the reversed text, read
+// from the end of a match towards its start, so its line anchors swap which side they look at.
+// Besides the anchored start the program has an unanchored one, which lazily skips any bytes first.
+class RegexProgram {
+public:
+    struct State {
+        RegexStateType m_type;
+        // Split states try m_out before m_out1
+        int m_out;
+        int m_out1;
+        std::bitset<256> m_bytes;
+    };
+
+    RegexProgram(const RegexNode& root, bool reverse);
+    ~RegexProgram();
+
+    const State& getState(int state) const;
+    size_t getStateCount() const;
+    int getAnchoredStart() const;
+    int getUnanchoredStart() const;
+    bool isLineAnchored() const;
+    bool isTooLarge() const;
+private:
+    // A compiled part of the program, the holes are the exits that still have to be connected
+    struct Fragment {
+        int m_start;
+        std::vector<std::pair<int, bool>> m_holes;
+    };
+
+    Fragment compile(const RegexNode& node);
+    Fragment compileRepeat(const RegexNode& node);
+    int addState(RegexStateType type, int out = -1, int out1 = -1);
+    void patch(const std::vector<std::pair<int, bool>>& holes, int target);
+
+    static const size_t m_maxStates;
+
+    std::vector<State> m_states;
+    bool m_reverse;
+    bool m_tooLarge;
+    int m_anchoredStart;
+    int m_unanchoredStart;
+};
+
+
+#endif //TEXT_EDITOR_REGEXPROGRAM_H
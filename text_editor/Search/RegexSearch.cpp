@@ -0,0 +1,227 @@
+#include "RegexSearch.h"
+#include "RegexParser.h"
+#include "../PieceTable/PieceTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+const size_t RegexSearch::npos = std::string::npos;
+const size_t RegexSearch::m_cancelInterval = 64 * 1024;
+
+RegexSearch::RegexSearch(const std::string &pattern, const SearchOptions &options)
+    : m_options(options), m_cancelled(false) {
+    RegexParser parser(pattern, options.m_caseInsensitive);
+    auto root = parser.parse();
+
+    if (root == nullptr) {
+        m_error = parser.getError();
+        return;
+    }
+
+    m_program = std::make_unique<RegexProgram>(*root, false);
+    m_reverseProgram = std::make_unique<RegexProgram>(*root, true);
+
+    if (m_program->isTooLarge() || m_reverseProgram->isTooLarge()) {
+        m_error = "Pattern is too large";
+        m_program.reset();
+        m_reverseProgram.reset();
+        return;
+    }
+
+    m_forward = std::make_unique<LazyDfa>(*m_program, false, false);
+    m_anchoredForward = std::make_unique<LazyDfa>(*m_program, true, false);
+    m_reverse = std::make_unique<LazyDfa>(*m_reverseProgram, false, false);
+    m_anchoredReverse = std::make_unique<LazyDfa>(*m_reverseProgram, true, true);
+}
+
+RegexSearch::~RegexSearch() {}
+
+bool RegexSearch::isValid() const { return m_program != nullptr; }
+
+const std::string &RegexSearch::getError() const { return m_error; }
+
+// Returns the first match starting at or after from, or when searching backward the last match
+// ending at or before from. Nothing is found if the pattern isn't valid or the search was cancelled.
+SearchMatch RegexSearch::find(const PieceTable &table, size_t from) {
+    if (!isValid())
+        return {};
+
+    m_cancelled = false;
+    auto size = getTextSize(table);
+
+    auto match = m_options.m_backward ? findBackward(table, std::min(from, size), size) : findForward(table, from, size);
+    return m_cancelled ? SearchMatch() : match;
+}
+
+SearchMatch RegexSearch::findForward(const PieceTable &table, size_t from, size_t size) {
+    if (from > size)
+        return {};
+
+    auto end = scanForward(*m_forward, table, from, size, size, m_program->isLineAnchored());
+    if (end == npos || m_cancelled)
+        return {};
+
+    // The leftmost match starts at the first position the reverse DFA can reach from its end
+    auto start = end == from ? from : scanBackward(*m_anchoredReverse, table, end, from, size, false);
+    if (start == npos || m_cancelled)
+        return {};
+
+    return {start, end - start};
+}
+
+SearchMatch RegexSearch::findBackward(const PieceTable &table, size_t from, size_t size) {
+    // The first position the reverse DFA matches at is the last start of a match ending before from
+    auto start = scanBackward(*m_reverse, table, from, 0, size, true);
+    if (start == npos || m_cancelled)
+        return {};
+
+    auto end = scanForward(*m_anchoredForward, table, start, from, size, false);
+    if (end == npos || m_cancelled)
+        return {};
+
+    return {start, end - start};
+}
+
+// Runs the DFA over the text from start to end and returns the last position where it matched, or npos.
+// Stops early once the DFA can't match anymore.
+size_t RegexSearch::scanForward(LazyDfa &dfa, const PieceTable &table, size_t start, size_t end, size_t size, bool skipLines) {
+    auto state = dfa.getStart(start == 0 || getByte(table, start - 1, size) == '\n');
+    auto lastMatch = npos;
+    auto position = start;
+    auto it = table.chunkAt(start);
+
+    while (position < end && !it.isEnd()) {
+        auto chunk = *it;
+        auto offset = it.getOffset();
+        auto data = chunk.data() + (position - offset);
+        auto length = std::min(offset + chunk.size(), end) - position;
+        bool jumped = false;
+        size_t i = 0;
+
+        while (i < length && !jumped) {
+            if (isCancelled())
+                return npos;
+
+            auto blockEnd = std::min(length, i + m_cancelInterval);
+
+            for (; i < blockEnd; ++i) {
+                auto c = static_cast<unsigned char>(data[i]);
+
+                if (LazyDfa::isMatch(state, c))
+                    lastMatch = position + i;
+
+                state = dfa.step(state, c);
+
+                if (state->m_dead)
+                    return lastMatch;
+
+                // In the middle of a line a line anchored pattern can't start matching before the next line break
+                if (skipLines && state->m_idle) {
+                    auto lineBreak = static_cast<const char*>(std::memchr(data + i + 1, '\n', length - i - 1));
+
+                    if (lineBreak != nullptr) {
+                        i = lineBreak - data - 1;
+                        continue;
+                    }
+
+                    // There is no line break in the rest of the chunk, the line index finds the next one
+                    auto line = table.getLineAndColumn(position + i + 1).first;
+                    if (line + 1 >= table.getLineCount())
+                        return lastMatch;
+
+                    auto next = table.getLineStart(line + 1) - 1;
+                    if (next >= end)
+                        return lastMatch;
+
+                    position = next;
+                    it = table.chunkAt(position);
+                    jumped = true;
+                    break;
+                }
+            }
+        }
+
+        if (!jumped) {
+            position += length;
+            ++it;
+        }
+    }
+
+    if (LazyDfa::isMatch(state, getByte(table, end, size)))
+        lastMatch = end;
+
+    return lastMatch;
+}
+
+// Runs the DFA over the text from start back to end and returns the last position where it matched, or npos.
+// With stopAtFirst it returns the first one instead.
+size_t RegexSearch::scanBackward(LazyDfa &dfa, const PieceTable &table, size_t start, size_t end, size_t size, bool stopAtFirst) {
+    auto state = dfa.getStart(start == size || getByte(table, start, size) == '\n');
+    auto lastMatch = npos;
+    auto position = start;
+
+    if (position > end) {
+        for (auto it = table.chunkAt(position - 1); position > end && !it.isEnd(); --it) {
+            auto chunk = *it;
+            auto offset = it.getOffset();
+            auto low = std::max(offset, end);
+
+            while (position > low) {
+                if (isCancelled())
+                    return npos;
+
+                auto blockEnd = position - std::min(position - low, m_cancelInterval);
+
+                for (; position > blockEnd; --position) {
+                    auto c = static_cast<unsigned char>(chunk[position - 1 - offset]);
+
+                    if (LazyDfa::isMatch(state, c)) {
+                        lastMatch = position;
+
+                        if (stopAtFirst)
+                            return lastMatch;
+                    }
+
+                    state = dfa.step(state, c);
+
+                    if (state->m_dead)
+                        return lastMatch;
+                }
+            }
+
+            if (offset == 0)
+                break;
+        }
+    }
+
+    if (LazyDfa::isMatch(state, end == 0 ? -1 : getByte(table, end - 1, size)))
+        lastMatch = end;
+
+    return lastMatch;
+}
+
+bool RegexSearch::isCancelled() {
+    if (m_options.m_cancel != nullptr && m_options.m_cancel->load(std::memory_order_relaxed))
+        m_cancelled = true;
+
+    return m_cancelled;
+}
+
+// The size of the text as it is shown, including the unflushed buffers
+size_t RegexSearch::getTextSize(const PieceTable &table) {
+    auto it = table.chunkEnd();
+
+    if (it == table.chunkBegin())
+        return 0;
+
+    --it;
+    return it.getOffset() + (*it).size();
+}
+
+// Returns the byte at the index, or -1 past the end of the text
+int RegexSearch::getByte(const PieceTable &table, size_t index, size_t size) {
+    if (index >= size)
+        return -1;
+
+    return static_cast<unsigned char>(table.getText(index, 1)[0]);
+}
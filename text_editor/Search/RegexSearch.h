@@ -0,0 +1,59 @@
+#ifndef TEXT_EDITOR_REGEXSEARCH_H
+#define TEXT_EDITOR_REGEXSEARCH_H
+
+#include "LazyDfa.h"
+#include "RegexProgram.h"
+#include "SearchMatch.h"
+#include "SearchOptions.h"
+
+#include <memory>
+#include <string>
+
+class PieceTable;
+
+// Searches the text of a PieceTable for a regular expression, reading the chunks in place one byte at
+// a time with lazy DFAs, so matches crossing chunk boundaries need no special handling.
+//
+// A forward search runs the unanchored forward DFA until it can't match anymore, which finds where the
+// leftmost match ends, and then the reverse DFA back from there to find where it starts. A backward search
+// does the opposite. Patterns that can only match at the start of a line skip whole lines without a
+// possible match, using the line breaks of the chunk or the line index of the table.
+class RegexSearch {
+public:
+    RegexSearch(const std::string& pattern, const SearchOptions& options);
+    ~RegexSearch();
+
+    bool isValid() const;
+    const std::string& getError() const;
+
+    SearchMatch find(const PieceTable& table, size_t from);
+
+    static const size_t npos;
+private:
+    SearchMatch findForward(const PieceTable& table, size_t from, size_t size);
+    SearchMatch findBackward(const PieceTable& table, size_t from, size_t size);
+
+    size_t scanForward(LazyDfa& dfa, const PieceTable& table, size_t start, size_t end, size_t size, bool skipLines);
+    size_t scanBackward(LazyDfa& dfa, const PieceTable& table, size_t start, size_t end, size_t size, bool stopAtFirst);
+    bool isCancelled();
+
+    static size_t getTextSize(const PieceTable& table);
+    static int getByte(const PieceTable& table, size_t index, size_t size);
+
+    // How many bytes are scanned between checks for cancellation
+    static const size_t m_cancelInterval;
+
+    SearchOptions m_options;
+    std::string m_error;
+    bool m_cancelled;
+    std::unique_ptr<RegexProgram> m_program;
+    std::unique_ptr<RegexProgram> m_reverseProgram;
+    // Forward and reverse DFAs in the leftmost first mode, and the longest one used to find match starts
+    std::unique_ptr<LazyDfa> m_forward;
+    std::unique_ptr<LazyDfa> m_anchoredForward;
+    std::unique_ptr<LazyDfa> m_reverse;
+    std::unique_ptr<LazyDfa> m_anchoredReverse;
+};
+
+
+#endif //TEXT_EDITOR_REGEXSEARCH_H
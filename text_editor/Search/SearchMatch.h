@@ -0,0 +1,16 @@
+#ifndef TEXT_EDITOR_SEARCHMATCH_H
+#define TEXT_EDITOR_SEARCHMATCH_H
+
+#include <string>
+
+struct SearchMatch {
+    // Index of the first character of the match, std::string::npos if nothing was found
+    size_t m_start = std::string::npos;
+    // Regex matches can be empty
+    size_t m_length = 0;
+
+    bool isFound() const { return m_start != std::string::npos; }
+};
+
+
+#endif //TEXT_EDITOR_SEARCHMATCH_H
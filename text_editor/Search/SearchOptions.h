@@ -0,0 +1,18 @@
+#ifndef TEXT_EDITOR_SEARCHOPTIONS_H
+#define TEXT_EDITOR_SEARCHOPTIONS_H
+
+#include <atomic>
+
+struct SearchOptions {
+    // Searches towards the beginning of the text for the last match that ends before the start index
+    bool m_backward = false;
+    // Ignores the case of ASCII letters
+    bool m_caseInsensitive = false;
+    // Treats the pattern as a regular expression
+    bool m_regex = false;
+    // When set from another thread the search stops and reports no match
+    const std::atomic<bool>* m_cancel = nullptr;
+};
+
+
+#endif //TEXT_EDITOR_SEARCHOPTIONS_H
@@ -0,0 +1,122 @@
+#include "TextSearch.h"
+#include "../PieceTable/PieceTable.h"
+
+const size_t TextSearch::npos = std::string::npos;
+
+TextSearch::TextSearch(const std::string &pattern, const SearchOptions &options)
+    : m_matcher(pattern, options.m_caseInsensitive), m_options(options) {}
+
+TextSearch::~TextSearch() {}
+
+// Returns the index of the first match starting at or after from, or when searching backward
+// the index of the last match ending at or before from. Returns npos if there is none.
+size_t TextSearch::find(const PieceTable &table, size_t from) const {
+    if (m_matcher.getLength() == 0)
+        return npos;
+
+    return m_options.m_backward ? findBackward(table, from) : findForward(table, from);
+}
+
+size_t TextSearch::getLength() const { return m_matcher.getLength(); }
+
+// Checked once per chunk, the literal scan is fast enough that it doesn't need to be more often
+bool TextSearch::isCancelled() const {
+    return m_options.m_cancel != nullptr && m_options.m_cancel->load(std::memory_order_relaxed);
+}
+
+size_t TextSearch::findForward(const PieceTable &table, size_t from) const {
+    auto overlap = m_matcher.getLength() - 1;
+
+    // The text right before the current chunk, kept to find the matches that continue into it
+    std::string carry;
+    size_t carryStart = from;
+
+    for (auto it = table.chunkAt(from); !it.isEnd(); ++it) {
+        if (isCancelled())
+            return npos;
+
+        auto chunk = *it;
+        auto offset = it.getOffset();
+
+        if (offset < from) {
+            chunk.remove_prefix(from - offset);
+            offset = from;
+        }
+
+        // Matches that start in the carry come before the ones inside the chunk. The window is too short
+        // to hold a whole match starting in the chunk, so whatever is found in it starts in the carry.
+        if (!carry.empty()) {
+            auto window = carry;
+            window.append(chunk.data(), std::min(chunk.size(), overlap));
+
+            auto found = m_matcher.findFirst(window.data(), window.size());
+            if (found != LiteralMatcher::npos)
+                return carryStart + found;
+        }
+
+        auto found = m_matcher.findFirst(chunk.data(), chunk.size());
+        if (found != LiteralMatcher::npos)
+            return offset + found;
+
+        if (chunk.size() >= overlap) {
+            carry.assign(chunk.data() + chunk.size() - overlap, overlap);
+        } else {
+            carry.append(chunk.data(), chunk.size());
+            carry.erase(0, carry.size() - std::min(carry.size(), overlap));
+        }
+
+        carryStart = offset + chunk.size() - carry.size();
+    }
+
+    return npos;
+}
+
+size_t TextSearch::findBackward(const PieceTable &table, size_t from) const {
+    if (from == 0)
+        return npos;
+
+    auto overlap = m_matcher.getLength() - 1;
+
+    // The text right after the current chunk, kept to find the matches that continue into it
+    std::string head;
+
+    auto it = table.chunkAt(from - 1);
+
+    // Past the end of the text the search starts from the last chunk
+    if (it.isEnd())
+        --it;
+
+    for (; !it.isEnd(); --it) {
+        if (isCancelled())
+            return npos;
+
+        auto chunk = *it;
+        auto offset = it.getOffset();
+
+        if (offset + chunk.size() > from)
+            chunk.remove_suffix(offset + chunk.size() - from);
+
+        // Matches that continue into the head come after the ones inside the chunk
+        if (!head.empty()) {
+            auto tailLength = std::min(chunk.size(), overlap);
+            std::string window(chunk.data() + chunk.size() - tailLength, tailLength);
+            window += head;
+
+            auto found = m_matcher.findLast(window.data(), window.size());
+            if (found != LiteralMatcher::npos)
+                return offset + chunk.size() - tailLength + found;
+        }
+
+        auto found = m_matcher.findLast(chunk.data(), chunk.size());
+        if (found != LiteralMatcher::npos)
+            return offset + found;
+
+        head.insert(0, chunk.data(), std::min(chunk.size(), overlap));
+        head.resize(std::min(head.size(), overlap));
+
+        if (offset == 0)
+            break;
+    }
+
+    return npos;
+}
@@ -0,0 +1,34 @@
+#ifndef TEXT_EDITOR_TEXTSEARCH_H
+#define TEXT_EDITOR_TEXTSEARCH_H
+
+#include "LiteralMatcher.h"
+#include "SearchOptions.h"
+
+#include <string>
+
+class PieceTable;
+
+// Searches the text of a PieceTable for a literal pattern without copying it. Every chunk is scanned
+// in place, and matches crossing chunk boundaries are found in a small window made of the last
+// pattern length - 1 bytes of the text before the chunk and the start of the chunk.
+class TextSearch {
+public:
+    TextSearch(const std::string& pattern, const SearchOptions& options);
+    ~TextSearch();
+
+    size_t find(const PieceTable& table, size_t from) const;
+
+    size_t getLength() const;
+
+    static const size_t npos;
+private:
+    size_t findForward(const PieceTable& table, size_t from) const;
+    size_t findBackward(const PieceTable& table, size_t from) const;
+    bool isCancelled() const;
+
+    LiteralMatcher m_matcher;
+    SearchOptions m_options;
+};
+
+
+#endif //TEXT_EDITOR_TEXTSEARCH_H
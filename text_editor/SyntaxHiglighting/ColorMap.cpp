@@ -0,0 +1,98 @@
+#include "ColorMap.h"
+
+#include <algorithm>
+
+bool ColorMap::operator==(const ColorMap &other) const {
+    if (m_size != other.m_size || m_spans.size() != other.m_spans.size())
+        return false;
+
+    for (size_t i=0; i<m_spans.size(); ++i) {
+        auto& span = m_spans[i];
+        auto& otherSpan = other.m_spans[i];
+
+        if (span.m_start != otherSpan.m_start || span.m_length != otherSpan.m_length || span.m_color != otherSpan.m_color)
+            return false;
+    }
+
+    return true;
+}
+
+bool ColorMap::operator!=(const ColorMap &other) const { return !(*this == other); }
+
+ColorMap::ColorMap() : m_size(0) {}
+
+ColorMap::ColorMap(size_t size, ThemeColor color) : m_size(size) {
+    if (size != 0)
+        m_spans.push_back({0, (uint32_t) size, color});
+}
+
+// Characters outside of the line have the color of plain text
+ThemeColor ColorMap::at(size_t index) const {
+    if (index >= m_size)
+        return ThemeColor::TextColor;
+
+    return m_spans[findSpan(index)].m_color;
+}
+
+// Colors the characters in [start, end). The spans the range cuts through keep their parts outside of it
+// and the new span is joined with its neighbours if they have the same color
+void ColorMap::fill(size_t start, size_t end, ThemeColor color) {
+    end = std::min(end, m_size);
+
+    if (start >= end)
+        return;
+
+    auto first = findSpan(start);
+    auto last = findSpan(end - 1);
+    auto firstSpan = m_spans[first];
+    auto lastSpan = m_spans[last];
+    auto lastEnd = (size_t) lastSpan.m_start + lastSpan.m_length;
+
+    ColorSpan spans[3];
+    size_t count = 0;
+
+    if (firstSpan.m_start < start)
+        spans[count++] = {firstSpan.m_start, (uint32_t) (start - firstSpan.m_start), firstSpan.m_color};
+
+    spans[count++] = {(uint32_t) start, (uint32_t) (end - start), color};
+
+    if (lastEnd > end)
+        spans[count++] = {(uint32_t) end, (uint32_t) (lastEnd - end), lastSpan.m_color};
+
+    // The neighbours of the replaced spans are joined with the new ones if they have the same color
+    if (first > 0 && m_spans[first - 1].m_color == spans[0].m_color) {
+        --first;
+        spans[0].m_length += spans[0].m_start - m_spans[first].m_start;
+        spans[0].m_start = m_spans[first].m_start;
+    }
+
+    if (last + 1 < m_spans.size() && m_spans[last + 1].m_color == spans[count - 1].m_color) {
+        ++last;
+        spans[count - 1].m_length += m_spans[last].m_length;
+    }
+
+    // A part that was left over can have the same color as the new span
+    size_t merged = 0;
+    for (size_t i=1; i<count; ++i) {
+        if (spans[i].m_color == spans[merged].m_color)
+            spans[merged].m_length += spans[i].m_length;
+        else
+            spans[++merged] = spans[i];
+    }
+    count = merged + 1;
+
+    m_spans.erase(m_spans.begin() + first, m_spans.begin() + last + 1);
+    m_spans.insert(m_spans.begin() + first, spans, spans + count);
+}
+
+const std::vector<ColorSpan> &ColorMap::getSpans() const { return m_spans; }
+
+size_t ColorMap::size() const { return m_size; }
+
+// Finds the span that holds the character at the index
+size_t ColorMap::findSpan(size_t index) const {
+    auto span = std::upper_bound(m_spans.begin(), m_spans.end(), index,
+                                 [](size_t index, const ColorSpan& span) { return index < span.m_start; });
+
+    return span - m_spans.begin() - 1;
+}
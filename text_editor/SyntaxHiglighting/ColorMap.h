@@ -0,0 +1,40 @@
+#ifndef TEXT_EDITOR_COLORMAP_H
+#define TEXT_EDITOR_COLORMAP_H
+
+#include "../GUI/ThemeColor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Characters of a line that follow each other and have the same color
+struct ColorSpan {
+    uint32_t m_start;
+    uint32_t m_length;
+    ThemeColor m_color;
+};
+
+// The colors of a line stored as spans instead of one color for every character. The spans are sorted,
+// cover the whole line and two spans next to each other never have the same color.
+class ColorMap {
+public:
+    bool operator==(const ColorMap& other) const;
+    bool operator!=(const ColorMap& other) const;
+
+    ColorMap();
+    ColorMap(size_t size, ThemeColor color);
+
+    ThemeColor at(size_t index) const;
+    void fill(size_t start, size_t end, ThemeColor color);
+
+    const std::vector<ColorSpan>& getSpans() const;
+    size_t size() const;
+private:
+    size_t findSpan(size_t index) const;
+
+    std::vector<ColorSpan> m_spans;
+    size_t m_size;
+};
+
+
+#endif //TEXT_EDITOR_COLORMAP_H
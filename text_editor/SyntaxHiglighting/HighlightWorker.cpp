@@ -0,0 +1,158 @@
+#include "HighlightWorker.h"
+#include "TextHighlighter.h"
+#include "../PieceTable/LineReader.h"
+
+#include <algorithm>
+
+const size_t HighlightWorker::m_resultSize = 1024;
+
+HighlightResult::HighlightResult(size_t request, size_t version, size_t start, bool preview)
+    : m_request(request), m_version(version), m_start(start), m_preview(preview) {}
+
+HighlightWorker::HighlightWorker()
+    : m_hasRequest(false), m_working(false), m_stopping(false), m_requestId(0) {
+    m_thread = std::thread(&HighlightWorker::workLoop, this);
+}
+
+HighlightWorker::~HighlightWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        ++m_requestId;
+    }
+
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+// Replaces the request the worker is working on, the results of the old one are dropped. Returns the id of the request
+size_t HighlightWorker::request(HighlightRequest request) {
+    size_t id;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = ++m_requestId;
+        m_request = std::move(request);
+        m_hasRequest = true;
+        m_results.clear();
+    }
+
+    m_wake.notify_one();
+    return id;
+}
+
+void HighlightWorker::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_requestId;
+    m_hasRequest = false;
+    m_results.clear();
+}
+
+std::vector<HighlightResult> HighlightWorker::takeResults() {
+    std::vector<HighlightResult> results;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.swap(m_results);
+
+    return results;
+}
+
+// Waits until there are results to take or there is nothing left to do
+void HighlightWorker::waitForResults() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_resultsReady.wait(lock, [this] { return !m_results.empty() || (!m_hasRequest && !m_working); });
+}
+
+void HighlightWorker::workLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wake.wait(lock, [this] { return m_hasRequest || m_stopping; });
+
+        if (m_stopping)
+            return;
+
+        auto request = std::move(m_request);
+        auto id = m_requestId.load();
+        m_hasRequest = false;
+        m_working = true;
+        lock.unlock();
+
+        highlight(request, id);
+
+        lock.lock();
+        m_working = false;
+        m_resultsReady.notify_all();
+    }
+}
+
+void HighlightWorker::highlight(HighlightRequest &request, size_t id) {
+    auto& states = request.m_endsInComment;
+    auto lineCount = request.m_snapshot.isEmpty() ? 0 : request.m_snapshot.getLineCount();
+    lineCount = std::min(lineCount, states.size());
+
+    // The shown lines first, then as many lines above and below them
+    auto visibleStart = std::max(request.m_visibleStart, request.m_start);
+    auto visibleEnd = std::min(request.m_visibleEnd, lineCount);
+    auto margin = request.m_visibleEnd - request.m_visibleStart;
+
+    if (visibleStart < visibleEnd) {
+        preview(request, id, visibleStart, visibleEnd);
+        preview(request, id, std::max(request.m_start, visibleStart - std::min(visibleStart, margin)), visibleStart);
+        preview(request, id, visibleEnd, std::min(lineCount, visibleEnd + margin));
+    }
+
+    // Then every line in order, until past the changed lines one ends like it did before
+    HighlightResult result(id, request.m_snapshot.getVersion(), request.m_start, false);
+    bool insideComment = request.m_start > 0 && states[request.m_start - 1];
+
+    readLines(request.m_snapshot, request.m_start, lineCount, [&](size_t row, std::string& line) {
+        result.m_colorMaps.push_back(TextHighlighter::getColorMap(line, request.m_mode, insideComment));
+        result.m_endsInComment.push_back(insideComment);
+
+        bool done = row + 1 >= request.m_dirtyEnd && states[row] == insideComment;
+
+        if (done || result.m_colorMaps.size() == m_resultSize) {
+            if (!post(result))
+                return false;
+
+            result = HighlightResult(id, request.m_snapshot.getVersion(), row + 1, false);
+        }
+
+        return !done;
+    });
+
+    if (!result.m_colorMaps.empty())
+        post(result);
+}
+
+// Highlights the lines [start, end) from the state the line before them had when it was last highlighted
+void HighlightWorker::preview(HighlightRequest &request, size_t id, size_t start, size_t end) {
+    if (start >= end)
+        return;
+
+    HighlightResult result(id, request.m_snapshot.getVersion(), start, true);
+    bool insideComment = start > 0 && request.m_endsInComment[start - 1];
+
+    readLines(request.m_snapshot, start, end, [&](size_t, std::string& line) {
+        result.m_colorMaps.push_back(TextHighlighter::getColorMap(line, request.m_mode, insideComment));
+        return !isCancelled(id);
+    });
+
+    post(result);
+}
+
+// Hands the result over, unless a newer request came in the meantime
+bool HighlightWorker::post(HighlightResult &result) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (isCancelled(result.m_request))
+        return false;
+
+    m_results.push_back(std::move(result));
+    m_resultsReady.notify_all();
+
+    return true;
+}
+
+bool HighlightWorker::isCancelled(size_t id) const { return m_requestId.load() != id; }
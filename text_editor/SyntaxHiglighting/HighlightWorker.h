@@ -0,0 +1,80 @@
+#ifndef TEXT_EDITOR_HIGHLIGHTWORKER_H
+#define TEXT_EDITOR_HIGHLIGHTWORKER_H
+
+#include "ColorMap.h"
+#include "LanguageMode.h"
+#include "../PieceTable/DocumentSnapshot.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Lines that have to be highlighted in one version of the text
+struct HighlightRequest {
+    DocumentSnapshot m_snapshot;
+    LanguageMode m_mode;
+    // The lines [m_start, m_dirtyEnd) changed, the ones after them are highlighted until one ends the same way as before
+    size_t m_start;
+    size_t m_dirtyEnd;
+    // The shown lines, they are highlighted first
+    size_t m_visibleStart;
+    size_t m_visibleEnd;
+    // Whether each line ended inside a multiline comment when it was last highlighted
+    std::vector<bool> m_endsInComment;
+};
+
+// Highlighted lines [m_start, m_start + m_colorMaps.size()) of one request
+struct HighlightResult {
+    HighlightResult(size_t request, size_t version, size_t start, bool preview);
+
+    size_t m_request;
+    size_t m_version;
+    size_t m_start;
+    // A preview is highlighted from the states the lines had before, only its colors can be shown
+    bool m_preview;
+    std::vector<ColorMap> m_colorMaps;
+    std::vector<bool> m_endsInComment;
+};
+
+// Highlights lines on its own thread, so big changes like opening a file don't hold up the frames. The shown lines
+// and the ones around them are highlighted first as a preview, then the lines are highlighted in order from the first
+// changed one. The results are handed over in parts, a new request makes the worker drop the one it was working on.
+class HighlightWorker {
+public:
+    HighlightWorker();
+    ~HighlightWorker();
+
+    HighlightWorker(const HighlightWorker&) = delete;
+    HighlightWorker& operator=(const HighlightWorker&) = delete;
+
+    size_t request(HighlightRequest request);
+    void cancel();
+    std::vector<HighlightResult> takeResults();
+    void waitForResults();
+private:
+    void workLoop();
+    void highlight(HighlightRequest& request, size_t id);
+    void preview(HighlightRequest& request, size_t id, size_t start, size_t end);
+    bool post(HighlightResult& result);
+    bool isCancelled(size_t id) const;
+
+    // Lines highlighted before the results are handed over
+    static const size_t m_resultSize;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_resultsReady;
+    HighlightRequest m_request;
+    bool m_hasRequest;
+    bool m_working;
+    bool m_stopping;
+    // The id of the newest request, the worker stops working on an older one
+    std::atomic<size_t> m_requestId;
+    std::vector<HighlightResult> m_results;
+    std::thread m_thread;
+};
+
+
+#endif //TEXT_EDITOR_HIGHLIGHTWORKER_H
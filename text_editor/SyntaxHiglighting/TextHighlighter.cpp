@@ -6,10 +6,10 @@
 
 const std::regex TextHighlighter::m_stringRegex = std::regex(R"((['"])((\\\1|.)*?)\1)");
 const std::regex TextHighlighter::m_numberRegex = std::regex(R"(([1-9]\d*|0|(\.\d+))(\.\d+)?)");
-lexertk::generator TextHighlighter::generator;
+thread_local lexertk::generator TextHighlighter::generator;
 
-std::vector<ThemeColor> TextHighlighter::getColorMap(std::string& line, LanguageMode mode) {
-    std::vector<ThemeColor> colorMap(line.size(), ThemeColor::TextColor);
+ColorMap TextHighlighter::getColorMap(std::string& line, LanguageMode mode) {
+    ColorMap colorMap(line.size(), ThemeColor::TextColor);
 
     if (LanguageManager::getLanguage(mode)->isPreprocessor())
         searchForPreprocessorCommands(line, colorMap);
@@ -21,7 +21,16 @@ std::vector<ThemeColor> TextHighlighter::getColorMap(std::string& line, Language
     return colorMap;
 }
 
-void TextHighlighter::searchRegex(std::string line, std::vector<ThemeColor> &colorMap, const std::regex &regex, ThemeColor color) {
+// Highlights the line together with the multiline comments, starting inside one if the line before ended inside it.
+// Afterwards insideComment tells whether the line ends inside a comment
+ColorMap TextHighlighter::getColorMap(std::string &line, LanguageMode mode, bool &insideComment) {
+    auto colorMap = getColorMap(line, mode);
+    insideComment = markMultilineComments(line, colorMap, mode, insideComment);
+
+    return colorMap;
+}
+
+void TextHighlighter::searchRegex(std::string line, ColorMap &colorMap, const std::regex &regex, ThemeColor color) {
     std::smatch regexMatch;
     size_t start = 0;
     size_t matchSize = 0;
@@ -30,38 +39,26 @@ void TextHighlighter::searchRegex(std::string line, std::vector<ThemeColor> &col
         start += regexMatch.prefix().length();
         matchSize = regexMatch[0].length();
 
-        if (colorMap[start] == ThemeColor::TextColor)
-            std::fill(colorMap.begin() + start, colorMap.begin() + start + matchSize, color);
+        if (colorMap.at(start) == ThemeColor::TextColor)
+            colorMap.fill(start, start + matchSize, color);
 
         start += matchSize;
         line = regexMatch.suffix();
     }
 }
 
-void TextHighlighter::searchForKeywordsAndNumbers(std::string line, std::vector<ThemeColor> &colorMap, LanguageMode mode) {
-    std::stringstream stream(line);
-
-    size_t start = 0;
-
-    while (start < line.size()) {
-        if (colorMap[start] == ThemeColor::TextColor) {
-            size_t end = start;
-
-            while (end+1 < colorMap.size() && colorMap[end+1] == ThemeColor::TextColor) {
-                ++end;
-            }
-
-            parseSegment(line, start, end, colorMap, mode);
+void TextHighlighter::searchForKeywordsAndNumbers(std::string line, ColorMap &colorMap, LanguageMode mode) {
+    // The segments are parsed from a copy, since parsing them splits the spans
+    auto spans = colorMap.getSpans();
 
-            start = end+1;
-        } else {
-            ++start;
-        }
+    for (auto& span : spans) {
+        if (span.m_color == ThemeColor::TextColor)
+            parseSegment(line, span.m_start, span.m_start + span.m_length - 1, colorMap, mode);
     }
 }
 
-void TextHighlighter::parseSegment(std::string& line, size_t start, size_t end, std::vector<ThemeColor>& colorMap, LanguageMode mode) {
-    auto keywords = LanguageManager::getLanguage(mode)->getKeywords();
+void TextHighlighter::parseSegment(std::string& line, size_t start, size_t end, ColorMap& colorMap, LanguageMode mode) {
+    auto& keywords = LanguageManager::getLanguage(mode)->getKeywords();
     auto segment = line.substr(start, end-start + 1);
     if (generator.process(segment)) {
         for (size_t i=0; i<generator.size(); ++i) {
@@ -70,23 +67,69 @@ void TextHighlighter::parseSegment(std::string& line, size_t start, size_t end,
             size_t length = token.value.size();
 
             if (token.type == lexertk::token::e_symbol && keywords.find(token.value) != keywords.end()) {
-                std::fill(colorMap.begin() + start + position, colorMap.begin() + start + position + length, ThemeColor::KeywordColor);
+                colorMap.fill(start + position, start + position + length, ThemeColor::KeywordColor);
             } else if (token.value != "." && token.type == lexertk::token::e_number) {
-                std::fill(colorMap.begin() + start + position, colorMap.begin() + start + position + length, ThemeColor::NumberColor);
+                colorMap.fill(start + position, start + position + length, ThemeColor::NumberColor);
             }
         }
     }
 }
 
-void TextHighlighter::searchForPreprocessorCommands(std::string &line, std::vector<ThemeColor> &colorMap) {
+void TextHighlighter::searchForPreprocessorCommands(std::string &line, ColorMap &colorMap) {
     if (!line.empty() && line[0] == '#')
-        std::fill(colorMap.begin(), colorMap.end(), ThemeColor::PreprocessorColor);
+        colorMap.fill(0, colorMap.size(), ThemeColor::PreprocessorColor);
 }
 
-void TextHighlighter::searchForSingleLineComment(std::string& line, std::vector<ThemeColor>& colorMap, LanguageMode mode) {
+void TextHighlighter::searchForSingleLineComment(std::string& line, ColorMap& colorMap, LanguageMode mode) {
     auto start = line.find(LanguageManager::getLanguage(mode)->getSingleLineCommentStart());
 
-    if (start != std::string::npos && colorMap[start] != ThemeColor::StringColor) {
-        std::fill(colorMap.begin() + start, colorMap.end(), ThemeColor::CommentColor);
+    if (start != std::string::npos && colorMap.at(start) != ThemeColor::StringColor) {
+        colorMap.fill(start, colorMap.size(), ThemeColor::CommentColor);
+    }
+}
+
+// Marks the parts of the line that are inside multiline comments, starting inside one if the line before ended
+// inside it. Returns whether the line ends inside a comment
+bool TextHighlighter::markMultilineComments(const std::string& line, ColorMap& colorMap, LanguageMode mode, bool insideComment) {
+    // Get start and end
+    const std::string& multilineCommentStart = LanguageManager::getLanguage(mode)->getMultiLineCommentStart();
+    const std::string& multilineCommentEnd = LanguageManager::getLanguage(mode)->getMultiLineCommentEnd();
+
+    size_t columnIndex = 0;
+
+    while (true) {
+        if (insideComment) {
+            auto start = line.find(multilineCommentEnd, columnIndex);
+
+            // if found comment end
+            if (start != std::string::npos) {
+                auto newColumnIndex = start + multilineCommentEnd.size();
+                // mark everything in the line until the end
+                colorMap.fill(columnIndex, newColumnIndex, ThemeColor::CommentColor);
+                // move the column index after the comment end
+                columnIndex = newColumnIndex;
+                insideComment = false;
+            } else {
+                // Mark everything in the line as a comment, the next line starts inside it
+                colorMap.fill(columnIndex, colorMap.size(), ThemeColor::CommentColor);
+                return true;
+            }
+        } else {
+            // Look for the comment start
+            auto start = line.find(multilineCommentStart, columnIndex);
+
+            // If found and not inside a string
+            if (start != std::string::npos && colorMap.at(start) != ThemeColor::StringColor && colorMap.at(start) != ThemeColor::CommentColor) {
+                auto newColumnIndex =  start + multilineCommentStart.size();
+                // color the comment start tag
+                colorMap.fill(start, newColumnIndex, ThemeColor::CommentColor);
+                // move the column after the comment start
+                columnIndex = newColumnIndex;
+                insideComment = true;
+            } else {
+                // if not found the line ends outside of a comment
+                return false;
+            }
+        }
     }
 }
@@ -7,7 +7,7 @@
 
 #include "LanguageManager.h"
 #include "lexertk.hpp"
-#include "../GUI/Theme.h"
+#include "ColorMap.h"
 
 #include <iostream>
 #include <regex>
@@ -15,21 +15,23 @@
 #include <sstream>
 #include <unordered_map>
 
-enum ThemeColor;
-
+// Highlights single lines. It can be used from more than one thread at a time.
 class TextHighlighter {
 public:
-    static std::vector<ThemeColor> getColorMap(std::string& line, LanguageMode mode);
+    static ColorMap getColorMap(std::string& line, LanguageMode mode);
+    static ColorMap getColorMap(std::string& line, LanguageMode mode, bool& insideComment);
 private:
-    static void searchRegex(std::string line, std::vector<ThemeColor>& colorMap, const std::regex& regex, ThemeColor color);
-    static void searchForKeywordsAndNumbers(std::string line, std::vector<ThemeColor>& colorMap, LanguageMode mode);
-    static void parseSegment(std::string& line, size_t start, size_t end, std::vector<ThemeColor>& colorMap, LanguageMode mode);
-    static void searchForPreprocessorCommands(std::string& line, std::vector<ThemeColor>& colorMap);
-    static void searchForSingleLineComment(std::string& line, std::vector<ThemeColor>& colorMap, LanguageMode mode);
+    static void searchRegex(std::string line, ColorMap& colorMap, const std::regex& regex, ThemeColor color);
+    static void searchForKeywordsAndNumbers(std::string line, ColorMap& colorMap, LanguageMode mode);
+    static void parseSegment(std::string& line, size_t start, size_t end, ColorMap& colorMap, LanguageMode mode);
+    static void searchForPreprocessorCommands(std::string& line, ColorMap& colorMap);
+    static void searchForSingleLineComment(std::string& line, ColorMap& colorMap, LanguageMode mode);
+    static bool markMultilineComments(const std::string& line, ColorMap& colorMap, LanguageMode mode, bool insideComment);
 
     static const std::regex m_stringRegex;
     static const std::regex m_numberRegex;
-    static lexertk::generator generator;
+    // Every thread gets its own, the generator keeps the tokens of the last segment
+    static thread_local lexertk::generator generator;
 };
 
 
@@ -0,0 +1,486 @@
+// Tests of the editing engine without a window. Every failed check is printed and the exit code tells
+// whether any of them failed.
+
+#include "../GUI/LineBuffer.h"
+#include "../PieceTable/PieceTableInstance.h"
+#include "../Search/RegexSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* test, const char* what) {
+        if (condition)
+            return;
+
+        std::printf("%s: %s\n", test, what);
+        ++failures;
+    }
+
+    // The rows hidden by the folded block are the ones after its start up to its end
+    bool hidesRows(const LineBuffer& lineBuffer, size_t start, size_t end) {
+        auto& hidden = lineBuffer.getHidden();
+
+        for (size_t i=0; i<hidden.size(); ++i) {
+            if (hidden[i] != (i > start && i <= end))
+                return false;
+        }
+
+        return true;
+    }
+
+    size_t lineCount(const std::string& text) {
+        return std::count(text.begin(), text.end(), '\n') + 1;
+    }
+
+    // The snapshot reads the text through getText, its chunks and its line index
+    bool readsText(const DocumentSnapshot& snapshot, const std::string& text) {
+        if (snapshot.getSize() != text.size() || snapshot.getText(0, text.size()) != text)
+            return false;
+
+        std::string chunks;
+        for (auto it = snapshot.chunkBegin(); !it.isEnd(); ++it)
+            chunks += *it;
+
+        if (chunks != text || snapshot.getLineCount() != lineCount(text))
+            return false;
+
+        size_t lineStart = 0;
+        for (size_t line=0; line<snapshot.getLineCount(); ++line) {
+            if (snapshot.getLineStart(line) != lineStart || snapshot.getLineAndColumn(lineStart).first != line)
+                return false;
+
+            lineStart = text.find('\n', lineStart) + 1;
+        }
+
+        return true;
+    }
+
+    // Inserts the text pieceLength characters at a time from the back, so no piece continues the one before it
+    void insertInPieces(PieceTable& table, const std::string& text, size_t pieceLength) {
+        for (size_t end = text.size(); end > 0; end -= std::min(end, pieceLength)) {
+            auto start = end - std::min(end, pieceLength);
+            table.insert(text.substr(start, end - start), 0);
+        }
+    }
+
+    bool findsRegex(const PieceTable& table, const std::string& pattern, size_t from, size_t start, size_t length,
+                    bool backward = false) {
+        SearchOptions options;
+        options.m_regex = true;
+        options.m_backward = backward;
+
+        auto match = table.find(pattern, from, options);
+        return match.m_start == start && (start == std::string::npos || match.m_length == length);
+    }
+
+    // Replaces every match of the pattern from left to right, the way the table should
+    std::string replaceInModel(std::string text, const std::string& pattern, const std::string& replacement) {
+        for (auto index = text.find(pattern); index != std::string::npos;
+             index = text.find(pattern, index + replacement.size()))
+            text.replace(index, pattern.size(), replacement);
+
+        return text;
+    }
+
+    // A folded block keeps its range and stays folded when a batch edits the text before, inside and after it,
+    // and when the batch is undone
+    void foldedBlockSurvivesBatch() {
+        const char* test = "folded_block_survives_batch";
+
+        PieceTableInstance instance;
+        LineBuffer lineBuffer(&instance);
+        std::string text = "int a;\nvoid f() {\n\treturn;\n}\nint b;\n";
+
+        instance.openText(text);
+        lineBuffer.setLanguageMode(LanguageMode::Cpp);
+        lineBuffer.finishHighlighting();
+
+        check(lineBuffer.getBlocks().size() == 1, test, "the block is found");
+        if (lineBuffer.getBlocks().size() != 1)
+            return;
+
+        auto block = lineBuffer.getBlocks().front();
+        block->setFolded(true);
+        lineBuffer.updateHiddenForBlock(block);
+
+        std::vector<Edit> edits = {
+                {0, 0, "// a\n"},
+                {18, 0, "\tint c;\n"},
+                {text.size(), 0, "int d;\n"}
+        };
+
+        instance.getInstance().applyEdits(edits);
+        lineBuffer.finishHighlighting();
+
+        check(lineBuffer.getBlocks().size() == 1, test, "the block is kept after the batch");
+        if (lineBuffer.getBlocks().size() != 1)
+            return;
+
+        block = lineBuffer.getBlocks().front();
+        check(block->isFolded(), test, "the block stays folded after the batch");
+        check(block->getStart() == TextCoordinates(2, 10), test, "the block start moves with the batch");
+        check(block->getEnd() == TextCoordinates(5, 1), test, "the block end moves with the batch");
+        check(hidesRows(lineBuffer, 2, 5), test, "the block lines stay hidden after the batch");
+
+        instance.getInstance().undo();
+        lineBuffer.finishHighlighting();
+
+        check(lineBuffer.getBlocks().size() == 1, test, "the block is kept after the undo");
+        if (lineBuffer.getBlocks().size() != 1)
+            return;
+
+        block = lineBuffer.getBlocks().front();
+        check(block->isFolded(), test, "the block stays folded after the undo");
+        check(block->getStart() == TextCoordinates(1, 10), test, "the block start moves back with the undo");
+        check(block->getEnd() == TextCoordinates(3, 1), test, "the block end moves back with the undo");
+        check(hidesRows(lineBuffer, 1, 3), test, "the block lines stay hidden after the undo");
+    }
+
+    // A batch that isn't sorted, overlaps or goes past the end of the text is rejected and leaves the text alone
+    void invalidBatchIsRejected() {
+        const char* test = "invalid_batch_is_rejected";
+
+        std::string text = "0123456789";
+        PieceTable table(text);
+
+        check(!table.applyEdits({{5, 1, "a"}, {2, 1, "b"}}), test, "an unsorted batch is rejected");
+        check(!table.applyEdits({{2, 3, "a"}, {4, 1, "b"}}), test, "overlapping edits are rejected");
+        check(!table.applyEdits({{8, 3, "a"}}), test, "an edit past the end is rejected");
+        check(table.getText(0, table.getTextSize()) == "0123456789", test, "the text is unchanged");
+        check(table.isUndoEmpty(), test, "nothing is recorded for undo");
+
+        check(table.applyEdits({{0, 2, "a"}, {2, 0, "b"}, {9, 1, ""}}), test, "adjacent edits are applied");
+        check(table.getText(0, table.getTextSize()) == "ab2345678", test, "the adjacent edits change the text");
+    }
+
+    // The line operations the TextBox and the TraceReplayer share
+    void lineOperations() {
+        const char* test = "line_operations";
+
+        PieceTableInstance instance;
+        LineBuffer lineBuffer(&instance);
+        std::string text = "a\n\nb\n\tc";
+
+        instance.openText(text);
+        lineBuffer.getLines();
+        auto& table = instance.getInstance();
+        auto textOf = [&table]() { return table.getText(0, table.getTextSize()); };
+
+        check(lineBuffer.addTabs(0, 3), test, "tabs are added");
+        check(textOf() == "\ta\n\n\tb\n\t\tc", test, "the empty row gets no tab");
+
+        check(lineBuffer.removeTabs(0, 3), test, "tabs are removed");
+        check(textOf() == "a\n\nb\n\tc", test, "one tab is removed from every row");
+        check(!lineBuffer.removeTabs(0, 2), test, "rows without tabs are left alone");
+
+        table.undo();
+        check(textOf() == "\ta\n\n\tb\n\t\tc", test, "removing the tabs is one undo step");
+
+        check(lineBuffer.removeTab(3) && textOf() == "\ta\n\n\tb\n\tc", test, "the tab of a single row is removed");
+        check(!lineBuffer.removeTab(1), test, "a row without a tab is left alone");
+
+        check(lineBuffer.deleteLine(0) == 2 && textOf() == "\n\tb\n\tc", test, "a row goes with its line break");
+        check(lineBuffer.deleteLine(2) == 2 && textOf() == "\n\tb\n", test, "the last row keeps the line break before it");
+    }
+
+    // Regex matches are found across piece boundaries, with the line anchors, lazy quantifiers, empty matches
+    // and backward, and a cancelled search or an invalid pattern finds nothing
+    void regexSearch() {
+        const char* test = "regex_search";
+        auto npos = std::string::npos;
+
+        PieceTable table;
+        insertInPieces(table, "int alpha = 12;\nint beta = 345;\nreturn alpha;", 2);
+
+        check(findsRegex(table, "beta = \\d+", 0, 20, 10), test, "a match straddles pieces");
+        check(findsRegex(table, "^r\\w+", 0, 32, 6), test, "a line start is found after pieces without a line break");
+        check(findsRegex(table, "\\d+;$", 16, 27, 4), test, "a line end is found before the line break");
+        check(findsRegex(table, "^alpha", 0, npos, 0), test, "a line start isn't matched in the middle of a line");
+        check(findsRegex(table, "a;$", 0, 43, 2), test, "a line end is matched at the end of the text");
+
+        check(findsRegex(table, "a.*?a", 4, 4, 5), test, "a lazy quantifier stops at the first end");
+        check(findsRegex(table, "\\d+?", 0, 12, 1), test, "a lazy quantifier takes one repeat");
+        check(findsRegex(table, "\\d+", 0, 12, 2), test, "a greedy quantifier takes every repeat");
+        check(findsRegex(table, "\\d{2,}?", 0, 12, 2), test, "a lazy counted repeat takes the minimum");
+        check(findsRegex(table, "x*", 3, 3, 0), test, "an empty match is found where the search starts");
+        check(findsRegex(table, "^", 16, 16, 0), test, "an empty line start match is found");
+
+        check(findsRegex(table, "alpha", table.getTextSize(), 39, 5, true), test, "backward finds the last match");
+        check(findsRegex(table, "alpha", 40, 4, 5, true), test, "backward skips a match ending after the start");
+        check(findsRegex(table, "^\\w+", 30, 16, 3, true), test, "backward finds the last line start");
+        check(findsRegex(table, "beta", 10, npos, 0, true), test, "backward finds nothing before the only match");
+
+        std::atomic<bool> cancel(true);
+        SearchOptions options;
+        options.m_regex = true;
+        options.m_cancel = &cancel;
+        check(!table.find("alpha", 0, options).isFound(), test, "a cancelled search finds nothing");
+        cancel = false;
+        check(table.find("alpha", 0, options).m_start == 4, test, "a search that isn't cancelled finds the match");
+
+        for (auto pattern : {"(a", "a)", "[a", "a{2,1}", "*a", "\\"}) {
+            RegexSearch search(pattern, options);
+            check(!search.isValid() && !search.getError().empty(), test, "an invalid pattern is reported");
+            check(!search.find(table, 0).isFound(), test, "an invalid pattern finds nothing");
+        }
+    }
+
+    // Forward regex searches from every index of a small random corpus find the same matches as std::regex
+    void regexMatchesStdRegex() {
+        const char* test = "regex_matches_std_regex";
+
+        const char* patterns[] = {"a", "ab*", "a|ab", "(a|b)*?b", "a*", "b+?", "[^a]+", "^a", "b$", "^$", "^b*$",
+                                  "a{2}", "(?:ab)+", "b.a", "a\\nb", "[ab]{1,3}?$"};
+        std::mt19937 random(7);
+
+        for (int i=0; i<200; ++i) {
+            std::string text;
+            auto length = random() % 16;
+            for (size_t j=0; j<length; ++j)
+                text += "ab\n"[random() % 3];
+
+            PieceTable table;
+            insertInPieces(table, text, 1 + random() % 3);
+
+            for (auto pattern : patterns) {
+                std::regex regex(pattern, std::regex::ECMAScript | std::regex::multiline);
+
+                for (size_t from = 0; from <= text.size(); ++from) {
+                    std::smatch match;
+                    auto flags = from == 0 ? std::regex_constants::match_default : std::regex_constants::match_prev_avail;
+                    bool found = std::regex_search(text.cbegin() + from, text.cend(), match, regex, flags);
+                    auto start = found ? from + match.position(0) : std::string::npos;
+                    auto matchLength = found ? match.length(0) : 0;
+
+                    if (!findsRegex(table, pattern, from, start, matchLength)) {
+                        check(false, test, pattern);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    // Replacing every match gives the text of the std::string model and is one undo step
+    void replaceAllMatchesModel() {
+        const char* test = "replace_all_matches_model";
+
+        struct Case {
+            const char* text;
+            const char* pattern;
+            const char* replacement;
+        };
+
+        Case cases[] = {
+                {"ab cd ab", "ab", "xyz"},      // Matches at the start and at the end of the text
+                {"aaaaa", "aa", "b"},           // Adjacent matches, the last a is left
+                {"abababx", "ab", "ba"},        // A replacement that contains the start of the next match
+                {"one, two, three", ", ", ""},  // An empty replacement
+                {"same", "same", "same"},       // The whole text
+                {"abc", "x", "y"}               // No match
+        };
+
+        for (auto& c : cases) {
+            for (size_t pieceLength = 1; pieceLength <= 3; ++pieceLength) {
+                PieceTable table;
+                std::string text = c.text;
+                insertInPieces(table, text, pieceLength);
+                auto expected = replaceInModel(text, c.pattern, c.replacement);
+
+                auto count = table.replaceAll(c.pattern, c.replacement);
+                check(table.getText(0, table.getTextSize()) == expected, test, "the replaced text matches the model");
+                check(table.getTextSize() == expected.size(), test, "the size matches the model");
+
+                if (count == 0)
+                    continue;
+
+                table.undo();
+                check(table.getText(0, table.getTextSize()) == text, test, "one undo restores the text");
+
+                table.redo();
+                check(table.getText(0, table.getTextSize()) == expected, test, "redo replaces the matches again");
+            }
+        }
+
+        std::mt19937 random(11);
+
+        for (int i=0; i<200; ++i) {
+            std::string text;
+            auto length = random() % 24;
+            for (size_t j=0; j<length; ++j)
+                text += "ab\n"[random() % 3];
+
+            std::string pattern(1 + random() % 2, 'a');
+            std::string replacement = std::string("xb\n").substr(0, random() % 4);
+
+            PieceTable table;
+            insertInPieces(table, text, 1 + random() % 4);
+            auto expected = replaceInModel(text, pattern, replacement);
+
+            auto count = table.replaceAll(pattern, replacement);
+            if (table.getText(0, table.getTextSize()) != expected || table.getLineCount() != lineCount(expected)) {
+                check(false, test, "a random replacement matches the model");
+                return;
+            }
+
+            if (count == 0)
+                continue;
+
+            table.undo();
+            if (table.getText(0, table.getTextSize()) != text) {
+                check(false, test, "a random replacement is undone");
+                return;
+            }
+        }
+    }
+
+    // With a small undo memory limit the old actions are spilled to disk, and undoing and redoing everything
+    // still goes through every text there was
+    void undoSpillsPastMemoryLimit() {
+        const char* test = "undo_spills_past_memory_limit";
+
+        std::string original = "original text\n";
+        PieceTable table(original);
+        table.setUndoMemoryLimit(256);
+
+        std::vector<std::string> texts = {original};
+        std::mt19937 random(5);
+        auto textOf = [&table]() { return table.getText(0, table.getTextSize()); };
+
+        for (int i=0; i<500; ++i) {
+            auto size = table.getTextSize();
+
+            if (i % 5 == 4 && size > 0) {
+                auto start = random() % size;
+                table.deleteText(start, start + 1 + random() % 8);
+            } else {
+                auto index = random() % (size + 1);
+                std::string word = "word" + std::to_string(i) + (i % 7 == 0 ? "\n" : " ");
+
+                for (size_t j=0; j<word.size(); ++j)
+                    table.insertChar(word[j], index + j);
+
+                table.flushInsertBuffer();
+            }
+
+            texts.push_back(textOf());
+        }
+
+        for (size_t i=texts.size()-1; i>0; --i) {
+            table.undo();
+
+            if (textOf() != texts[i-1]) {
+                check(false, test, "undo restores every earlier text");
+                return;
+            }
+        }
+
+        check(table.isUndoEmpty(), test, "everything is undone");
+        check(textOf() == original, test, "the original text is back");
+
+        for (size_t i=1; i<texts.size(); ++i) {
+            table.redo();
+
+            if (textOf() != texts[i]) {
+                check(false, test, "redo brings back every later text");
+                return;
+            }
+        }
+
+        check(table.isRedoEmpty(), test, "everything is redone");
+        check(table.getLineCount() == lineCount(texts.back()), test, "the line count follows the redone text");
+    }
+
+    // A snapshot keeps its text and lines after the table is edited, compacted and extended with more of the
+    // original buffer, also while another thread reads it
+    void snapshotKeepsText() {
+        const char* test = "snapshot_keeps_text";
+
+        std::string original;
+        for (int i=0; i<200; ++i)
+            original += "line " + std::to_string(i) + "\n";
+
+        PieceTable table(new OriginalBuffer(original), 11);
+        auto textOf = [&table]() { return table.getText(0, table.getTextSize()); };
+
+        // Every slice is appended while a snapshot shares the line breaks, the way the file loader appends
+        // while the highlighter reads
+        auto loaded = table.snapshot();
+        auto loadedText = original.substr(0, 11);
+        std::atomic<bool> appending(true);
+        bool readerKeepsText = true;
+
+        std::thread reader([&]() {
+            while (appending)
+                readerKeepsText = readsText(loaded, loadedText) && readerKeepsText;
+        });
+
+        std::vector<DocumentSnapshot> extended;
+        for (size_t size = 11; size < original.size(); size += 7) {
+            extended.push_back(table.snapshot());
+            table.appendOriginal(std::min((size_t)7, original.size() - size));
+        }
+
+        appending = false;
+        reader.join();
+
+        check(readerKeepsText, test, "a snapshot read by another thread keeps its text while more is loaded");
+        check(textOf() == original, test, "the table reads the whole original buffer");
+
+        for (size_t i=0; i<extended.size(); ++i) {
+            if (!readsText(extended[i], original.substr(0, 11 + i * 7))) {
+                check(false, test, "a snapshot keeps the part loaded before it");
+                break;
+            }
+        }
+
+        auto full = table.snapshot();
+        insertInPieces(table, "a\nb\nc\n", 1);
+        table.deleteText(2, 14);
+        for (char c : std::string("typed\n"))
+            table.insertChar(c, table.getTextSize());
+
+        auto edited = textOf();
+        auto typing = table.snapshot();
+        table.flushInsertBuffer();
+
+        check(readsText(full, original), test, "a snapshot keeps the text before the edits");
+        check(readsText(typing, edited), test, "a snapshot keeps the unflushed typing");
+
+        table.compact();
+        check(textOf() == edited, test, "compacting keeps the text");
+        check(readsText(typing, edited), test, "a snapshot keeps its text after compacting");
+        check(readsText(full, original), test, "an older snapshot keeps its text after compacting");
+
+        table.undo();
+        table.replaceAll("line", "row");
+        check(readsText(typing, edited), test, "a snapshot keeps its text after undo and replace");
+        check(readsText(table.snapshot(), textOf()), test, "a new snapshot reads the current text");
+        check(readsText(loaded, loadedText), test, "the first snapshot is still intact");
+    }
+}
+
+int main() {
+    foldedBlockSurvivesBatch();
+    invalidBatchIsRejected();
+    lineOperations();
+    regexSearch();
+    regexMatchesStdRegex();
+    replaceAllMatchesModel();
+    undoSpillsPastMemoryLimit();
+    snapshotKeepsText();
+
+    if (failures != 0)
+        std::printf("%d checks failed\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
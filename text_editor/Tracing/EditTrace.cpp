@@ -0,0 +1,241 @@
+#include "EditTrace.h"
+
+#include <cstring>
+
+namespace {
+    const char traceMagic[4] = {'J', 'E', 'T', 'T'};
+    const uint8_t traceVersion = 1;
+
+    // Flags stored in the upper bits of the operation byte
+    const uint8_t selectionFlag = 0x80;
+    const uint8_t shiftFlag = 0x40;
+    const uint8_t operationMask = 0x3f;
+
+    bool hasChar(TraceOperation operation) { return operation == TraceOperation::EnterChar; }
+
+    bool hasText(TraceOperation operation) {
+        return operation == TraceOperation::EnterText || operation == TraceOperation::Paste ||
+               operation == TraceOperation::ReplaceAll;
+    }
+}
+
+EditTraceWriter::EditTraceWriter() : m_lastTime(0), m_depth(0) {}
+
+// Starts a trace from the given text, an open trace is closed first
+bool EditTraceWriter::open(const std::string &filePath, LanguageMode mode, const std::string &text) {
+    close();
+
+    m_output.open(filePath, std::ios::binary | std::ios::trunc);
+    if (!m_output.is_open())
+        return false;
+
+    m_output.write(traceMagic, sizeof(traceMagic));
+    m_output.put((char) traceVersion);
+    m_output.put((char) mode);
+    writeVarint(text.size());
+    m_output.write(text.data(), (std::streamsize) text.size());
+
+    m_startTime = std::chrono::steady_clock::now();
+    m_lastTime = 0;
+    m_depth = 0;
+
+    return m_output.good();
+}
+
+// Timestamps the event and appends it to the trace
+void EditTraceWriter::write(TraceEvent &event) {
+    auto now = std::chrono::steady_clock::now();
+    event.m_time = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(now - m_startTime).count();
+
+    auto header = (uint8_t) event.m_operation;
+    if (event.m_selectionActive)
+        header |= selectionFlag;
+    if (event.m_shift)
+        header |= shiftFlag;
+
+    m_output.put((char) header);
+    writeVarint(event.m_time - m_lastTime);
+    writeVarint(event.m_cursorIndex);
+
+    if (event.m_selectionActive) {
+        writeVarint(event.m_selectionStart);
+        writeVarint(event.m_selectionEnd);
+    }
+
+    if (hasChar(event.m_operation))
+        m_output.put(event.m_char);
+
+    if (hasText(event.m_operation)) {
+        writeVarint(event.m_text.size());
+        m_output.write(event.m_text.data(), (std::streamsize) event.m_text.size());
+    }
+
+    if (event.m_operation == TraceOperation::ReplaceAll) {
+        m_output.put((char) ((event.m_caseInsensitive ? 1 : 0) | (event.m_regex ? 2 : 0)));
+        writeVarint(event.m_replacement.size());
+        m_output.write(event.m_replacement.data(), (std::streamsize) event.m_replacement.size());
+    }
+
+    m_lastTime = event.m_time;
+}
+
+void EditTraceWriter::close() {
+    if (m_output.is_open())
+        m_output.close();
+}
+
+// Returns whether the call that begins is the outermost one
+bool EditTraceWriter::beginOperation() { return m_depth++ == 0; }
+
+void EditTraceWriter::endOperation() { --m_depth; }
+
+bool EditTraceWriter::isOpen() const { return m_output.is_open(); }
+
+// Seven bits per byte, the high bit marks that more bytes follow
+void EditTraceWriter::writeVarint(uint64_t value) {
+    while (value >= 0x80) {
+        m_output.put((char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+
+    m_output.put((char) value);
+}
+
+TraceScope::TraceScope(EditTraceWriter *writer, TraceEvent *event) : m_writer(writer) {
+    if (m_writer != nullptr && m_writer->beginOperation() && event != nullptr)
+        m_writer->write(*event);
+}
+
+TraceScope::~TraceScope() {
+    if (m_writer != nullptr)
+        m_writer->endOperation();
+}
+
+// Reads the header of a trace, the text it starts from is available afterwards
+bool EditTraceReader::open(const std::string &filePath) {
+    m_input.open(filePath, std::ios::binary);
+    if (!m_input.is_open())
+        return false;
+
+    char magic[sizeof(traceMagic)];
+    if (!m_input.read(magic, sizeof(magic)) || std::memcmp(magic, traceMagic, sizeof(magic)) != 0)
+        return false;
+
+    auto version = m_input.get();
+    auto mode = m_input.get();
+    uint64_t textSize;
+
+    if (version != traceVersion || mode == std::char_traits<char>::eof() || !readVarint(textSize))
+        return false;
+
+    m_mode = (LanguageMode) mode;
+    m_text.resize(textSize);
+    m_lastTime = 0;
+
+    return (bool) m_input.read(&m_text[0], (std::streamsize) textSize);
+}
+
+// Returns false at the end of the trace, or at an event that was cut short
+bool EditTraceReader::read(TraceEvent &event) {
+    auto header = m_input.get();
+    if (header == std::char_traits<char>::eof())
+        return false;
+
+    auto operation = (uint8_t) header & operationMask;
+    if (operation >= (uint8_t) TraceOperation::Count)
+        return false;
+
+    event = TraceEvent();
+    event.m_operation = (TraceOperation) operation;
+    event.m_selectionActive = (header & selectionFlag) != 0;
+    event.m_shift = (header & shiftFlag) != 0;
+
+    uint64_t timeDelta, cursorIndex;
+    if (!readVarint(timeDelta) || !readVarint(cursorIndex))
+        return false;
+
+    m_lastTime += timeDelta;
+    event.m_time = m_lastTime;
+    event.m_cursorIndex = cursorIndex;
+
+    if (event.m_selectionActive) {
+        uint64_t start, end;
+        if (!readVarint(start) || !readVarint(end))
+            return false;
+
+        event.m_selectionStart = start;
+        event.m_selectionEnd = end;
+    }
+
+    if (hasChar(event.m_operation)) {
+        auto c = m_input.get();
+        if (c == std::char_traits<char>::eof())
+            return false;
+
+        event.m_char = (char) c;
+    }
+
+    if (hasText(event.m_operation)) {
+        uint64_t length;
+        if (!readVarint(length))
+            return false;
+
+        event.m_text.resize(length);
+        if (!m_input.read(&event.m_text[0], (std::streamsize) length))
+            return false;
+    }
+
+    if (event.m_operation == TraceOperation::ReplaceAll) {
+        auto flags = m_input.get();
+        uint64_t length;
+
+        if (flags == std::char_traits<char>::eof() || !readVarint(length))
+            return false;
+
+        event.m_caseInsensitive = (flags & 1) != 0;
+        event.m_regex = (flags & 2) != 0;
+        event.m_replacement.resize(length);
+
+        if (!m_input.read(&event.m_replacement[0], (std::streamsize) length))
+            return false;
+    }
+
+    return true;
+}
+
+LanguageMode EditTraceReader::getLanguageMode() const { return m_mode; }
+
+std::string &EditTraceReader::getText() { return m_text; }
+
+bool EditTraceReader::readVarint(uint64_t &value) {
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        auto byte = m_input.get();
+        if (byte == std::char_traits<char>::eof())
+            return false;
+
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+const char *getTraceOperationName(TraceOperation operation) {
+    switch (operation) {
+        case TraceOperation::EnterChar: return "enterChar";
+        case TraceOperation::EnterText: return "enterText";
+        case TraceOperation::Backspace: return "backspace";
+        case TraceOperation::DeleteChar: return "deleteChar";
+        case TraceOperation::Tab: return "tab";
+        case TraceOperation::Undo: return "undo";
+        case TraceOperation::Redo: return "redo";
+        case TraceOperation::Paste: return "paste";
+        case TraceOperation::DeleteSelection: return "deleteSelection";
+        case TraceOperation::DeleteLine: return "deleteLine";
+        case TraceOperation::ReplaceAll: return "replaceAll";
+        default: return "unknown";
+    }
+}
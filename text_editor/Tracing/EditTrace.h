@@ -0,0 +1,102 @@
+#ifndef TEXT_EDITOR_EDITTRACE_H
+#define TEXT_EDITOR_EDITTRACE_H
+
+#include "../SyntaxHiglighting/LanguageMode.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+enum class TraceOperation : uint8_t {
+    EnterChar,
+    EnterText,
+    Backspace,
+    DeleteChar,
+    Tab,
+    Undo,
+    Redo,
+    Paste,
+    DeleteSelection,
+    // Not editing entry points of their own, but a replay goes wrong without them
+    DeleteLine,
+    ReplaceAll,
+    Count
+};
+
+// One call of a TextBox editing entry point, together with the state of the text box it depends on.
+// Indices are buffer indices of the text as it was right before the call
+struct TraceEvent {
+    TraceOperation m_operation = TraceOperation::EnterChar;
+    // Microseconds since the recording started
+    uint64_t m_time = 0;
+    size_t m_cursorIndex = 0;
+    bool m_selectionActive = false;
+    size_t m_selectionStart = 0;
+    size_t m_selectionEnd = 0;
+    // Tab with shift
+    bool m_shift = false;
+    char m_char = 0;
+    // Entered or pasted text, or the pattern of replace all
+    std::string m_text;
+    std::string m_replacement;
+    bool m_caseInsensitive = false;
+    bool m_regex = false;
+};
+
+// Writes a trace of editing operations. The trace starts with the language mode and the text the
+// recording started from, so it can be replayed without the file. Every event takes a few bytes:
+// the operation with its flags, then the time delta, the indices and the lengths as variable length integers.
+class EditTraceWriter {
+public:
+    EditTraceWriter();
+
+    bool open(const std::string& filePath, LanguageMode mode, const std::string& text);
+    void write(TraceEvent& event);
+    void close();
+
+    bool beginOperation();
+    void endOperation();
+    bool isOpen() const;
+private:
+    void writeVarint(uint64_t value);
+
+    std::ofstream m_output;
+    std::chrono::time_point<std::chrono::steady_clock> m_startTime;
+    uint64_t m_lastTime;
+    // Entry points call each other, only the outermost call is recorded
+    size_t m_depth;
+};
+
+// Records an entry point call when it is the outermost one, and marks its end when it goes out of scope
+class TraceScope {
+public:
+    TraceScope(EditTraceWriter* writer, TraceEvent* event);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+private:
+    EditTraceWriter* m_writer;
+};
+
+class EditTraceReader {
+public:
+    bool open(const std::string& filePath);
+    bool read(TraceEvent& event);
+
+    LanguageMode getLanguageMode() const;
+    std::string& getText();
+private:
+    bool readVarint(uint64_t& value);
+
+    std::ifstream m_input;
+    LanguageMode m_mode = LanguageMode::PlainText;
+    std::string m_text;
+    uint64_t m_lastTime = 0;
+};
+
+const char* getTraceOperationName(TraceOperation operation);
+
+
+#endif //TEXT_EDITOR_EDITTRACE_H
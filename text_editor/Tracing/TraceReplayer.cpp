@@ -0,0 +1,185 @@
+#include "TraceReplayer.h"
+
+TraceReplayer::TraceReplayer(std::string &text, LanguageMode mode) {
+    m_pieceTableInstance = new PieceTableInstance();
+    m_lineBuffer = new LineBuffer(m_pieceTableInstance);
+
+    m_pieceTableInstance->openText(text);
+    m_lineBuffer->setLanguageMode(mode);
+    m_lineBuffer->getLines();
+}
+
+TraceReplayer::~TraceReplayer() {
+    delete m_lineBuffer;
+    delete m_pieceTableInstance;
+}
+
+// Like the TextBox entry points, every operation ends with the lines updated for the change
+void TraceReplayer::apply(const TraceEvent &event) {
+    switch (event.m_operation) {
+        case TraceOperation::EnterChar:
+            enterChar(event);
+            break;
+        case TraceOperation::EnterText:
+            enterText(event, event.m_text);
+            break;
+        case TraceOperation::Backspace:
+            backspace(event);
+            break;
+        case TraceOperation::DeleteChar:
+            deleteChar(event);
+            break;
+        case TraceOperation::Tab:
+            tab(event);
+            break;
+        case TraceOperation::Undo:
+            undo();
+            break;
+        case TraceOperation::Redo:
+            redo();
+            break;
+        case TraceOperation::Paste:
+            if (!event.m_text.empty())
+                enterText(event, event.m_text);
+            break;
+        case TraceOperation::DeleteSelection:
+            deleteSelection(event);
+            break;
+        case TraceOperation::DeleteLine:
+            deleteLine(event);
+            break;
+        case TraceOperation::ReplaceAll:
+            replaceAll(event);
+            break;
+        default:
+            break;
+    }
+
+    m_lineBuffer->getLines();
+}
+
+PieceTable &TraceReplayer::getTable() const { return m_pieceTableInstance->getInstance(); }
+
+LineBuffer &TraceReplayer::getLineBuffer() const { return *m_lineBuffer; }
+
+void TraceReplayer::enterChar(const TraceEvent &event) {
+    updateUndoRedo();
+    auto index = deleteSelection(event) ? getSelectionStart(event) : event.m_cursorIndex;
+
+    getTable().flushDeleteBuffer();
+    getTable().insertChar(event.m_char, index);
+}
+
+void TraceReplayer::enterText(const TraceEvent &event, const std::string &text) {
+    updateUndoRedo();
+    auto index = deleteSelection(event) ? getSelectionStart(event) : event.m_cursorIndex;
+
+    getTable().flushInsertBuffer();
+    getTable().flushDeleteBuffer();
+    getTable().insert(text, index);
+}
+
+void TraceReplayer::backspace(const TraceEvent &event) {
+    if (deleteSelection(event) || event.m_cursorIndex == 0)
+        return;
+
+    updateUndoRedo();
+    getTable().flushInsertBuffer();
+    getTable().backspace(event.m_cursorIndex);
+}
+
+void TraceReplayer::deleteChar(const TraceEvent &event) {
+    if (deleteSelection(event) || event.m_cursorIndex >= m_lineBuffer->getCharSize())
+        return;
+
+    updateUndoRedo();
+    getTable().flushInsertBuffer();
+    getTable().charDelete(event.m_cursorIndex);
+}
+
+void TraceReplayer::tab(const TraceEvent &event) {
+    auto& table = getTable();
+
+    updateUndoRedo();
+    table.flushInsertBuffer();
+    table.flushDeleteBuffer();
+
+    auto cursorRow = table.getLineAndColumn(event.m_cursorIndex).first;
+
+    if (event.m_selectionActive) {
+        auto beginRow = table.getLineAndColumn(getSelectionStart(event)).first;
+        auto endRow = table.getLineAndColumn(getSelectionEnd(event)).first;
+
+        if (beginRow < endRow) {
+            if (event.m_shift)
+                m_lineBuffer->removeTabs(beginRow, endRow);
+            else
+                m_lineBuffer->addTabs(beginRow, endRow);
+            return;
+        }
+    }
+
+    if (event.m_shift) {
+        m_lineBuffer->removeTab(cursorRow);
+    } else {
+        auto index = deleteSelection(event) ? getSelectionStart(event) : event.m_cursorIndex;
+        table.insertChar('\t', index);
+    }
+}
+
+void TraceReplayer::undo() {
+    getTable().flushInsertBuffer();
+    getTable().flushDeleteBuffer();
+    getTable().undo();
+}
+
+void TraceReplayer::redo() {
+    getTable().redo();
+}
+
+void TraceReplayer::deleteLine(const TraceEvent &event) {
+    auto& table = getTable();
+
+    updateUndoRedo();
+    table.flushInsertBuffer();
+    table.flushDeleteBuffer();
+
+    if (deleteSelection(event))
+        return;
+
+    m_lineBuffer->deleteLine(table.getLineAndColumn(event.m_cursorIndex).first);
+}
+
+void TraceReplayer::replaceAll(const TraceEvent &event) {
+    SearchOptions options;
+    options.m_caseInsensitive = event.m_caseInsensitive;
+    options.m_regex = event.m_regex;
+
+    updateUndoRedo();
+    getTable().replaceAll(event.m_text, event.m_replacement, options);
+}
+
+bool TraceReplayer::deleteSelection(const TraceEvent &event) {
+    if (!event.m_selectionActive)
+        return false;
+
+    updateUndoRedo();
+    getTable().flushInsertBuffer();
+    getTable().flushDeleteBuffer();
+    getTable().deleteText(getSelectionStart(event), getSelectionEnd(event));
+
+    m_lineBuffer->getLines();
+    return true;
+}
+
+void TraceReplayer::updateUndoRedo() {
+    getTable().clearStacksIfRedoable();
+}
+
+size_t TraceReplayer::getSelectionStart(const TraceEvent &event) {
+    return std::min(event.m_selectionStart, event.m_selectionEnd);
+}
+
+size_t TraceReplayer::getSelectionEnd(const TraceEvent &event) {
+    return std::max(event.m_selectionStart, event.m_selectionEnd);
+}
@@ -0,0 +1,45 @@
+#ifndef TEXT_EDITOR_TRACEREPLAYER_H
+#define TEXT_EDITOR_TRACEREPLAYER_H
+
+#include "EditTrace.h"
+#include "../GUI/LineBuffer.h"
+#include "../PieceTable/PieceTableInstance.h"
+
+// Applies the events of an edit trace without a window. Every event makes the same piece table calls
+// the TextBox entry point it was recorded from makes, and then brings the LineBuffer up to date,
+// which highlights the changed lines with the TextHighlighter the same way the editor does.
+class TraceReplayer {
+public:
+    TraceReplayer(std::string& text, LanguageMode mode);
+    ~TraceReplayer();
+
+    TraceReplayer(const TraceReplayer&) = delete;
+    TraceReplayer& operator=(const TraceReplayer&) = delete;
+
+    void apply(const TraceEvent& event);
+
+    PieceTable& getTable() const;
+    LineBuffer& getLineBuffer() const;
+private:
+    void enterChar(const TraceEvent& event);
+    void enterText(const TraceEvent& event, const std::string& text);
+    void backspace(const TraceEvent& event);
+    void deleteChar(const TraceEvent& event);
+    void tab(const TraceEvent& event);
+    void undo();
+    void redo();
+    void deleteLine(const TraceEvent& event);
+    void replaceAll(const TraceEvent& event);
+
+    bool deleteSelection(const TraceEvent& event);
+    void updateUndoRedo();
+
+    static size_t getSelectionStart(const TraceEvent& event);
+    static size_t getSelectionEnd(const TraceEvent& event);
+
+    PieceTableInstance* m_pieceTableInstance;
+    LineBuffer* m_lineBuffer;
+};
+
+
+#endif //TEXT_EDITOR_TRACEREPLAYER_H
@@ -0,0 +1,109 @@
+// Replays an edit trace recorded in the editor without a window and reports how long every kind of operation took.
+// Usage: edit_trace_replayer <trace file>
+
+#include "EditTrace.h"
+#include "TraceReplayer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace {
+    std::atomic<size_t> allocationCount(0);
+    std::atomic<size_t> allocatedBytes(0);
+
+    void* allocate(size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+        auto pointer = std::malloc(size == 0 ? 1 : size);
+        if (pointer == nullptr)
+            throw std::bad_alloc();
+
+        return pointer;
+    }
+
+    // Returns the p-th percentile of sorted latencies
+    double percentile(const std::vector<double>& latencies, double p) {
+        if (latencies.empty())
+            return 0.0;
+
+        auto index = (size_t) (p / 100.0 * (double) (latencies.size() - 1) + 0.5);
+        return latencies[std::min(index, latencies.size() - 1)];
+    }
+
+    void printLatencies(const char* name, std::vector<double>& latencies) {
+        if (latencies.empty())
+            return;
+
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("%-16s %10zu %10.1f %10.1f %10.1f %10.1f\n", name, latencies.size(), percentile(latencies, 50.0),
+                    percentile(latencies, 90.0), percentile(latencies, 99.0), latencies.back());
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    EditTraceReader reader;
+    if (!reader.open(argv[1])) {
+        std::fprintf(stderr, "Couldn't read the trace %s\n", argv[1]);
+        return 1;
+    }
+
+    TraceReplayer replayer(reader.getText(), reader.getLanguageMode());
+
+    std::vector<std::vector<double>> latencies((size_t) TraceOperation::Count);
+    std::vector<double> allLatencies;
+    TraceEvent event;
+
+    // Only the allocations made by the replayed operations are counted
+    size_t allocations = 0;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (reader.read(event)) {
+        auto operationAllocations = allocationCount.load(std::memory_order_relaxed);
+        auto operationBytes = allocatedBytes.load(std::memory_order_relaxed);
+        auto operationStart = std::chrono::steady_clock::now();
+
+        replayer.apply(event);
+
+        auto operationEnd = std::chrono::steady_clock::now();
+        allocations += allocationCount.load(std::memory_order_relaxed) - operationAllocations;
+        bytes += allocatedBytes.load(std::memory_order_relaxed) - operationBytes;
+
+        auto microseconds = std::chrono::duration<double, std::micro>(operationEnd - operationStart).count();
+        latencies[(size_t) event.m_operation].push_back(microseconds);
+        allLatencies.push_back(microseconds);
+    }
+
+    auto total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-16s %10s %10s %10s %10s %10s\n", "operation", "count", "p50 us", "p90 us", "p99 us", "max us");
+
+    for (size_t i=0; i<latencies.size(); ++i)
+        printLatencies(getTraceOperationName((TraceOperation) i), latencies[i]);
+
+    printLatencies("all", allLatencies);
+
+    std::printf("\n%zu operations in %.1f ms\n", allLatencies.size(), total);
+    std::printf("%zu allocations, %zu bytes\n", allocations, bytes);
+    std::printf("final size %zu, %zu lines\n", replayer.getTable().getSize(), replayer.getLineBuffer().getLinesSize());
+
+    return 0;
+}